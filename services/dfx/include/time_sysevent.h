@@ -16,7 +16,10 @@
 #ifndef TIME_SYSEVENT_H
 #define TIME_SYSEVENT_H
 
+#include <vector>
+
 #include "timer_info.h"
+#include "timer_manager_interface.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -51,12 +54,39 @@ enum ReportEventCode : int32_t {
     NTP_COMPARE_UNTRUSTED,
     NTP_VOTE_UNTRUSTED,
 };
+// One row per delivery stage, timer type, exactness and uid bucket, lateness in us.
+struct TimerLatenessStatistic {
+    std::vector<int32_t> stages;
+    std::vector<int32_t> types;
+    std::vector<int32_t> exacts;
+    std::vector<int32_t> uidBuckets;
+    std::vector<int64_t> counts;
+    std::vector<int64_t> p50s;
+    std::vector<int64_t> p90s;
+    std::vector<int64_t> p99s;
+    std::vector<int64_t> maxs;
+    std::vector<int64_t> missedWindows;
+};
+// One row per uid, the uids with the most wakeups charged first.
+struct TimerWakeupStatistic {
+    // length of the window in s
+    int64_t window = 0;
+    int64_t wakeups = 0;
+    int64_t timers = 0;
+    std::vector<int32_t> uids;
+    std::vector<int64_t> chargedWakeups;
+    std::vector<int64_t> riders;
+    std::vector<int64_t> rides;
+    std::vector<std::string> topTimers;
+};
 void StatisticReporter(int32_t size, std::shared_ptr<TimerInfo> timer);
 void TimeBehaviorReport(ReportEventCode eventCode, const std::string &originTime, const std::string &newTime,
     int64_t ntpTime);
 void TimerBehaviorReport(std::shared_ptr<TimerInfo> timer, bool isStart);
 void TimerCountStaticReporter(int count, int (&uidArr)[COUNT_REPORT_ARRAY_LENGTH],
     int (&createTimerCountArr)[COUNT_REPORT_ARRAY_LENGTH], int (&startTimerCountArr)[COUNT_REPORT_ARRAY_LENGTH]);
+void TimerLatenessReporter(TimerLatenessStatistic &statistic);
+void TimerWakeupReporter(TimerWakeupStatistic &statistic);
 void TimeServiceFaultReporter(ReportEventCode eventCode, int errCode, int uid, const std::string &bundleOrProcessName,
     const std::string &extraInfo);
 } // namespace MiscServices
@@ -140,6 +140,52 @@ void TimerCountStaticReporter(int count, int (&uidArr)[COUNT_REPORT_ARRAY_LENGTH
     }
 }
 
+void TimerLatenessReporter(TimerLatenessStatistic &statistic)
+{
+    auto rows = statistic.counts.size();
+    struct HiSysEventParam params[] = {
+        {"STAGE",          HISYSEVENT_INT32_ARRAY, {.array = statistic.stages.data()},        rows},
+        {"TIMER_TYPE",     HISYSEVENT_INT32_ARRAY, {.array = statistic.types.data()},         rows},
+        {"EXACT",          HISYSEVENT_INT32_ARRAY, {.array = statistic.exacts.data()},        rows},
+        {"UID_BUCKET",     HISYSEVENT_INT32_ARRAY, {.array = statistic.uidBuckets.data()},    rows},
+        {"COUNT",          HISYSEVENT_INT64_ARRAY, {.array = statistic.counts.data()},        rows},
+        {"P50",            HISYSEVENT_INT64_ARRAY, {.array = statistic.p50s.data()},          rows},
+        {"P90",            HISYSEVENT_INT64_ARRAY, {.array = statistic.p90s.data()},          rows},
+        {"P99",            HISYSEVENT_INT64_ARRAY, {.array = statistic.p99s.data()},          rows},
+        {"MAX",            HISYSEVENT_INT64_ARRAY, {.array = statistic.maxs.data()},          rows},
+        {"MISSED_WINDOWS", HISYSEVENT_INT64_ARRAY, {.array = statistic.missedWindows.data()}, rows}
+    };
+    int ret = OH_HiSysEvent_Write("TIME", "TIMER_LATENESS", HISYSEVENT_STATISTIC,
+        params, sizeof(params)/sizeof(params[0]));
+    if (ret != 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "TimerLatenessReporter failed! rows:%{public}zu ret:%{public}d", rows, ret);
+    }
+}
+
+void TimerWakeupReporter(TimerWakeupStatistic &statistic)
+{
+    auto rows = statistic.uids.size();
+    std::vector<char *> topTimers;
+    for (auto &name : statistic.topTimers) {
+        topTimers.push_back(const_cast<char*>(name.c_str()));
+    }
+    struct HiSysEventParam params[] = {
+        {"WINDOW",          HISYSEVENT_INT64,        {.i64 = statistic.window},                  0},
+        {"WAKEUPS",         HISYSEVENT_INT64,        {.i64 = statistic.wakeups},                 0},
+        {"TIMERS",          HISYSEVENT_INT64,        {.i64 = statistic.timers},                  0},
+        {"UID",             HISYSEVENT_INT32_ARRAY,  {.array = statistic.uids.data()},           rows},
+        {"CHARGED_WAKEUPS", HISYSEVENT_INT64_ARRAY,  {.array = statistic.chargedWakeups.data()}, rows},
+        {"RIDERS",          HISYSEVENT_INT64_ARRAY,  {.array = statistic.riders.data()},         rows},
+        {"RIDES",           HISYSEVENT_INT64_ARRAY,  {.array = statistic.rides.data()},          rows},
+        {"TOP_TIMER",       HISYSEVENT_STRING_ARRAY, {.array = topTimers.data()},                rows}
+    };
+    int ret = OH_HiSysEvent_Write("TIME", "TIMER_WAKEUP", HISYSEVENT_STATISTIC,
+        params, sizeof(params)/sizeof(params[0]));
+    if (ret != 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "TimerWakeupReporter failed! rows:%{public}zu ret:%{public}d", rows, ret);
+    }
+}
+
 void TimeServiceFaultReporter(ReportEventCode eventCode, int errCode, int uid, const std::string &bundleOrProcessName,
     const std::string &extraInfo)
 {
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SNTP_CLIENT_CLOCK_DISCIPLINE_H
+#define SNTP_CLIENT_CLOCK_DISCIPLINE_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+struct NtpSample {
+    // server wall time minus local boot time
+    int64_t offsetUs = 0;
+    int64_t delayUs = 0;
+    // local boot time the sample was taken at
+    int64_t referenceUs = 0;
+};
+
+/**
+ * Keeps the wall clock on NTP time without stepping it.
+ *
+ * Offsets below the step threshold are handed to the kernel with adjtimex, which slews the clock
+ * gradually, so no time change event is published and no timer has to be rebatched.
+ */
+class ClockDiscipline {
+public:
+    static ClockDiscipline &GetInstance();
+    // Combines the samples of one server, only the lowest-delay half of them is used.
+    static NtpSample CombineSamples(std::vector<NtpSample> samples);
+    // Slews the wall clock towards `time` in ms, returns false if the offset is too large and needs a step.
+    bool Slew(int64_t time);
+    // Returns the sum in ms of all offsets handed to the kernel, these also moved the boot clock.
+    int64_t GetTotalSlew();
+    void ShowClockDisciplineInfo(int fd);
+
+private:
+    ClockDiscipline() = default;
+    ~ClockDiscipline() = default;
+
+    std::mutex mutex_;
+    uint64_t slews_ = 0;
+    uint64_t steps_ = 0;
+    int64_t lastOffset_ = 0;
+    int64_t totalSlew_ = 0;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SNTP_CLIENT_CLOCK_DISCIPLINE_H
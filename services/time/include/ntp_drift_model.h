@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SNTP_CLIENT_NTP_DRIFT_MODEL_H
+#define SNTP_CLIENT_NTP_DRIFT_MODEL_H
+
+#include <cstdint>
+#include <mutex>
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * Learns how fast the local clock drifts away from NTP time.
+ *
+ * Successive trusted NTP results are compared against the boot clock, which is not moved by time steps, and
+ * the drift rate in ppm is smoothed over the samples and persisted across reboots. The rate decides how long
+ * a time result stays accurate enough, and therefore when the next sync is due and how far a new server may
+ * deviate from the last result before it is considered untrusted.
+ */
+class NtpDriftModel {
+public:
+    static NtpDriftModel &GetInstance();
+    void Init();
+    // Adds a trusted result taken at `bootTime` in ms, `certainty` is its error bound in ms.
+    void AddSample(int64_t bootTime, int64_t ntpTime, int64_t certainty);
+    // Returns how long after a successful sync the next one is due, in ms.
+    int64_t GetSyncInterval();
+    // Returns the shortest gap in ms between two syncs triggered by events such as network changes.
+    int64_t GetMinUpdateGap();
+    // Returns how far in ms the clock may have drifted `elapsed` ms after a sync.
+    int64_t GetMaxDrift(int64_t elapsed);
+    // Returns the drift alone, without the tolerance of a new result, that `elapsed` ms may have added.
+    int64_t GetDriftBound(int64_t elapsed);
+    // Returns how long in ms a time result may be used without a new sync.
+    int64_t GetMaxResultAge();
+    void ShowDriftModelInfo(int fd);
+
+private:
+    NtpDriftModel() = default;
+    ~NtpDriftModel() = default;
+    // needs to acquire the lock `mutex_` before calling this method
+    void SaveLocked();
+
+    std::mutex mutex_;
+    double driftPpm_ = 0;
+    uint32_t samples_ = 0;
+    int64_t lastBootTime_ = 0;
+    int64_t lastNtpTime_ = 0;
+    int64_t lastCertainty_ = 0;
+    int64_t lastSlew_ = 0;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SNTP_CLIENT_NTP_DRIFT_MODEL_H
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SNTP_CLIENT_NTP_RESOLVER_H
+#define SNTP_CLIENT_NTP_RESOLVER_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+struct NtpAddress {
+    struct sockaddr_storage addr {};
+    socklen_t addrLen = 0;
+    std::string ToString() const;
+};
+
+/**
+ * Resolver cache of the NTP hosts.
+ *
+ * All A and AAAA answers of a host are kept until their TTL expires. Addresses are returned with the two
+ * families interleaved, as happy eyeballs expects, and addresses that failed recently are moved to the back.
+ * Queries go to the system resolver, which hides the TTL, unless a name server is set, in which case they
+ * are sent to it directly over UDP. The latter is what a local stub resolver is tested with.
+ */
+class NtpResolver {
+public:
+    static NtpResolver &GetInstance();
+    // Returns all addresses of `host` in the order they should be tried, empty if it can not be resolved.
+    // An IP literal may carry a port ("ip:port" or "[v6]:port"), which local test servers listen on.
+    std::vector<NtpAddress> Resolve(const std::string &host);
+    // Demotes `address` on failure, a success clears its failures.
+    void ReportResult(const NtpAddress &address, bool success);
+    // Sends queries to `nameServer` ("ip" or "ip:port"), an empty string goes back to the system resolver.
+    void SetNameServer(const std::string &nameServer);
+    void ClearCache();
+    void ShowResolverInfo(int fd);
+
+private:
+    struct CacheEntry {
+        std::vector<NtpAddress> addresses;
+        // boot time in ms
+        int64_t expireTime = 0;
+    };
+
+    NtpResolver() = default;
+    ~NtpResolver() = default;
+    static bool QuerySystem(const std::string &host, std::vector<NtpAddress> &addresses, int64_t &ttl);
+    static bool QueryNameServer(const NtpAddress &nameServer, const std::string &host,
+        std::vector<NtpAddress> &addresses, int64_t &ttl);
+    // needs to acquire the lock `mutex_` before calling this method
+    std::vector<NtpAddress> SortLocked(const std::vector<NtpAddress> &addresses);
+
+    std::mutex mutex_;
+    std::map<std::string, CacheEntry> cache_;
+    std::map<std::string, uint32_t> failures_;
+    NtpAddress nameServer_;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SNTP_CLIENT_NTP_RESOLVER_H
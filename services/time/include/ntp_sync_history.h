@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SNTP_CLIENT_NTP_SYNC_HISTORY_H
+#define SNTP_CLIENT_NTP_SYNC_HISTORY_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ntp_update_time.h"
+
+namespace OHOS {
+namespace MiscServices {
+enum class NtpSyncOutcome : uint8_t {
+    // answer of a specific server, taken unconditionally
+    SPECIFIC,
+    // agreed with the previous time result
+    AGREED,
+    // kept for the vote, which has not settled it
+    CANDIDATE,
+    // agreed with the majority of the vote
+    VOTED,
+    // disagreed with the majority of the vote
+    OUTVOTED,
+    TIMEOUT,
+    ERROR,
+    // the query succeeded before the server finished
+    CANCELLED,
+};
+
+struct NtpSyncRecord {
+    // wall time in ms when the server finished
+    int64_t time = 0;
+    uint64_t round = 0;
+    NtpUpdateSource source = INIT;
+    std::string server;
+    std::string address;
+    NtpSyncOutcome outcome = NtpSyncOutcome::TIMEOUT;
+    // -1 if no answer was received
+    int32_t stratum = -1;
+    uint32_t samples = 0;
+    // round trip time in ms, -1 if no answer was used
+    int64_t rtt = -1;
+    // server time minus local wall time in ms
+    int64_t offset = 0;
+    // time in ms from the start of the query until the server finished
+    int64_t answerTime = 0;
+};
+
+/**
+ * Bounded history of the NTP requests.
+ *
+ * Every server of every query leaves one record. A round is one sync started by NtpUpdateTime, it may run
+ * several queries, and its candidates are settled once the vote is done.
+ */
+class NtpSyncHistory {
+public:
+    static NtpSyncHistory &GetInstance();
+    // Starts a new round, the records added until the next one are attributed to `source`.
+    void BeginRound(NtpUpdateSource source);
+    void AddRecord(NtpSyncRecord record);
+    // Settles the candidate of `server` in the current round once the vote is done.
+    void SetVoteOutcome(const std::string &server, bool agreed);
+    void ShowSyncHistory(int fd);
+
+private:
+    NtpSyncHistory() = default;
+    ~NtpSyncHistory() = default;
+    // needs to acquire the lock `mutex_` before calling this method
+    std::vector<NtpSyncRecord> GetRecordsLocked();
+
+    std::mutex mutex_;
+    std::vector<NtpSyncRecord> records_;
+    // slot the next record is written to once the ring is full
+    size_t next_ = 0;
+    uint64_t round_ = 0;
+    NtpUpdateSource source_ = INIT;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SNTP_CLIENT_NTP_SYNC_HISTORY_H
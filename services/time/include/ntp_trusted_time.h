@@ -29,10 +29,18 @@ public:
     bool ForceRefreshTrusted(const std::string &ntpServer);
     int64_t GetCacheAge();
     int64_t CurrentTimeMillis();
+    // Boot time in ms of the last sync with a server, -1 while the result is only restored.
     int64_t ElapsedRealtimeMillis();
     std::chrono::steady_clock::time_point GetBootTimeNs();
     bool FindBestTimeResult();
     void ClearTimeResultCandidates();
+    // Returns true when more than half of `serverCount` candidates agree with each other.
+    bool HasTimeResultQuorum(size_t serverCount);
+    // Restores the time result saved before a reboot, its certainty grows with the time the RTC counted since.
+    void LoadTimeResult();
+    // Saves the time result together with the current RTC reading and boot id.
+    void SaveTimeResult();
+    void ShowTrustedTimeInfo(int fd);
     class TimeResult : std::enable_shared_from_this<TimeResult> {
     public:
         TimeResult();
@@ -43,6 +51,7 @@ public:
         int64_t GetElapsedRealtimeMillis();
         int64_t CurrentTimeMillis(int64_t bootTime);
         int64_t GetAgeMillis(int64_t bootTime);
+        int64_t GetCertaintyMillis();
         std::string GetNtpServer();
         void Clear();
 
@@ -55,11 +64,26 @@ public:
         std::string mNtpServer;
     };
     bool IsTimeResultTrusted(std::shared_ptr<TimeResult> timeResult);
+    // Takes the answer of a specific server as the time result unconditionally.
+    void UpdateTrustedTimeResult(std::shared_ptr<TimeResult> timeResult);
+    // Takes the answer of a normal server, returns false if it was only kept as a candidate.
+    bool UpdateTimeResult(std::shared_ptr<TimeResult> timeResult);
     int32_t GetSameTimeResultCount(std::shared_ptr<TimeResult> candidateTimeResult);
 
 private:
+    // needs to acquire the lock `mTimeResultMutex_` before calling this method
+    void SetTimeResultLocked(std::shared_ptr<TimeResult> timeResult);
+    // Saves the time result on the task executor, at most once per MIN_SAVE_GAP.
+    // needs to acquire the lock `mTimeResultMutex_` before calling this method
+    void ScheduleSaveLocked();
+
     std::shared_ptr<TimeResult> mTimeResult {};
     std::vector<std::shared_ptr<TimeResult>> TimeResultCandidates_ {};
+    // the time result was restored and not yet confirmed by a server
+    bool restored_ = false;
+    // boot time in ms of the last save, guarded by mTimeResultMutex_
+    int64_t lastSaveTime_ = 0;
+    std::mutex saveMutex_;
     static std::mutex mTimeResultMutex_;
 };
 } // namespace MiscServices
@@ -40,6 +40,7 @@ enum NtpUpdateSource {
     NTP_SERVER_CHANGE,
     AUTO_TIME_CHANGE,
     INIT,
+    GET_NTP_TIME,
 };
 
 class NtpUpdateTime {
@@ -48,6 +49,8 @@ public:
     static bool GetNtpTime(int64_t &time);
     static bool GetRealTime(int64_t &time);
     static void SetSystemTime(NtpUpdateSource code);
+    // Runs SetSystemTime on the task executor, a sync still waiting there absorbs this one.
+    static void SetSystemTimeAsync(NtpUpdateSource code);
     static bool IsInUpdateInterval();
     void RefreshNetworkTimeByTimer(uint64_t timerId);
     void UpdateNITZSetTime();
@@ -55,16 +58,17 @@ public:
     void Init();
     bool IsValidNITZTime();
     uint64_t GetNITZUpdateTime();
+    bool CheckStatus();
 
 private:
     NtpUpdateTime();
-    static NtpRefreshCode GetNtpTimeInner();
+    static NtpRefreshCode GetNtpTimeInner(NtpUpdateSource code);
     static bool CheckNeedSetTime(NtpRefreshCode code, int64_t time);
+    static void CorrectSystemTime();
     static bool GetRealTimeInner(int64_t &time);
     static void ChangeNtpServerCallback(const char *key, const char *value, void *context);
     static std::vector<std::string> SplitNtpAddrs(const std::string &ntpStr);
     static void RefreshNextTriggerTime(NtpUpdateSource code, bool isSuccess, bool isSwitchOpen);
-    bool CheckStatus();
     void RegisterSystemParameterListener();
     static void ChangeAutoTimeCallback(const char *key, const char *value, void *context);
 
@@ -18,6 +18,7 @@
 
 #include <string>
 #include <sys/types.h>
+#include <vector>
 
 namespace OHOS {
 namespace MiscServices {
@@ -27,6 +28,30 @@ public:
     int64_t getNtpTime();
     int64_t getNtpTimeReference();
     int64_t getRoundTripTime();
+    // Offset between the server wall clock and the local boot clock, in microseconds.
+    int64_t getClockOffsetUs();
+    int64_t getNtpTimeReferenceUs();
+    int64_t getRoundTripTimeUs();
+    // Stratum of the last answer, even a rejected one, -1 before the first answer.
+    int32_t getStratum();
+    // Whether the last answer was valid but matched none of the outstanding requests, e.g. a late duplicate.
+    bool isStaleAnswer();
+
+    /**
+    * This function creates the SNTP message ready for transmission (SNTP Req)
+    * and returns it back.
+    *
+    * @param buffer the message to be sent
+    */
+    void CreateMessage(char *buffer);
+
+    /**
+     * This function gets the information received from the SNTP response
+     * and prints the results (e.g. offset, round trip delay etc.)
+     *
+     * @param buffer the message received
+     */
+    bool ReceivedMessage(char *buffer);
 
 private:
     struct ntp_timestamp {
@@ -34,6 +59,13 @@ private:
         uint64_t fraction;
     };
 
+    // one request still waiting for its answer, identified by the transmit timestamp the server echoes
+    struct OutstandingRequest {
+        uint64_t transmitTimestamp;
+        // local boot time in us at which the request was created
+        int64_t originateUs;
+    };
+
     struct date_structure {
         int hour;
         int minute;
@@ -74,37 +106,20 @@ private:
      */
     void GetReferenceId(int offset, char *buffer, int *_outArray);
     /**
-     * This function sets the clock offset in ms.
-     * Negative value means the local clock is ahead,
-     * positive means the local clock is behind (relative to the NTP server)
+     * This function sets the clock offset in us.
+     * It is the server wall time minus the local boot time.
      *
-     * @param clockOffset the clock offset in ms
+     * @param clockOffset the clock offset in us
      */
-    void SetClockOffset(int clockOffset);
+    void SetClockOffset(int64_t clockOffset);
 
     /**
      * This function converts the UNIX time to NTP
      *
      * @param ntpTs the structure NTP where the NTP values are stored
-     * @param unixTs the structure UNIX (with the already set tv_sec and tv_usec)
+     * @param unixTs the structure UNIX (with the already set tv_sec and tv_nsec)
      */
-    void ConvertUnixToNtp(struct ntp_timestamp *ntpTs, struct timeval *unixTs);
-
-    /**
-    * This function creates the SNTP message ready for transmission (SNTP Req)
-    * and returns it back.
-    *
-    * @param buffer the message to be sent
-    */
-    void CreateMessage(char *buffer);
-
-    /**
-     * This function gets the information received from the SNTP response
-     * and prints the results (e.g. offset, round trip delay etc.)
-     *
-     * @param buffer the message received
-     */
-    bool ReceivedMessage(char *buffer);
+    void ConvertUnixToNtp(struct ntp_timestamp *ntpTs, struct timespec *unixTs);
 
     /**
      * This function returns the timestamp (64-bit) from the received
@@ -121,14 +136,19 @@ private:
      * This function converts the NTP time to timestamp
      *
      * @param _ntpTs the NTP timestamp to be converted
-     * Returns the milliseconds
+     * Returns the microseconds
      */
-    int64_t ConvertNtpToStamp(uint64_t _ntpTs);
+    int64_t ConvertNtpToStampUs(uint64_t _ntpTs);
     int64_t m_clockOffset;
-    int64_t m_originateTimestamp;
+    // retransmitted requests stay outstanding, a late answer to an earlier one is still matched
+    std::vector<OutstandingRequest> mOutstanding;
     int64_t mNtpTime;
     int64_t mNtpTimeReference;
     int64_t mRoundTripTime;
+    int64_t mNtpTimeReferenceUs;
+    int64_t mRoundTripTimeUs;
+    int32_t mStratum = -1;
+    bool mStaleAnswer = false;
 };
 } // namespace MiscServices
 } // namespace OHOS
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SNTP_CLIENT_SNTP_QUERY_ENGINE_H
+#define SNTP_CLIENT_SNTP_QUERY_ENGINE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+#include "clock_discipline.h"
+#include "ntp_resolver.h"
+#include "ntp_sync_history.h"
+#include "sntp_client.h"
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * Queries all configured NTP servers in parallel.
+ *
+ * Host names are resolved through NtpResolver on a few helper threads joined before returning, requests are sent on
+ * non-blocking UDP sockets and all answers are collected by one epoll loop bounded by a global deadline.
+ * The addresses of one server are raced happy eyeballs style, a further address is tried whenever the
+ * previous ones stay silent for a short delay. The answers are handed to NtpTrustedTime as they arrive,
+ * so the query stops at the first answer that can be trusted.
+ */
+class SntpQueryEngine {
+public:
+    static SntpQueryEngine &GetInstance();
+    /**
+     * Sends one request to every server at once.
+     *
+     * Returns true as soon as a specific server answers, a normal server agrees with the current time result
+     * or a majority of the normal servers agree with each other. Returns false when `timeoutMs` has passed or
+     * every server has failed, the collected candidates are left to NtpTrustedTime::FindBestTimeResult.
+     */
+    bool Query(const std::vector<std::string> &specServers, const std::vector<std::string> &servers,
+        int64_t timeoutMs);
+    void ShowServerStats(int fd);
+
+private:
+    struct ServerStats {
+        uint64_t requests = 0;
+        uint64_t answers = 0;
+        uint64_t timeouts = 0;
+        uint64_t errors = 0;
+        int64_t lastRtt = 0;
+        int64_t minRtt = 0;
+        int64_t maxRtt = 0;
+        int64_t totalRtt = 0;
+    };
+
+    struct Attempt {
+        int fd = -1;
+        NtpAddress address;
+        SNTPClient client;
+    };
+
+    struct Request {
+        std::string server;
+        bool trusted = false;
+        bool finished = false;
+        std::vector<NtpAddress> addresses;
+        size_t nextAddress = 0;
+        // boot time in ms at which the next address joins the race
+        int64_t nextAttemptTime = 0;
+        std::vector<Attempt> attempts;
+        // the attempt which answered first, all further samples are taken from it
+        int32_t winner = -1;
+        // boot time in ms after which the collected samples are used as they are, or the request is resent
+        int64_t sampleDeadline = 0;
+        uint32_t retransmits = 0;
+        std::vector<NtpSample> samples;
+        // set once the samples have been handed to NtpTrustedTime
+        bool completed = false;
+        NtpSample result;
+        NtpSyncOutcome outcome = NtpSyncOutcome::TIMEOUT;
+        int32_t stratum = -1;
+    };
+
+    struct QueryContext {
+        int epollFd = -1;
+        // number of normal servers, the quorum is a majority of them
+        size_t serverCount = 0;
+        // set once the query may stop
+        bool success = false;
+        // boot time in ms at which the query started
+        int64_t startTime = 0;
+    };
+
+    struct ResolveState;
+
+    SntpQueryEngine() = default;
+    ~SntpQueryEngine() = default;
+    // Resolves the hosts of `state` one after another, several of these run side by side.
+    static void Resolve(std::shared_ptr<ResolveState> state);
+    // Starts an attempt on the next address that can be sent to, returns false if none is left.
+    bool StartAttempt(Request &request, size_t index, QueryContext &context);
+    bool SendSample(Request &request, Attempt &attempt);
+    // Resends the request on every live attempt, all addresses have been tried and none has answered.
+    // The earlier requests stay outstanding in each client, whichever answer arrives first is used.
+    void Retransmit(Request &request);
+    // Returns true when the request is finished.
+    bool HandleAnswer(Request &request, size_t index, size_t attemptIndex, QueryContext &context);
+    void CompleteRequest(Request &request, QueryContext &context);
+    static bool HasLiveAttempt(const Request &request);
+    static void CloseAttempt(Attempt &attempt, int epollFd);
+    // Closes all attempts, the ones still waiting for an answer are demoted if `isTimeout` is set.
+    static void FinishRequest(Request &request, const QueryContext &context, bool isTimeout);
+    static void AddSyncRecord(const Request &request, const QueryContext &context);
+    void RecordAnswer(const std::string &server, int64_t rtt);
+    void RecordFailure(const std::string &server, bool isTimeout);
+
+    std::mutex statsMutex_;
+    std::map<std::string, ServerStats> serverStats_;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SNTP_CLIENT_SNTP_QUERY_ENGINE_H
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_SOURCE_ARBITER_H
+#define TIME_SOURCE_ARBITER_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+namespace OHOS {
+namespace MiscServices {
+enum class TimeSource : uint8_t {
+    NITZ,
+    NTP,
+    RTC,
+};
+
+/**
+ * Arbitrates between the time sources of the device.
+ *
+ * Every source leaves its last sample anchored at the boot clock, together with its error bound, which grows
+ * with the drift bound of NtpDriftModel as the sample ages. The samples consistent with the most certain one
+ * are fused by inverse variance weighting. A correction is skipped while the clock is within the error bound
+ * of the estimate, and at most one clock step is taken per correction window, a later one is deferred to the
+ * end of the window and reconsidered then.
+ */
+class TimeSourceArbiter {
+public:
+    static TimeSourceArbiter &GetInstance();
+    // Takes the RTC sample the system clock was set from at boot.
+    void Init();
+    // Keeps `time` in ms as read by `source` at `bootTime`, `uncertainty` is its error bound in ms.
+    void UpdateSample(TimeSource source, int64_t time, int64_t bootTime, int64_t uncertainty);
+    // Returns false if there is no sample, otherwise the fused wall time at `bootTime` and its error bound.
+    bool GetEstimate(int64_t bootTime, int64_t &time, int64_t &uncertainty);
+    // Brings the system clock to the estimate on behalf of `source`, returns true if the clock was corrected.
+    bool Correct(TimeSource source);
+    // Called after every step of the system clock, whoever took it.
+    void OnClockStepped(int64_t bootTime);
+    void ShowArbitrationInfo(int fd);
+
+private:
+    static constexpr size_t TIME_SOURCE_COUNT = static_cast<size_t>(TimeSource::RTC) + 1;
+
+    struct Sample {
+        int64_t time = 0;
+        int64_t bootTime = 0;
+        int64_t uncertainty = 0;
+        uint64_t updates = 0;
+    };
+
+    TimeSourceArbiter() = default;
+    ~TimeSourceArbiter() = default;
+    // needs to acquire the lock `mutex_` before calling this method
+    bool GetEstimateLocked(int64_t bootTime, int64_t &time, int64_t &uncertainty);
+    static int64_t GetUncertainty(const Sample &sample, int64_t bootTime);
+
+    std::mutex mutex_;
+    // serializes corrections, it is never held together with `mutex_` while the clock is set
+    std::mutex correctMutex_;
+    std::array<Sample, TIME_SOURCE_COUNT> samples_;
+    // boot time in ms of the last step, 0 if the clock has not been stepped since the start
+    int64_t lastStepTime_ = 0;
+    int64_t lastOffset_ = 0;
+    uint64_t steps_ = 0;
+    uint64_t slews_ = 0;
+    uint64_t skipped_ = 0;
+    uint64_t deferred_ = 0;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // TIME_SOURCE_ARBITER_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "clock_discipline.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <sys/timex.h>
+
+#include "time_common.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr int64_t MILLI_TO_MICRO = 1000;
+constexpr size_t HALF = 2;
+// the kernel slews at most 500ppm, one second is caught up in about half an hour
+constexpr int64_t STEP_THRESHOLD = 1000;
+}
+
+ClockDiscipline &ClockDiscipline::GetInstance()
+{
+    static ClockDiscipline instance;
+    return instance;
+}
+
+NtpSample ClockDiscipline::CombineSamples(std::vector<NtpSample> samples)
+{
+    if (samples.empty()) {
+        return {};
+    }
+    std::sort(samples.begin(), samples.end(), [](const NtpSample &a, const NtpSample &b) {
+        return a.delayUs < b.delayUs;
+    });
+    // queueing only ever adds delay, the fastest exchanges carry the least asymmetry error
+    size_t count = (samples.size() + 1) / HALF;
+    NtpSample result = samples[0];
+    int64_t offsetSum = 0;
+    for (size_t i = 0; i < count; i++) {
+        offsetSum += samples[i].offsetUs - result.offsetUs;
+        result.referenceUs = std::max(result.referenceUs, samples[i].referenceUs);
+    }
+    result.offsetUs += offsetSum / static_cast<int64_t>(count);
+    return result;
+}
+
+bool ClockDiscipline::Slew(int64_t time)
+{
+    int64_t currentTime = 0;
+    if (TimeUtils::GetWallTimeMs(currentTime) != ERR_OK) {
+        return false;
+    }
+    int64_t offset = time - currentTime;
+    std::lock_guard<std::mutex> lock(mutex_);
+    lastOffset_ = offset;
+    if (std::abs(offset) >= STEP_THRESHOLD) {
+        steps_++;
+        return false;
+    }
+    struct timex tx {};
+    // replaces any slew still in progress, the offset is measured against the already slewed clock
+    tx.modes = ADJ_OFFSET_SINGLESHOT;
+    tx.offset = static_cast<long>(offset * MILLI_TO_MICRO);
+    if (adjtimex(&tx) < 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "adjtimex failed: %{public}s", strerror(errno));
+        steps_++;
+        return false;
+    }
+    slews_++;
+    totalSlew_ += offset;
+    TIME_HILOGI(TIME_MODULE_SERVICE, "slew wall clock by %{public}" PRId64 "ms", offset);
+    return true;
+}
+
+int64_t ClockDiscipline::GetTotalSlew()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalSlew_;
+}
+
+void ClockDiscipline::ShowClockDisciplineInfo(int fd)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    dprintf(fd, " * clock slews             = %" PRIu64 "\n", slews_);
+    dprintf(fd, " * clock steps             = %" PRIu64 "\n", steps_);
+    dprintf(fd, " * last offset             = %" PRId64 "ms\n", lastOffset_);
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -13,7 +13,6 @@
  * limitations under the License.
  */
 
-#include <thread>
 #include "event_manager.h"
 #include "ntp_update_time.h"
 #include "time_tick_notify.h"
@@ -73,9 +72,7 @@ void EventManager::NetConnStateConnected(const CommonEventData &data)
     if (NtpUpdateTime::IsInUpdateInterval()) {
         NtpUpdateTime::SetSystemTime(NtpUpdateSource::NET_CONNECTED);
     } else {
-        auto setSystemTime = [this]() { NtpUpdateTime::SetSystemTime(NtpUpdateSource::NET_CONNECTED); };
-        std::thread thread(setSystemTime);
-        thread.detach();
+        NtpUpdateTime::SetSystemTimeAsync(NtpUpdateSource::NET_CONNECTED);
     }
 }
 
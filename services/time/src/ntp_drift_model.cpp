@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ntp_drift_model.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "clock_discipline.h"
+#include "parameters.h"
+#include "time_common.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr const char* NTP_DRIFT_SYSTEM_PARAMETER = "persist.time.ntp_drift";
+constexpr int64_t ONE_HOUR = 3600000;
+constexpr int64_t ONE_DAY = 86400000;
+constexpr int64_t MILLI_TO_SEC = 1000;
+constexpr double PPM = 1000000.0;
+// used until the first drift has been learned, these are the former fixed values
+constexpr int64_t DEFAULT_SYNC_INTERVAL = 12 * ONE_HOUR;
+constexpr int64_t DEFAULT_MAX_DRIFT = 2000;
+// RTC has approximate 2s error per day
+constexpr double DEFAULT_DRIFT_PPM = DEFAULT_MAX_DRIFT * PPM / ONE_DAY;
+// the error a time result may reach before it is refreshed, below the slew threshold
+constexpr int64_t ACCURACY_TARGET = 500;
+constexpr int64_t MIN_SYNC_INTERVAL = ONE_HOUR;
+constexpr int64_t MAX_SYNC_INTERVAL = 3 * ONE_DAY;
+// no oscillator is trusted to be better than this
+constexpr double MIN_DRIFT_PPM = 2.0;
+// added to the learned drift when judging a new result
+constexpr double DRIFT_MARGIN_PPM = 5.0;
+// a larger rate comes from a wrong result rather than from the oscillator
+constexpr double MAX_DRIFT_PPM = 500.0;
+// ms resolution and network delay need a baseline of hours to resolve a few ppm
+constexpr int64_t MIN_SAMPLE_GAP = 4 * ONE_HOUR;
+constexpr double MAX_SAMPLE_NOISE_PPM = 20.0;
+constexpr double SMOOTHING = 0.3;
+constexpr int32_t UPDATE_GAP_DIVISOR = 4;
+constexpr int32_t RESULT_AGE_MULTIPLE = 2;
+
+int64_t SyncInterval(double driftPpm, uint32_t samples)
+{
+    if (samples == 0) {
+        return DEFAULT_SYNC_INTERVAL;
+    }
+    auto interval = static_cast<int64_t>(ACCURACY_TARGET * PPM / std::max(std::abs(driftPpm), MIN_DRIFT_PPM));
+    return std::clamp(interval, MIN_SYNC_INTERVAL, MAX_SYNC_INTERVAL);
+}
+
+int64_t DriftBound(double driftPpm, uint32_t samples, int64_t elapsed)
+{
+    double boundPpm = (samples == 0) ? DEFAULT_DRIFT_PPM : std::abs(driftPpm) + DRIFT_MARGIN_PPM;
+    return static_cast<int64_t>(boundPpm * elapsed / PPM);
+}
+
+int64_t MaxDrift(double driftPpm, uint32_t samples, int64_t elapsed)
+{
+    if (samples == 0) {
+        return DEFAULT_MAX_DRIFT;
+    }
+    return ACCURACY_TARGET + DriftBound(driftPpm, samples, elapsed);
+}
+
+int64_t MaxResultAge(double driftPpm, uint32_t samples)
+{
+    if (samples == 0) {
+        return ONE_DAY;
+    }
+    return std::max(ONE_DAY, RESULT_AGE_MULTIPLE * SyncInterval(driftPpm, samples));
+}
+}
+
+NtpDriftModel &NtpDriftModel::GetInstance()
+{
+    static NtpDriftModel instance;
+    return instance;
+}
+
+void NtpDriftModel::Init()
+{
+    // stored as "<drift ppm>,<samples>"
+    std::string value = system::GetParameter(NTP_DRIFT_SYSTEM_PARAMETER, "");
+    size_t comma = value.find(',');
+    if (comma == std::string::npos) {
+        return;
+    }
+    double driftPpm = std::strtod(value.c_str(), nullptr);
+    auto samples = static_cast<uint32_t>(std::strtoul(value.c_str() + comma + 1, nullptr, 0));
+    if (std::isnan(driftPpm) || std::abs(driftPpm) > MAX_DRIFT_PPM) {
+        TIME_HILOGW(TIME_MODULE_SERVICE, "drop invalid drift:%{public}s", value.c_str());
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    driftPpm_ = driftPpm;
+    samples_ = samples;
+    TIME_HILOGI(TIME_MODULE_SERVICE, "drift:%{public}.3fppm samples:%{public}u", driftPpm_, samples_);
+}
+
+void NtpDriftModel::AddSample(int64_t bootTime, int64_t ntpTime, int64_t certainty)
+{
+    int64_t slew = ClockDiscipline::GetInstance().GetTotalSlew();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (lastBootTime_ > 0) {
+        int64_t gap = bootTime - lastBootTime_;
+        // the older anchor is kept, a longer baseline gives a better estimate
+        if (gap < MIN_SAMPLE_GAP) {
+            return;
+        }
+        double noisePpm = static_cast<double>(certainty + lastCertainty_) * PPM / gap;
+        if (noisePpm > MAX_SAMPLE_NOISE_PPM) {
+            TIME_HILOGI(TIME_MODULE_SERVICE, "drift sample too noisy:%{public}.3fppm", noisePpm);
+            return;
+        }
+        // slewing moves the boot clock too, so the applied slews are taken out of the boot clock delta
+        int64_t error = (ntpTime - lastNtpTime_) - (gap - (slew - lastSlew_));
+        double driftPpm = static_cast<double>(error) * PPM / gap;
+        if (std::abs(driftPpm) > MAX_DRIFT_PPM) {
+            TIME_HILOGW(TIME_MODULE_SERVICE, "drop drift sample:%{public}.3fppm", driftPpm);
+        } else {
+            driftPpm_ = (samples_ == 0) ? driftPpm : driftPpm_ + SMOOTHING * (driftPpm - driftPpm_);
+            samples_++;
+            SaveLocked();
+            TIME_HILOGI(TIME_MODULE_SERVICE, "drift sample:%{public}.3fppm model:%{public}.3fppm", driftPpm,
+                driftPpm_);
+        }
+    }
+    lastBootTime_ = bootTime;
+    lastNtpTime_ = ntpTime;
+    lastCertainty_ = certainty;
+    lastSlew_ = slew;
+}
+
+void NtpDriftModel::SaveLocked()
+{
+    std::string value = std::to_string(driftPpm_) + "," + std::to_string(samples_);
+    if (!system::SetParameter(NTP_DRIFT_SYSTEM_PARAMETER, value)) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "save drift failed");
+    }
+}
+
+int64_t NtpDriftModel::GetSyncInterval()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return SyncInterval(driftPpm_, samples_);
+}
+
+int64_t NtpDriftModel::GetMinUpdateGap()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (samples_ == 0) {
+        return ONE_HOUR;
+    }
+    int64_t interval = SyncInterval(driftPpm_, samples_);
+    return std::clamp(interval / UPDATE_GAP_DIVISOR, ONE_HOUR, interval);
+}
+
+int64_t NtpDriftModel::GetMaxDrift(int64_t elapsed)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return MaxDrift(driftPpm_, samples_, elapsed);
+}
+
+int64_t NtpDriftModel::GetDriftBound(int64_t elapsed)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return DriftBound(driftPpm_, samples_, elapsed);
+}
+
+int64_t NtpDriftModel::GetMaxResultAge()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return MaxResultAge(driftPpm_, samples_);
+}
+
+void NtpDriftModel::ShowDriftModelInfo(int fd)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    dprintf(fd, " * drift                   = %.3fppm\n", driftPpm_);
+    dprintf(fd, " * drift samples           = %u\n", samples_);
+    dprintf(fd, " * sync interval           = %" PRId64 "s\n", SyncInterval(driftPpm_, samples_) / MILLI_TO_SEC);
+    dprintf(fd, " * max drift in one day    = %" PRId64 "ms\n", MaxDrift(driftPpm_, samples_, ONE_DAY));
+    dprintf(fd, " * max result age          = %" PRId64 "s\n", MaxResultAge(driftPpm_, samples_) / MILLI_TO_SEC);
+}
+} // namespace MiscServices
+} // namespace OHOS
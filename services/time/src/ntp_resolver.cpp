@@ -0,0 +1,451 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ntp_resolver.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <netdb.h>
+#include <poll.h>
+#include <random>
+#include <securec.h>
+#include <unistd.h>
+
+#include "time_common.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr const char* NTP_PORT = "123";
+constexpr uint16_t NTP_PORT_NUMBER = 123;
+constexpr uint16_t DNS_PORT = 53;
+constexpr uint16_t DNS_TYPE_A = 1;
+constexpr uint16_t DNS_TYPE_AAAA = 28;
+constexpr uint16_t DNS_CLASS_IN = 1;
+constexpr uint16_t DNS_FLAG_RECURSION_DESIRED = 0x0100;
+constexpr uint16_t DNS_FLAG_RESPONSE = 0x8000;
+constexpr uint16_t DNS_RCODE_MASK = 0x000F;
+constexpr uint8_t DNS_POINTER_MASK = 0xC0;
+constexpr size_t DNS_HEADER_SIZE = 12;
+constexpr size_t DNS_RECORD_HEADER_SIZE = 10;
+constexpr size_t DNS_QUESTION_TAIL_SIZE = 4;
+constexpr size_t DNS_POINTER_SIZE = 2;
+constexpr size_t DNS_MAX_LABEL = 63;
+constexpr size_t DNS_MAX_PACKET = 512;
+constexpr size_t IPV4_SIZE = 4;
+constexpr size_t IPV6_SIZE = 16;
+constexpr int DNS_TIMEOUT = 2000;
+constexpr int64_t MILLI_TO_SEC = 1000;
+// the system resolver does not expose the TTL
+constexpr int64_t SYSTEM_RESOLVE_TTL = 600000;
+constexpr int64_t MIN_TTL = 30000;
+constexpr int64_t MAX_TTL = 86400000;
+constexpr int ONE_BYTE = 8;
+constexpr int TWO_BYTES = 16;
+constexpr int THREE_BYTES = 24;
+constexpr size_t INDEX_TWO = 2;
+constexpr size_t INDEX_THREE = 3;
+constexpr size_t INDEX_FOUR = 4;
+constexpr size_t INDEX_SIX = 6;
+constexpr size_t INDEX_EIGHT = 8;
+
+uint16_t ReadUint16(const uint8_t *buffer)
+{
+    return static_cast<uint16_t>((buffer[0] << ONE_BYTE) | buffer[1]);
+}
+
+uint32_t ReadUint32(const uint8_t *buffer)
+{
+    return (static_cast<uint32_t>(buffer[0]) << THREE_BYTES) | (static_cast<uint32_t>(buffer[1]) << TWO_BYTES) |
+        (static_cast<uint32_t>(buffer[INDEX_TWO]) << ONE_BYTE) | buffer[INDEX_THREE];
+}
+
+void WriteUint16(std::vector<uint8_t> &buffer, uint16_t value)
+{
+    buffer.push_back(static_cast<uint8_t>(value >> ONE_BYTE));
+    buffer.push_back(static_cast<uint8_t>(value));
+}
+
+bool ParseAddress(const std::string &ip, uint16_t port, NtpAddress &address)
+{
+    auto *addr4 = reinterpret_cast<struct sockaddr_in *>(&address.addr);
+    auto *addr6 = reinterpret_cast<struct sockaddr_in6 *>(&address.addr);
+    if (inet_pton(AF_INET, ip.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(port);
+        address.addrLen = sizeof(struct sockaddr_in);
+        return true;
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        address.addrLen = sizeof(struct sockaddr_in6);
+        return true;
+    }
+    return false;
+}
+
+// Accepts "ip", "ip:port" and "[v6]:port", a bare IPv6 address has more than one colon.
+bool ParseAddressWithPort(const std::string &text, uint16_t defaultPort, NtpAddress &address)
+{
+    std::string ip = text;
+    uint16_t port = defaultPort;
+    size_t colon = text.rfind(':');
+    if (!text.empty() && text.front() == '[') {
+        size_t end = text.find(']');
+        ip = text.substr(1, end == std::string::npos ? std::string::npos : end - 1);
+        if (end != std::string::npos && colon == end + 1) {
+            port = static_cast<uint16_t>(std::atoi(text.c_str() + colon + 1));
+        }
+    } else if (colon != std::string::npos && text.find(':') == colon) {
+        ip = text.substr(0, colon);
+        port = static_cast<uint16_t>(std::atoi(text.c_str() + colon + 1));
+    }
+    return ParseAddress(ip, port, address);
+}
+
+bool BuildQuery(const std::string &host, uint16_t id, uint16_t type, std::vector<uint8_t> &query)
+{
+    WriteUint16(query, id);
+    WriteUint16(query, DNS_FLAG_RECURSION_DESIRED);
+    // one question, no answer, authority or additional records
+    WriteUint16(query, 1);
+    WriteUint16(query, 0);
+    WriteUint16(query, 0);
+    WriteUint16(query, 0);
+    size_t start = 0;
+    while (start < host.size()) {
+        size_t end = host.find('.', start);
+        if (end == std::string::npos) {
+            end = host.size();
+        }
+        size_t labelLen = end - start;
+        if (labelLen == 0 || labelLen > DNS_MAX_LABEL) {
+            return false;
+        }
+        query.push_back(static_cast<uint8_t>(labelLen));
+        query.insert(query.end(), host.begin() + start, host.begin() + end);
+        start = end + 1;
+    }
+    query.push_back(0);
+    WriteUint16(query, type);
+    WriteUint16(query, DNS_CLASS_IN);
+    return true;
+}
+
+bool SkipName(const uint8_t *buffer, size_t len, size_t &pos)
+{
+    while (pos < len) {
+        uint8_t labelLen = buffer[pos];
+        if ((labelLen & DNS_POINTER_MASK) == DNS_POINTER_MASK) {
+            pos += DNS_POINTER_SIZE;
+            return pos <= len;
+        }
+        pos++;
+        if (labelLen == 0) {
+            return true;
+        }
+        pos += labelLen;
+    }
+    return false;
+}
+
+bool ParseAnswer(const uint8_t *buffer, size_t len, uint16_t id, std::vector<NtpAddress> &addresses, int64_t &ttl)
+{
+    if (len < DNS_HEADER_SIZE || ReadUint16(buffer) != id) {
+        return false;
+    }
+    uint16_t flags = ReadUint16(buffer + INDEX_TWO);
+    if ((flags & DNS_FLAG_RESPONSE) == 0 || (flags & DNS_RCODE_MASK) != 0) {
+        return false;
+    }
+    uint16_t questions = ReadUint16(buffer + INDEX_FOUR);
+    uint16_t answers = ReadUint16(buffer + INDEX_SIX);
+    size_t pos = DNS_HEADER_SIZE;
+    for (uint16_t i = 0; i < questions; i++) {
+        if (!SkipName(buffer, len, pos)) {
+            return false;
+        }
+        pos += DNS_QUESTION_TAIL_SIZE;
+    }
+    for (uint16_t i = 0; i < answers; i++) {
+        if (!SkipName(buffer, len, pos) || pos + DNS_RECORD_HEADER_SIZE > len) {
+            return false;
+        }
+        uint16_t type = ReadUint16(buffer + pos);
+        uint16_t cls = ReadUint16(buffer + pos + INDEX_TWO);
+        int64_t recordTtl = static_cast<int64_t>(ReadUint32(buffer + pos + INDEX_FOUR)) * MILLI_TO_SEC;
+        uint16_t dataLen = ReadUint16(buffer + pos + INDEX_EIGHT);
+        pos += DNS_RECORD_HEADER_SIZE;
+        if (pos + dataLen > len) {
+            return false;
+        }
+        // CNAME records are skipped, the recursive resolver appends the records they point to
+        NtpAddress address;
+        if (cls == DNS_CLASS_IN && type == DNS_TYPE_A && dataLen == IPV4_SIZE) {
+            auto *addr4 = reinterpret_cast<struct sockaddr_in *>(&address.addr);
+            addr4->sin_family = AF_INET;
+            addr4->sin_port = htons(NTP_PORT_NUMBER);
+            memcpy_s(&addr4->sin_addr, sizeof(addr4->sin_addr), buffer + pos, IPV4_SIZE);
+            address.addrLen = sizeof(struct sockaddr_in);
+        } else if (cls == DNS_CLASS_IN && type == DNS_TYPE_AAAA && dataLen == IPV6_SIZE) {
+            auto *addr6 = reinterpret_cast<struct sockaddr_in6 *>(&address.addr);
+            addr6->sin6_family = AF_INET6;
+            addr6->sin6_port = htons(NTP_PORT_NUMBER);
+            memcpy_s(&addr6->sin6_addr, sizeof(addr6->sin6_addr), buffer + pos, IPV6_SIZE);
+            address.addrLen = sizeof(struct sockaddr_in6);
+        }
+        if (address.addrLen > 0) {
+            addresses.push_back(address);
+            ttl = (ttl == 0) ? recordTtl : std::min(ttl, recordTtl);
+        }
+        pos += dataLen;
+    }
+    return true;
+}
+}
+
+std::string NtpAddress::ToString() const
+{
+    char buffer[INET6_ADDRSTRLEN] = { 0 };
+    const void *src = nullptr;
+    if (addr.ss_family == AF_INET) {
+        src = &reinterpret_cast<const struct sockaddr_in *>(&addr)->sin_addr;
+    } else if (addr.ss_family == AF_INET6) {
+        src = &reinterpret_cast<const struct sockaddr_in6 *>(&addr)->sin6_addr;
+    }
+    if (src == nullptr || inet_ntop(addr.ss_family, src, buffer, sizeof(buffer)) == nullptr) {
+        return "";
+    }
+    return buffer;
+}
+
+NtpResolver &NtpResolver::GetInstance()
+{
+    static NtpResolver instance;
+    return instance;
+}
+
+std::vector<NtpAddress> NtpResolver::Resolve(const std::string &host)
+{
+    NtpAddress literal;
+    if (ParseAddressWithPort(host, NTP_PORT_NUMBER, literal)) {
+        return { literal };
+    }
+    int64_t now = 0;
+    TimeUtils::GetBootTimeMs(now);
+    NtpAddress nameServer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(host);
+        if (it != cache_.end() && it->second.expireTime > now) {
+            return SortLocked(it->second.addresses);
+        }
+        nameServer = nameServer_;
+    }
+    std::vector<NtpAddress> addresses;
+    int64_t ttl = 0;
+    bool isSuccess = (nameServer.addrLen > 0) ? QueryNameServer(nameServer, host, addresses, ttl) :
+        QuerySystem(host, addresses, ttl);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!isSuccess || addresses.empty()) {
+        // an expired answer is still worth a try when the resolver is unreachable
+        auto it = cache_.find(host);
+        if (it != cache_.end()) {
+            TIME_HILOGW(TIME_MODULE_SERVICE, "resolve %{public}s failed, use expired answer", host.c_str());
+            return SortLocked(it->second.addresses);
+        }
+        return {};
+    }
+    auto &entry = cache_[host];
+    entry.addresses = addresses;
+    entry.expireTime = now + std::clamp(ttl, MIN_TTL, MAX_TTL);
+    return SortLocked(addresses);
+}
+
+bool NtpResolver::QuerySystem(const std::string &host, std::vector<NtpAddress> &addresses, int64_t &ttl)
+{
+    struct addrinfo hints = { 0 };
+    struct addrinfo *addrs = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    hints.ai_flags = AI_ADDRCONFIG;
+    int error = getaddrinfo(host.c_str(), NTP_PORT, &hints, &addrs);
+    if (error != 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "getaddrinfo failed error %{public}d host %{public}s", error, host.c_str());
+        return false;
+    }
+    for (auto *info = addrs; info != nullptr; info = info->ai_next) {
+        NtpAddress address;
+        if (memcpy_s(&address.addr, sizeof(address.addr), info->ai_addr, info->ai_addrlen) != EOK) {
+            continue;
+        }
+        address.addrLen = info->ai_addrlen;
+        auto name = address.ToString();
+        if (std::none_of(addresses.begin(), addresses.end(),
+            [&name](const NtpAddress &item) { return item.ToString() == name; })) {
+            addresses.push_back(address);
+        }
+    }
+    freeaddrinfo(addrs);
+    ttl = SYSTEM_RESOLVE_TTL;
+    return true;
+}
+
+bool NtpResolver::QueryNameServer(const NtpAddress &nameServer, const std::string &host,
+    std::vector<NtpAddress> &addresses, int64_t &ttl)
+{
+    thread_local std::mt19937 engine(std::random_device {}());
+    uint16_t ids[] = { static_cast<uint16_t>(engine()), static_cast<uint16_t>(engine()) };
+    uint16_t types[] = { DNS_TYPE_A, DNS_TYPE_AAAA };
+    bool done[] = { false, false };
+    int fd = socket(nameServer.addr.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (fd < 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "create socket failed: %{public}s", strerror(errno));
+        return false;
+    }
+    if (connect(fd, reinterpret_cast<const struct sockaddr *>(&nameServer.addr), nameServer.addrLen) < 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "socket connect failed: %{public}s", strerror(errno));
+        close(fd);
+        return false;
+    }
+    size_t pending = 0;
+    for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+        std::vector<uint8_t> query;
+        if (!BuildQuery(host, ids[i], types[i], query) || send(fd, query.data(), query.size(), 0) < 0) {
+            TIME_HILOGE(TIME_MODULE_SERVICE, "send dns query failed, host %{public}s", host.c_str());
+            continue;
+        }
+        pending++;
+    }
+    int64_t now = 0;
+    TimeUtils::GetBootTimeMs(now);
+    int64_t deadline = now + DNS_TIMEOUT;
+    bool answered = false;
+    while (pending > 0 && now < deadline) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ret = poll(&pfd, 1, static_cast<int>(deadline - now));
+        if (ret < 0 && errno != EINTR) {
+            break;
+        }
+        if (ret > 0) {
+            uint8_t buffer[DNS_MAX_PACKET] = { 0 };
+            ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+            if (len < 0) {
+                TIME_HILOGE(TIME_MODULE_SERVICE, "recv dns answer failed: %{public}s", strerror(errno));
+                break;
+            }
+            for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+                if (done[i] || static_cast<size_t>(len) < DNS_HEADER_SIZE || ReadUint16(buffer) != ids[i]) {
+                    continue;
+                }
+                // an error answer, e.g. no AAAA record, still completes its query
+                answered = ParseAnswer(buffer, static_cast<size_t>(len), ids[i], addresses, ttl) || answered;
+                done[i] = true;
+                pending--;
+                break;
+            }
+        }
+        TimeUtils::GetBootTimeMs(now);
+    }
+    close(fd);
+    return answered;
+}
+
+std::vector<NtpAddress> NtpResolver::SortLocked(const std::vector<NtpAddress> &addresses)
+{
+    std::vector<NtpAddress> families[2];
+    for (const auto &address : addresses) {
+        families[address.addr.ss_family == AF_INET6 ? 0 : 1].push_back(address);
+    }
+    auto getFailures = [this](const NtpAddress &address) {
+        auto it = failures_.find(address.ToString());
+        return it == failures_.end() ? 0 : it->second;
+    };
+    for (auto &family : families) {
+        std::stable_sort(family.begin(), family.end(), [&getFailures](const NtpAddress &a, const NtpAddress &b) {
+            return getFailures(a) < getFailures(b);
+        });
+    }
+    // IPv6 goes first unless its best address has failed more often than the best IPv4 one
+    size_t first = 0;
+    if (families[0].empty() ||
+        (!families[1].empty() && getFailures(families[1].front()) < getFailures(families[0].front()))) {
+        first = 1;
+    }
+    std::vector<NtpAddress> result;
+    for (size_t i = 0; i < std::max(families[0].size(), families[1].size()); i++) {
+        for (size_t family : { first, 1 - first }) {
+            if (i < families[family].size()) {
+                result.push_back(families[family][i]);
+            }
+        }
+    }
+    return result;
+}
+
+void NtpResolver::ReportResult(const NtpAddress &address, bool success)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (success) {
+        failures_.erase(address.ToString());
+    } else {
+        failures_[address.ToString()]++;
+    }
+}
+
+void NtpResolver::SetNameServer(const std::string &nameServer)
+{
+    NtpAddress address;
+    if (!nameServer.empty() && !ParseAddressWithPort(nameServer, DNS_PORT, address)) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "invalid name server %{public}s", nameServer.c_str());
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    nameServer_ = address;
+    cache_.clear();
+}
+
+void NtpResolver::ClearCache()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.clear();
+    failures_.clear();
+}
+
+void NtpResolver::ShowResolverInfo(int fd)
+{
+    int64_t now = 0;
+    TimeUtils::GetBootTimeMs(now);
+    std::lock_guard<std::mutex> lock(mutex_);
+    dprintf(fd, " * name server             = %s\n",
+        nameServer_.addrLen > 0 ? nameServer_.ToString().c_str() : "system");
+    for (const auto &[host, entry] : cache_) {
+        dprintf(fd, " * host                    = %s\n", host.c_str());
+        dprintf(fd, "   * expire in             = %" PRId64 "s\n",
+            entry.expireTime > now ? (entry.expireTime - now) / MILLI_TO_SEC : 0);
+        for (const auto &address : entry.addresses) {
+            auto it = failures_.find(address.ToString());
+            dprintf(fd, "   * address               = %s, failures = %u\n", address.ToString().c_str(),
+                it == failures_.end() ? 0 : it->second);
+        }
+    }
+}
+} // namespace MiscServices
+} // namespace OHOS
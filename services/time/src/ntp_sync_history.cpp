@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ntp_sync_history.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+#include <map>
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr size_t MAX_RECORDS = 128;
+constexpr int64_t MILLI_TO_SEC = 1000;
+constexpr size_t PERCENT = 100;
+constexpr size_t P50 = 50;
+constexpr size_t P90 = 90;
+constexpr size_t OUTCOME_COUNT = static_cast<size_t>(NtpSyncOutcome::CANCELLED) + 1;
+constexpr const char *OUTCOME_NAMES[OUTCOME_COUNT] = {
+    "specific", "agreed", "candidate", "voted", "outvoted", "timeout", "error", "cancelled",
+};
+
+const char *GetSourceName(NtpUpdateSource source)
+{
+    switch (source) {
+        case RETRY_BY_TIMER:
+            return "timer";
+        case REGISTER_SUBSCRIBER:
+            return "subscriber";
+        case NET_CONNECTED:
+            return "net_connected";
+        case NTP_SERVER_CHANGE:
+            return "server_change";
+        case AUTO_TIME_CHANGE:
+            return "auto_time_change";
+        case INIT:
+            return "init";
+        case GET_NTP_TIME:
+            return "get_ntp_time";
+        default:
+            return "unknown";
+    }
+}
+
+std::string FormatTime(int64_t time)
+{
+    time_t sec = static_cast<time_t>(time / MILLI_TO_SEC);
+    struct tm tm {};
+    char buffer[sizeof("MM-DD HH:MM:SS")] = { 0 };
+    if (localtime_r(&sec, &tm) == nullptr || strftime(buffer, sizeof(buffer), "%m-%d %H:%M:%S", &tm) == 0) {
+        return std::to_string(time);
+    }
+    char millis[sizeof(".mmm")] = { 0 };
+    snprintf(millis, sizeof(millis), ".%03d", static_cast<int>(time % MILLI_TO_SEC));
+    return std::string(buffer) + millis;
+}
+
+// nearest-rank percentile of sorted values
+int64_t Percentile(const std::vector<int64_t> &values, size_t percent)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    size_t rank = (values.size() * percent + PERCENT - 1) / PERCENT;
+    return values[std::max<size_t>(rank, 1) - 1];
+}
+}
+
+NtpSyncHistory &NtpSyncHistory::GetInstance()
+{
+    static NtpSyncHistory instance;
+    return instance;
+}
+
+void NtpSyncHistory::BeginRound(NtpUpdateSource source)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    round_++;
+    source_ = source;
+}
+
+void NtpSyncHistory::AddRecord(NtpSyncRecord record)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    record.round = round_;
+    record.source = source_;
+    if (records_.size() < MAX_RECORDS) {
+        records_.push_back(std::move(record));
+        return;
+    }
+    records_[next_] = std::move(record);
+    next_ = (next_ + 1) % MAX_RECORDS;
+}
+
+void NtpSyncHistory::SetVoteOutcome(const std::string &server, bool agreed)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // the latest candidate of the server, a round may have queried it more than once
+    for (size_t i = 0; i < records_.size(); i++) {
+        auto &record = records_[(next_ + records_.size() - 1 - i) % records_.size()];
+        if (record.round != round_) {
+            return;
+        }
+        if (record.server == server && record.outcome == NtpSyncOutcome::CANDIDATE) {
+            record.outcome = agreed ? NtpSyncOutcome::VOTED : NtpSyncOutcome::OUTVOTED;
+            return;
+        }
+    }
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+std::vector<NtpSyncRecord> NtpSyncHistory::GetRecordsLocked()
+{
+    std::vector<NtpSyncRecord> records;
+    records.reserve(records_.size());
+    for (size_t i = 0; i < records_.size(); i++) {
+        records.push_back(records_[(next_ + i) % records_.size()]);
+    }
+    return records;
+}
+
+void NtpSyncHistory::ShowSyncHistory(int fd)
+{
+    std::vector<NtpSyncRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records = GetRecordsLocked();
+    }
+    dprintf(fd, " * records                 = %zu/%zu\n", records.size(), MAX_RECORDS);
+    dprintf(fd, "   %-18s %5s %-16s %-24s %-28s %-9s %7s %7s %7s %8s\n", "time", "round", "source", "server",
+        "address", "outcome", "stratum", "rtt", "offset", "answer");
+    for (const auto &record : records) {
+        dprintf(fd, "   %-18s %5" PRIu64 " %-16s %-24s %-28s %-9s %7d %7" PRId64 " %7" PRId64 " %8" PRId64 "\n",
+            FormatTime(record.time).c_str(), record.round, GetSourceName(record.source), record.server.c_str(),
+            record.address.c_str(), OUTCOME_NAMES[static_cast<size_t>(record.outcome)], record.stratum,
+            record.rtt, record.offset, record.answerTime);
+    }
+
+    struct ServerSummary {
+        uint32_t outcomes[OUTCOME_COUNT] = { 0 };
+        std::vector<int64_t> rtts;
+        std::vector<int64_t> answerTimes;
+    };
+    std::map<std::string, ServerSummary> summaries;
+    for (const auto &record : records) {
+        auto &summary = summaries[record.server];
+        summary.outcomes[static_cast<size_t>(record.outcome)]++;
+        if (record.rtt >= 0) {
+            summary.rtts.push_back(record.rtt);
+            summary.answerTimes.push_back(record.answerTime);
+        }
+    }
+    for (auto &[server, summary] : summaries) {
+        std::sort(summary.rtts.begin(), summary.rtts.end());
+        std::sort(summary.answerTimes.begin(), summary.answerTimes.end());
+        dprintf(fd, " * server                  = %s\n", server.c_str());
+        dprintf(fd, "   * outcomes              =");
+        for (size_t i = 0; i < OUTCOME_COUNT; i++) {
+            if (summary.outcomes[i] > 0) {
+                dprintf(fd, " %s:%u", OUTCOME_NAMES[i], summary.outcomes[i]);
+            }
+        }
+        dprintf(fd, "\n");
+        if (summary.rtts.empty()) {
+            continue;
+        }
+        dprintf(fd, "   * rtt p50/p90/max       = %" PRId64 "/%" PRId64 "/%" PRId64 "ms\n",
+            Percentile(summary.rtts, P50), Percentile(summary.rtts, P90), summary.rtts.back());
+        dprintf(fd, "   * answer p50/p90/max    = %" PRId64 "/%" PRId64 "/%" PRId64 "ms\n",
+            Percentile(summary.answerTimes, P50), Percentile(summary.answerTimes, P90), summary.answerTimes.back());
+    }
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -15,10 +15,19 @@
 
 #include "ntp_trusted_time.h"
 
+#include <algorithm>
 #include <cinttypes>
+#include <fstream>
+#include <sstream>
 
+#include "ntp_drift_model.h"
+#include "ntp_sync_history.h"
+#include "parameters.h"
 #include "sntp_client.h"
 #include "time_sysevent.h"
+#include "time_source_arbiter.h"
+#include "time_system_ability.h"
+#include "time_task_executor.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -27,10 +36,24 @@ constexpr int64_t TIME_RESULT_UNINITED = -1;
 constexpr int64_t HALF = 2;
 constexpr int64_t TRUSTED_CANDIDATE_MINI_COUNT = 2;
 constexpr int NANO_TO_SECOND =  1000000000;
-constexpr int64_t ONE_DAY = 86400000;
-// RTC has approximate 2s error per day
-constexpr int64_t MAX_TIME_DRIFT_IN_ONE_DAY = 2000;
 constexpr int64_t MAX_TIME_TOLERANCE_BETWEEN_NTP_SERVERS = 100;
+constexpr const char* NTP_TIME_RESULT_SYSTEM_PARAMETER = "persist.time.ntp_time_result";
+constexpr const char* BOOT_ID_PATH = "/proc/sys/kernel/random/boot_id";
+constexpr size_t TIME_RESULT_FIELDS = 5;
+constexpr int64_t SECOND_TO_MILLI = 1000;
+// the RTC only counts whole seconds
+constexpr int64_t RTC_RESOLUTION = 1000;
+constexpr const char* SAVE_TASK = "ntp_time_result_save";
+// results arriving faster than this are saved together, each save costs an RTC read and a flash write
+constexpr int64_t MIN_SAVE_GAP = 10 * 60 * SECOND_TO_MILLI;
+
+std::string GetBootId()
+{
+    std::ifstream file(BOOT_ID_PATH);
+    std::string bootId;
+    std::getline(file, bootId);
+    return bootId;
+}
 } // namespace
 
 std::mutex NtpTrustedTime::mTimeResultMutex_;
@@ -45,10 +68,8 @@ bool NtpTrustedTime::ForceRefreshTrusted(const std::string &ntpServer)
 {
     SNTPClient client;
     if (client.RequestTime(ntpServer)) {
-        auto timeResult = std::make_shared<TimeResult>(client.getNtpTime(), client.getNtpTimeReference(),
-            client.getRoundTripTime() / HALF, ntpServer);
-        std::lock_guard<std::mutex> lock(mTimeResultMutex_);
-        mTimeResult = timeResult;
+        UpdateTrustedTimeResult(std::make_shared<TimeResult>(client.getNtpTime(), client.getNtpTimeReference(),
+            client.getRoundTripTime() / HALF, ntpServer));
         return true;
     }
     return false;
@@ -58,14 +79,145 @@ bool NtpTrustedTime::ForceRefresh(const std::string &ntpServer)
 {
     SNTPClient client;
     if (client.RequestTime(ntpServer)) {
-        auto timeResult = std::make_shared<TimeResult>(client.getNtpTime(), client.getNtpTimeReference(),
-            client.getRoundTripTime() / HALF, ntpServer);
+        return UpdateTimeResult(std::make_shared<TimeResult>(client.getNtpTime(), client.getNtpTimeReference(),
+            client.getRoundTripTime() / HALF, ntpServer));
+    }
+    return false;
+}
+
+void NtpTrustedTime::UpdateTrustedTimeResult(std::shared_ptr<TimeResult> timeResult)
+{
+    std::lock_guard<std::mutex> lock(mTimeResultMutex_);
+    SetTimeResultLocked(timeResult);
+}
+
+void NtpTrustedTime::SetTimeResultLocked(std::shared_ptr<TimeResult> timeResult)
+{
+    mTimeResult = timeResult;
+    restored_ = false;
+    NtpDriftModel::GetInstance().AddSample(timeResult->GetElapsedRealtimeMillis(), timeResult->GetTimeMillis(),
+        timeResult->GetCertaintyMillis());
+    TimeSourceArbiter::GetInstance().UpdateSample(TimeSource::NTP, timeResult->GetTimeMillis(),
+        timeResult->GetElapsedRealtimeMillis(), timeResult->GetCertaintyMillis());
+    ScheduleSaveLocked();
+}
+
+// needs to acquire the lock `mTimeResultMutex_` before calling this method
+void NtpTrustedTime::ScheduleSaveLocked()
+{
+    int64_t bootTime = 0;
+    TimeUtils::GetBootTimeMs(bootTime);
+    int64_t delay = (lastSaveTime_ > 0) ? std::max<int64_t>(lastSaveTime_ + MIN_SAVE_GAP - bootTime, 0) : 0;
+    // a save already pending picks up this result too
+    auto result = TimeTaskExecutor::GetInstance().Post(SAVE_TASK,
+        [] { NtpTrustedTime::GetInstance().SaveTimeResult(); }, delay);
+    if (result == TimeTaskExecutor::PostResult::REJECTED) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "time result save dropped");
+    }
+}
+
+void NtpTrustedTime::SaveTimeResult()
+{
+    // keeps concurrent saves in order, the RTC read and the parameter write stay outside mTimeResultMutex_
+    std::lock_guard<std::mutex> saveLock(saveMutex_);
+    std::shared_ptr<TimeResult> timeResult;
+    int64_t bootTime = 0;
+    {
         std::lock_guard<std::mutex> lock(mTimeResultMutex_);
-        if (IsTimeResultTrusted(timeResult)) {
-            return true;
+        if (mTimeResult == nullptr || mTimeResult->GetTimeMillis() == 0 ||
+            TimeUtils::GetBootTimeMs(bootTime) != E_TIME_OK) {
+            return;
         }
+        timeResult = mTimeResult;
+        lastSaveTime_ = bootTime;
     }
-    return false;
+    // RTC time at the moment of the result, 0 if the time spent powered off can not be measured
+    int64_t rtcMillis = 0;
+    time_t rtcTime = 0;
+    if (TimeSystemAbility::GetInstance()->GetRtcTime(rtcTime) == E_TIME_OK) {
+        rtcMillis = rtcTime * SECOND_TO_MILLI - timeResult->GetAgeMillis(bootTime);
+    }
+    // stored as "<ntp time>,<boot time>,<rtc time>,<certainty>,<boot id>", times in ms
+    std::string value = std::to_string(timeResult->GetTimeMillis()) + "," +
+        std::to_string(timeResult->GetElapsedRealtimeMillis()) + "," + std::to_string(rtcMillis) + "," +
+        std::to_string(timeResult->GetCertaintyMillis()) + "," + GetBootId();
+    if (!system::SetParameter(NTP_TIME_RESULT_SYSTEM_PARAMETER, value)) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "save time result failed");
+    }
+}
+
+void NtpTrustedTime::LoadTimeResult()
+{
+    std::string value = system::GetParameter(NTP_TIME_RESULT_SYSTEM_PARAMETER, "");
+    std::vector<std::string> fields;
+    std::stringstream stream(value);
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+        fields.push_back(field);
+    }
+    if (fields.size() != TIME_RESULT_FIELDS) {
+        return;
+    }
+    int64_t ntpTime = std::strtoll(fields[0].c_str(), nullptr, 0);
+    int64_t bootTime = std::strtoll(fields[1].c_str(), nullptr, 0);
+    int64_t rtcMillis = std::strtoll(fields[2].c_str(), nullptr, 0);
+    int64_t certainty = std::strtoll(fields[3].c_str(), nullptr, 0);
+    int64_t curBootTime = 0;
+    if (TimeUtils::GetBootTimeMs(curBootTime) != E_TIME_OK) {
+        return;
+    }
+    int64_t age = 0;
+    if (fields[4] == GetBootId()) {
+        // only the service restarted, the boot clock still counts from the result
+        age = curBootTime - bootTime;
+    } else {
+        time_t rtcTime = 0;
+        if (rtcMillis <= 0 || TimeSystemAbility::GetInstance()->GetRtcTime(rtcTime) != E_TIME_OK) {
+            TIME_HILOGW(TIME_MODULE_SERVICE, "no rtc to restore time result");
+            return;
+        }
+        age = rtcTime * SECOND_TO_MILLI - rtcMillis;
+        certainty += RTC_RESOLUTION;
+    }
+    // a negative age means the RTC was reset while the device was off
+    if (ntpTime <= 0 || age < 0 || age > NtpDriftModel::GetInstance().GetMaxResultAge()) {
+        TIME_HILOGW(TIME_MODULE_SERVICE, "drop saved time result, age:%{public}" PRId64 "", age);
+        return;
+    }
+    // anchored at the boot time the result would have had, so its age and drift bound keep counting
+    auto timeResult = std::make_shared<TimeResult>(ntpTime, curBootTime - age, certainty, "");
+    std::lock_guard<std::mutex> lock(mTimeResultMutex_);
+    if (mTimeResult != nullptr) {
+        return;
+    }
+    mTimeResult = timeResult;
+    restored_ = true;
+    TimeSourceArbiter::GetInstance().UpdateSample(TimeSource::NTP, ntpTime, curBootTime - age, certainty);
+    TIME_HILOGI(TIME_MODULE_SERVICE, "restore time result, age:%{public}" PRId64 " certainty:%{public}" PRId64 "",
+        age, certainty);
+}
+
+void NtpTrustedTime::ShowTrustedTimeInfo(int fd)
+{
+    std::lock_guard<std::mutex> lock(mTimeResultMutex_);
+    int64_t bootTime = 0;
+    if (mTimeResult == nullptr || mTimeResult->GetTimeMillis() == 0 ||
+        TimeUtils::GetBootTimeMs(bootTime) != E_TIME_OK) {
+        dprintf(fd, " * trusted time            = none\n");
+        return;
+    }
+    int64_t age = mTimeResult->GetAgeMillis(bootTime);
+    dprintf(fd, " * trusted time            = %" PRId64 "\n", mTimeResult->GetTimeMillis() + age);
+    dprintf(fd, " * trusted time source     = %s\n", restored_ ? "restored" : mTimeResult->GetNtpServer().c_str());
+    dprintf(fd, " * trusted time age        = %" PRId64 "s\n", age / SECOND_TO_MILLI);
+    dprintf(fd, " * trusted time certainty  = %" PRId64 "ms\n",
+        mTimeResult->GetCertaintyMillis() + NtpDriftModel::GetInstance().GetDriftBound(age));
+}
+
+bool NtpTrustedTime::UpdateTimeResult(std::shared_ptr<TimeResult> timeResult)
+{
+    std::lock_guard<std::mutex> lock(mTimeResultMutex_);
+    return IsTimeResultTrusted(timeResult);
 }
 
 // needs to acquire the lock `mTimeResultMutex_` before calling this method
@@ -83,9 +235,11 @@ bool NtpTrustedTime::IsTimeResultTrusted(std::shared_ptr<TimeResult> timeResult)
         TimeResultCandidates_.push_back(timeResult);
         return false;
     }
-    // mTimeResult is beyond max value of kernel gap, this server is untrusted
+    // mTimeResult is beyond what the clock can have drifted since, this server is untrusted
     auto newNtpTime = timeResult->GetTimeMillis();
-    if (std::abs(newNtpTime - oldNtpTime) > MAX_TIME_DRIFT_IN_ONE_DAY) {
+    auto maxDrift = NtpDriftModel::GetInstance().GetMaxDrift(mTimeResult->GetAgeMillis(
+        timeResult->GetElapsedRealtimeMillis())) + mTimeResult->GetCertaintyMillis();
+    if (std::abs(newNtpTime - oldNtpTime) > maxDrift) {
         TIME_HILOGW(TIME_MODULE_SERVICE, "NTPserver is untrusted old:%{public}" PRId64 " new:%{public}" PRId64 "",
             oldNtpTime, newNtpTime);
         TimeResultCandidates_.push_back(timeResult);
@@ -95,7 +249,7 @@ bool NtpTrustedTime::IsTimeResultTrusted(std::shared_ptr<TimeResult> timeResult)
     }
     // cause refresh time success, old value is invaild
     TimeResultCandidates_.clear();
-    mTimeResult = timeResult;
+    SetTimeResultLocked(timeResult);
     return true;
 }
 
@@ -146,17 +300,38 @@ bool NtpTrustedTime::FindBestTimeResult()
         }
     }
 
+    // without a majority every candidate is outvoted
+    for (const auto &candidate : TimeResultCandidates_) {
+        bool agreed = mostVotedTimeResult != nullptr &&
+            std::abs(candidate->CurrentTimeMillis(mostVotedTimeResult->GetElapsedRealtimeMillis()) -
+            mostVotedTimeResult->GetTimeMillis()) < MAX_TIME_TOLERANCE_BETWEEN_NTP_SERVERS;
+        NtpSyncHistory::GetInstance().SetVoteOutcome(candidate->GetNtpServer(), agreed);
+    }
     TimeResultCandidates_.clear();
     if (mostVotedTimeResultCount == 0) {
         TIME_HILOGW(TIME_MODULE_SERVICE, "no best candidate");
         return false;
     } else {
         std::lock_guard<std::mutex> lock(mTimeResultMutex_);
-        mTimeResult = mostVotedTimeResult;
+        SetTimeResultLocked(mostVotedTimeResult);
         return true;
     }
 }
 
+bool NtpTrustedTime::HasTimeResultQuorum(size_t serverCount)
+{
+    if (TimeResultCandidates_.size() < TRUSTED_CANDIDATE_MINI_COUNT) {
+        return false;
+    }
+    // answers still missing can not outvote a majority of all queried servers
+    for (size_t i = 0; i < TimeResultCandidates_.size(); i++) {
+        if (GetSameTimeResultCount(TimeResultCandidates_[i]) > static_cast<int32_t>(serverCount / HALF)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void NtpTrustedTime::ClearTimeResultCandidates()
 {
     TimeResultCandidates_.clear();
@@ -185,6 +360,10 @@ int64_t NtpTrustedTime::ElapsedRealtimeMillis()
         TIME_HILOGE(TIME_MODULE_SERVICE, "Missing authoritative time source");
         return TIME_RESULT_UNINITED;
     }
+    // a restored result does not count as a sync, the next update still queries the servers
+    if (restored_) {
+        return TIME_RESULT_UNINITED;
+    }
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
     return mTimeResult->GetElapsedRealtimeMillis();
 }
@@ -230,7 +409,7 @@ int64_t NtpTrustedTime::TimeResult::CurrentTimeMillis(int64_t bootTime)
         TIME_HILOGD(TIME_MODULE_SERVICE, "Missing authoritative time source");
         return TIME_RESULT_UNINITED;
     }
-    if (bootTime - mElapsedRealtimeMillis > ONE_DAY) {
+    if (bootTime - mElapsedRealtimeMillis > NtpDriftModel::GetInstance().GetMaxResultAge()) {
         Clear();
         return TIME_RESULT_UNINITED;
     }
@@ -242,6 +421,11 @@ int64_t NtpTrustedTime::TimeResult::GetAgeMillis(int64_t bootTime)
     return bootTime - this->mElapsedRealtimeMillis;
 }
 
+int64_t NtpTrustedTime::TimeResult::GetCertaintyMillis()
+{
+    return mCertaintyMillis;
+}
+
 std::string NtpTrustedTime::TimeResult::GetNtpServer()
 {
     return mNtpServer;
@@ -15,9 +15,15 @@
 #include "ntp_update_time.h"
 
 #include "init_param.h"
+#include "ntp_drift_model.h"
+#include "ntp_resolver.h"
+#include "ntp_sync_history.h"
 #include "ntp_trusted_time.h"
 #include "parameters.h"
+#include "sntp_query_engine.h"
 #include "time_system_ability.h"
+#include "time_source_arbiter.h"
+#include "time_task_executor.h"
 
 using namespace std::chrono;
 
@@ -26,19 +32,26 @@ namespace MiscServices {
 namespace {
 constexpr int64_t NANO_TO_MILLISECOND = 1000000;
 constexpr int64_t TWO_SECOND_TO_MILLISECOND = 2000;
+// NITZ carries whole seconds and reaches the device with the latency of the network
+constexpr int64_t NITZ_UNCERTAINTY = 2000;
 constexpr int64_t HALF_DAY_TO_MILLISECOND = 43200000;
 constexpr const char* NTP_SERVER_SYSTEM_PARAMETER = "persist.time.ntpserver";
 constexpr const char* NTP_SERVER_SPECIFIC_SYSTEM_PARAMETER = "persist.time.ntpserver_specific";
+// name server queried directly for the NTP hosts, empty for the system resolver
+constexpr const char* NTP_DNS_SERVER_SYSTEM_PARAMETER = "persist.time.ntp_dns_server";
 constexpr uint32_t NTP_MAX_SIZE = 5;
 constexpr const char* AUTO_TIME_SYSTEM_PARAMETER = "persist.time.auto_time";
 constexpr const char* AUTO_TIME_STATUS_ON = "ON";
 constexpr const char* AUTO_TIME_STATUS_OFF = "OFF";
-constexpr int64_t ONE_HOUR = 3600000;
 constexpr const char* DEFAULT_NTP_SERVER = "1.cn.pool.ntp.org";
 constexpr int32_t RETRY_TIMES = 2;
+// all servers of one round share this deadline, it matches the former per socket timeout
+constexpr int64_t NTP_QUERY_TIMEOUT = 5000;
 constexpr int64_t MIN_NTP_RETRY_INTERVAL = 10000;
 constexpr int64_t MAX_NTP_RETRY_INTERVAL = HALF_DAY_TO_MILLISECOND;
 constexpr int32_t INCREASE_TIMES = 4;
+// executor key of the pending sync, a burst of triggers leaves only one behind
+constexpr const char* NTP_SYNC_TASK = "ntp_sync";
 } // namespace
 
 AutoTimeInfo NtpUpdateTime::autoTimeInfo_{};
@@ -66,6 +79,10 @@ void NtpUpdateTime::Init()
         return;
     }
     RegisterSystemParameterListener();
+    NtpDriftModel::GetInstance().Init();
+    NtpTrustedTime::GetInstance().LoadTimeResult();
+    TimeSourceArbiter::GetInstance().Init();
+    NtpResolver::GetInstance().SetNameServer(system::GetParameter(NTP_DNS_SERVER_SYSTEM_PARAMETER, ""));
     autoTimeInfo_.ntpServer = ntpServer;
     autoTimeInfo_.ntpServerSpec = ntpServerSpec;
     autoTimeInfo_.status = autoTime;
@@ -90,17 +107,20 @@ void NtpUpdateTime::RefreshNetworkTimeByTimer(uint64_t timerId)
         return;
     }
 
-    auto setSystemTime = [this]() { this->SetSystemTime(RETRY_BY_TIMER); };
-    std::thread thread(setSystemTime);
-    thread.detach();
+    SetSystemTimeAsync(RETRY_BY_TIMER);
 }
 
 void NtpUpdateTime::UpdateNITZSetTime()
 {
     auto bootTimeNano = steady_clock::now().time_since_epoch().count();
     auto bootTimeMilli = bootTimeNano / NANO_TO_MILLISECOND;
+    int64_t wallTime = 0;
     if (TimeUtils::GetBootTimeMs(lastNITZUpdateTime_) != ERR_OK) {
         TIME_HILOGE(TIME_MODULE_SERVICE, "get boottime fail");
+    } else if (TimeUtils::GetWallTimeMs(wallTime) == ERR_OK) {
+        // the clock has just been set to the NITZ time by the telephony service
+        TimeSourceArbiter::GetInstance().UpdateSample(TimeSource::NITZ, wallTime, lastNITZUpdateTime_,
+            NITZ_UNCERTAINTY);
     }
     nitzUpdateTimeMilli_ = static_cast<uint64_t>(bootTimeMilli);
 }
@@ -139,8 +159,8 @@ bool NtpUpdateTime::IsInUpdateInterval()
     TimeUtils::GetBootTimeMs(curBootTime);
     auto lastBootTime = NtpTrustedTime::GetInstance().ElapsedRealtimeMillis();
     auto gapTime = curBootTime - lastBootTime;
-    // If the time <= ONE_HOUR, do not send NTP requests.
-    if ((lastBootTime > 0) && (gapTime <= ONE_HOUR)) {
+    // If the time <= min update gap of the drift model, do not send NTP requests.
+    if ((lastBootTime > 0) && (gapTime <= NtpDriftModel::GetInstance().GetMinUpdateGap())) {
         TIME_SIMPLIFY_HILOGI(TIME_MODULE_SERVICE,
             "ntp updated lastBootTime:%{public}" PRId64 " gap:%{public}" PRId64 "",
             lastBootTime, gapTime);
@@ -150,29 +170,21 @@ bool NtpUpdateTime::IsInUpdateInterval()
 }
 
 // needs to acquire the lock `requestMutex_` before calling this method
-NtpRefreshCode NtpUpdateTime::GetNtpTimeInner()
+NtpRefreshCode NtpUpdateTime::GetNtpTimeInner(NtpUpdateSource code)
 {
     if (IsInUpdateInterval()) {
         return NO_NEED_REFRESH;
     }
+    NtpSyncHistory::GetInstance().BeginRound(code);
 
     std::vector<std::string> ntpSpecList = SplitNtpAddrs(autoTimeInfo_.ntpServerSpec);
     std::vector<std::string> ntpList = SplitNtpAddrs(autoTimeInfo_.ntpServer);
-    
+
     for (int i = 0; i < RETRY_TIMES; i++) {
-        for (size_t j = 0; j < ntpSpecList.size(); j++) {
-            TIME_HILOGI(TIME_MODULE_SERVICE, "ntpSpecServer is:%{public}s", ntpSpecList[j].c_str());
-            if (NtpTrustedTime::GetInstance().ForceRefreshTrusted(ntpSpecList[j])) {
-                // if refresh time success, need to clear candidates list
-                NtpTrustedTime::GetInstance().ClearTimeResultCandidates();
-                return REFRESH_SUCCESS;
-            }
-        }
-        for (size_t j = 0; j < ntpList.size(); j++) {
-            TIME_HILOGI(TIME_MODULE_SERVICE, "ntpServer is:%{public}s", ntpList[j].c_str());
-            if (NtpTrustedTime::GetInstance().ForceRefresh(ntpList[j])) {
-                return REFRESH_SUCCESS;
-            }
+        TIME_HILOGI(TIME_MODULE_SERVICE, "ntpSpecServer is:%{public}s ntpServer is:%{public}s",
+            autoTimeInfo_.ntpServerSpec.c_str(), autoTimeInfo_.ntpServer.c_str());
+        if (SntpQueryEngine::GetInstance().Query(ntpSpecList, ntpList, NTP_QUERY_TIMEOUT)) {
+            return REFRESH_SUCCESS;
         }
         if (NtpTrustedTime::GetInstance().FindBestTimeResult()) {
             return REFRESH_SUCCESS;
@@ -218,7 +230,7 @@ bool NtpUpdateTime::GetNtpTime(int64_t &time)
 {
     std::lock_guard<std::mutex> autoLock(requestMutex_);
 
-    auto ret = GetNtpTimeInner();
+    auto ret = GetNtpTimeInner(GET_NTP_TIME);
     if (ret == REFRESH_FAILED) {
         TIME_HILOGE(TIME_MODULE_SERVICE, "get ntp time failed");
         return false;
@@ -229,11 +241,22 @@ bool NtpUpdateTime::GetNtpTime(int64_t &time)
     }
 
     if (autoTimeInfo_.status == AUTO_TIME_STATUS_ON && CheckNeedSetTime(ret, time)) {
-        TimeSystemAbility::GetInstance()->SetTimeInner(time);
+        CorrectSystemTime();
     }
     return true;
 }
 
+void NtpUpdateTime::SetSystemTimeAsync(NtpUpdateSource code)
+{
+    auto setSystemTime = [code]() { SetSystemTime(code); };
+    auto result = TimeTaskExecutor::GetInstance().Post(NTP_SYNC_TASK, setSystemTime);
+    if (result == TimeTaskExecutor::PostResult::COALESCED) {
+        TIME_HILOGI(TIME_MODULE_SERVICE, "ntp sync already pending, source:%{public}d", code);
+    } else if (result == TimeTaskExecutor::PostResult::REJECTED) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "ntp sync dropped, source:%{public}d", code);
+    }
+}
+
 void NtpUpdateTime::SetSystemTime(NtpUpdateSource code)
 {
     if (autoTimeInfo_.status != AUTO_TIME_STATUS_ON) {
@@ -248,7 +271,7 @@ void NtpUpdateTime::SetSystemTime(NtpUpdateSource code)
         return;
     }
 
-    auto ret = GetNtpTimeInner();
+    auto ret = GetNtpTimeInner(code);
     if (ret == REFRESH_FAILED) {
         TIME_HILOGE(TIME_MODULE_SERVICE, "get ntp time failed");
         RefreshNextTriggerTime(code, false, true);
@@ -269,20 +292,28 @@ void NtpUpdateTime::SetSystemTime(NtpUpdateSource code)
         return;
     }
 
-    TimeSystemAbility::GetInstance()->SetTimeInner(currentTime);
+    CorrectSystemTime();
     requestMutex_.unlock();
 }
 
+void NtpUpdateTime::CorrectSystemTime()
+{
+    // the trusted time result has reached the arbiter, which weighs it against NITZ and the RTC
+    TimeSourceArbiter::GetInstance().Correct(TimeSource::NTP);
+}
+
 void NtpUpdateTime::RefreshNextTriggerTime(NtpUpdateSource code, bool isSuccess, bool isSwitchOpen)
 {
     std::lock_guard<std::mutex> lock(ntpRetryMutex_);
+    // the drift model decides how long a successful sync stays accurate enough
+    int64_t syncInterval = NtpDriftModel::GetInstance().GetSyncInterval();
     if (isSuccess || !isSwitchOpen) {
-        // if interval reach to max and refresh is caused by timer, need to set a new timer
+        // if interval reach to sync interval and refresh is caused by timer, need to set a new timer
         // else do not need to refresh timer, cause timer is already set
-        if (ntpRetryInterval_ == MAX_NTP_RETRY_INTERVAL && code != RETRY_BY_TIMER) {
+        if (ntpRetryInterval_ == syncInterval && code != RETRY_BY_TIMER) {
             return;
         }
-        ntpRetryInterval_ = MAX_NTP_RETRY_INTERVAL;
+        ntpRetryInterval_ = syncInterval;
     } else {
         switch (code) {
             case INIT:
@@ -294,9 +325,7 @@ void NtpUpdateTime::RefreshNextTriggerTime(NtpUpdateSource code, bool isSuccess,
                 break;
             case RETRY_BY_TIMER:
                 ntpRetryInterval_ *= INCREASE_TIMES;
-                ntpRetryInterval_ = ntpRetryInterval_ > MAX_NTP_RETRY_INTERVAL ?
-                                    MAX_NTP_RETRY_INTERVAL:
-                                    ntpRetryInterval_;
+                ntpRetryInterval_ = std::min(ntpRetryInterval_, std::min(syncInterval, MAX_NTP_RETRY_INTERVAL));
                 break;
             default:
                 TIME_HILOGE(TIME_MODULE_SERVICE, "Error state, code:%{public}d", code);
@@ -16,10 +16,12 @@
 #include "sntp_client.h"
 #include "ntp_trusted_time.h"
 
+#include <algorithm>
 #include <netdb.h>
 #include <securec.h>
 #include <sstream>
 #include <sys/time.h>
+#include <time.h>
 
 #include "time_sysevent.h"
 
@@ -27,7 +29,10 @@ namespace OHOS {
 namespace MiscServices {
 namespace {
 constexpr uint64_t SECONDS_SINCE_FIRST_EPOCH = 2208988800; // Seconds from 1/1/1900 00.00 to 1/1/1970 00.00;
-constexpr uint64_t MILLISECOND_TO_SECOND = 1000;
+constexpr uint64_t MICROSECOND_TO_SECOND = 1000000;
+constexpr uint64_t NANOSECOND_TO_SECOND = 1000000000;
+constexpr int64_t NANO_TO_MICRO = 1000;
+constexpr int64_t MICRO_TO_MILLI = 1000;
 constexpr uint64_t FRACTION_TO_SECOND = 0x100000000;
 constexpr uint64_t UINT32_MASK = 0xFFFFFFFF;
 constexpr int VERSION_MASK = 0x38;
@@ -39,8 +44,10 @@ constexpr int32_t INDEX_THREE = 3;
 constexpr int32_t INDEX_FOUR = 4;
 constexpr int32_t TIME_OUT = 5;
 constexpr unsigned char MODE_THREE = 3;
-constexpr unsigned char VERSION_THREE = 3;
-constexpr double TEN_TO_MINUS_SIX_POWER = 1.0e-6;
+constexpr unsigned char MODE_SERVER = 4;
+constexpr unsigned char VERSION_FOUR = 4;
+constexpr unsigned char LEAP_NOT_SYNC = 3;
+constexpr unsigned char STRATUM_KISS_OF_DEATH = 0;
 constexpr const char* NTP_PORT = "123";
 constexpr int32_t NTP_MSG_OFFSET_ROOT_DELAY = 4;
 constexpr int32_t NTP_MSG_OFFSET_ROOT_DISPERSION = 8;
@@ -52,6 +59,8 @@ constexpr int32_t TRANSMIT_TIMESTAMP_OFFSET = 40;
 constexpr int32_t NTP_PACKAGE_SIZE = 48;
 constexpr int32_t SNTP_MSG_OFFSET_SIX = 6;
 constexpr int32_t SNTP_MSG_OFFSET_THREE = 3;
+// the first request and its retransmits
+constexpr size_t MAX_OUTSTANDING_REQUESTS = 4;
 } // namespace
 
 bool SNTPClient::RequestTime(const std::string &host)
@@ -113,7 +122,7 @@ bool SNTPClient::RequestTime(const std::string &host)
     return true;
 }
 
-void SNTPClient::SetClockOffset(int clockOffset)
+void SNTPClient::SetClockOffset(int64_t clockOffset)
 {
     m_clockOffset = clockOffset;
 }
@@ -142,12 +151,11 @@ uint64_t SNTPClient::GetNtpTimestamp64(int offset, const char *buffer)
     return le64toh(milliseconds);
 }
 
-void SNTPClient::ConvertUnixToNtp(struct ntp_timestamp *ntpTs, struct timeval *unixTs)
+void SNTPClient::ConvertUnixToNtp(struct ntp_timestamp *ntpTs, struct timespec *unixTs)
 {
     // 0x83AA7E80; the seconds from Jan 1, 1900 to Jan 1, 1970
     ntpTs->second = unixTs->tv_sec + SECONDS_SINCE_FIRST_EPOCH; // 0x83AA7E80;
-    ntpTs->fraction =
-        static_cast<uint64_t>((unixTs->tv_usec + 1) * (1LL << RECEIVE_TIMESTAMP_OFFSET) * TEN_TO_MINUS_SIX_POWER);
+    ntpTs->fraction = (static_cast<uint64_t>(unixTs->tv_nsec) << RECEIVE_TIMESTAMP_OFFSET) / NANOSECOND_TO_SECOND;
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
 }
 
@@ -161,7 +169,7 @@ void SNTPClient::ConvertUnixToNtp(struct ntp_timestamp *ntpTs, struct timeval *u
   *   |                  Seconds Fraction (0-padded)                  |
   *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
   */
-int64_t SNTPClient::ConvertNtpToStamp(uint64_t _ntpTs)
+int64_t SNTPClient::ConvertNtpToStampUs(uint64_t _ntpTs)
 {
     auto second = static_cast<uint32_t>((_ntpTs >> RECEIVE_TIMESTAMP_OFFSET) & UINT32_MASK);
     auto fraction = static_cast<uint32_t>(_ntpTs & UINT32_MASK);
@@ -171,45 +179,53 @@ int64_t SNTPClient::ConvertNtpToStamp(uint64_t _ntpTs)
     if (second < SECONDS_SINCE_FIRST_EPOCH) {
         return 0;
     }
-    // convert sntp timestamp to seconds
-    return ((second - SECONDS_SINCE_FIRST_EPOCH) * MILLISECOND_TO_SECOND) +
-           ((fraction * MILLISECOND_TO_SECOND) / FRACTION_TO_SECOND);
+    // convert sntp timestamp to microseconds
+    return ((second - SECONDS_SINCE_FIRST_EPOCH) * MICROSECOND_TO_SECOND) +
+           ((fraction * MICROSECOND_TO_SECOND) / FRACTION_TO_SECOND);
 }
 
 void SNTPClient::CreateMessage(char *buffer)
 {
     struct ntp_timestamp ntp{};
-    struct timeval unix;
+    struct timespec unix {};
 
-    gettimeofday(&unix, nullptr);
+    clock_gettime(CLOCK_REALTIME, &unix);
     // convert unix time to ntp time
     ConvertUnixToNtp(&ntp, &unix);
     uint64_t _ntpTs = ntp.second;
     _ntpTs = (_ntpTs << RECEIVE_TIMESTAMP_OFFSET) | ntp.fraction;
-    errno_t ret = TimeUtils::GetBootTimeMs(m_originateTimestamp);
+    int64_t originateBootTime = 0;
+    errno_t ret = TimeUtils::GetBootTimeNs(originateBootTime);
     if (ret != E_TIME_OK) {
         return;
     }
+    if (mOutstanding.size() >= MAX_OUTSTANDING_REQUESTS) {
+        mOutstanding.erase(mOutstanding.begin());
+    }
+    mOutstanding.push_back({ _ntpTs, originateBootTime / NANO_TO_MICRO });
 
     SNTPMessage _sntpMsg{};
     // Important, if you don't set the version/mode, the server will ignore you.
     _sntpMsg.clear();
     _sntpMsg._leapIndicator = 0;
-    _sntpMsg._versionNumber = VERSION_THREE;
+    _sntpMsg._versionNumber = VERSION_FOUR;
     _sntpMsg._mode = MODE_THREE;
-    // optional (?)
+    // the server echoes the transmit timestamp as originate timestamp, which identifies its answer
     _sntpMsg._originateTimestamp = _ntpTs;
+    _sntpMsg._transmitTimestamp = _ntpTs;
     char value[sizeof(uint64_t)];
-    ret = memcpy_s(value, sizeof(uint64_t), &_sntpMsg._originateTimestamp, sizeof(uint64_t));
+    ret = memcpy_s(value, sizeof(uint64_t), &_sntpMsg._transmitTimestamp, sizeof(uint64_t));
     if (ret != EOK) {
         TIME_HILOGE(TIME_MODULE_SERVICE, "memcpy_s failed, err = %{public}d", ret);
         return;
     }
-    int numOfBit = sizeof(uint64_t) - 1;
-    int offsetEnd = ORIGINATE_TIMESTAMP_OFFSET + sizeof(uint64_t);
-    for (int loop = ORIGINATE_TIMESTAMP_OFFSET; loop < offsetEnd; loop++) {
-        buffer[loop] = value[numOfBit];
-        numOfBit--;
+    for (int offset : { ORIGINATE_TIMESTAMP_OFFSET, TRANSMIT_TIMESTAMP_OFFSET }) {
+        int numOfBit = sizeof(uint64_t) - 1;
+        int offsetEnd = offset + static_cast<int>(sizeof(uint64_t));
+        for (int loop = offset; loop < offsetEnd; loop++) {
+            buffer[loop] = value[numOfBit];
+            numOfBit--;
+        }
     }
     // create the 1-byte info in one go... the result should be 27 :)
     buffer[INDEX_ZERO] = (_sntpMsg._leapIndicator << SNTP_MSG_OFFSET_SIX) |
@@ -220,10 +236,12 @@ void SNTPClient::CreateMessage(char *buffer)
 bool SNTPClient::ReceivedMessage(char *buffer)
 {
     int64_t receiveBootTime = 0;
-    errno_t ret = TimeUtils::GetBootTimeMs(receiveBootTime);
+    errno_t ret = TimeUtils::GetBootTimeNs(receiveBootTime);
     if (ret != E_TIME_OK) {
         return false;
     }
+    receiveBootTime /= NANO_TO_MICRO;
+    mStaleAnswer = false;
     SNTPMessage _sntpMsg;
     _sntpMsg.clear();
     _sntpMsg._leapIndicator = buffer[INDEX_ZERO] >> SNTP_MSG_OFFSET_SIX;
@@ -244,26 +262,46 @@ bool SNTPClient::ReceivedMessage(char *buffer)
     _sntpMsg._originateTimestamp = GetNtpTimestamp64(ORIGINATE_TIMESTAMP_OFFSET, buffer);
     _sntpMsg._receiveTimestamp = GetNtpTimestamp64(RECEIVE_TIMESTAMP_OFFSET, buffer);
     _sntpMsg._transmitTimestamp = GetNtpTimestamp64(TRANSMIT_TIMESTAMP_OFFSET, buffer);
-    int64_t _originClient = m_originateTimestamp;
-    int64_t _receiveServer = ConvertNtpToStamp(_sntpMsg._receiveTimestamp);
-    int64_t _transmitServer = ConvertNtpToStamp(_sntpMsg._transmitTimestamp);
+    mStratum = _sntpMsg._stratum;
+    if (_sntpMsg._mode != MODE_SERVER || _sntpMsg._leapIndicator == LEAP_NOT_SYNC ||
+        _sntpMsg._stratum == STRATUM_KISS_OF_DEATH) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "unusable answer, mode:%{public}d leap:%{public}d stratum:%{public}d",
+            _sntpMsg._mode, _sntpMsg._leapIndicator, _sntpMsg._stratum);
+        return false;
+    }
+    auto request = std::find_if(mOutstanding.begin(), mOutstanding.end(),
+        [&_sntpMsg](const OutstandingRequest &item) { return item.transmitTimestamp == _sntpMsg._originateTimestamp; });
+    if (request == mOutstanding.end()) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "answer does not match the request");
+        mStaleAnswer = true;
+        return false;
+    }
+    // all timestamps are in microseconds, client ones in boot time and server ones in wall time
+    int64_t _originClient = request->originateUs;
+    int64_t _receiveServer = ConvertNtpToStampUs(_sntpMsg._receiveTimestamp);
+    int64_t _transmitServer = ConvertNtpToStampUs(_sntpMsg._transmitTimestamp);
     if (_transmitServer == 0 || _receiveServer == 0) {
         return false;
     }
+    // the exchange is settled, answers to the other copies are duplicates
+    mOutstanding.clear();
     int64_t _receiveClient = receiveBootTime;
     int64_t _clockOffset = (((_receiveServer - _originClient) + (_transmitServer - _receiveClient)) / INDEX_TWO);
     int64_t _roundTripDelay = (_receiveClient - _originClient) - (_transmitServer - _receiveServer);
-    mRoundTripTime = _roundTripDelay;
-    mNtpTime = receiveBootTime + _clockOffset;
-    TimeUtils::GetBootTimeMs(mNtpTimeReference);
+    mRoundTripTimeUs = _roundTripDelay;
+    mNtpTimeReferenceUs = receiveBootTime;
+    mRoundTripTime = _roundTripDelay / MICRO_TO_MILLI;
+    mNtpTime = (receiveBootTime + _clockOffset) / MICRO_TO_MILLI;
+    mNtpTimeReference = receiveBootTime / MICRO_TO_MILLI;
     SetClockOffset(_clockOffset);
     TIME_HILOGI(TIME_MODULE_SERVICE, "_originClient:%{public}s, _receiveServer:%{public}s, _transmitServer:%{public}s,"
                 "_receiveClient:%{public}s", std::to_string(_originClient).c_str(),
                 std::to_string(_receiveServer).c_str(), std::to_string(_transmitServer).c_str(),
                 std::to_string(_receiveClient).c_str());
     TimeBehaviorReport(ReportEventCode::NTP_REFRESH,
-        std::to_string(_originClient) + "|" + std::to_string(_receiveClient),
-        std::to_string(_transmitServer) + "|" + std::to_string(_receiveServer), mNtpTime);
+        std::to_string(_originClient / MICRO_TO_MILLI) + "|" + std::to_string(_receiveClient / MICRO_TO_MILLI),
+        std::to_string(_transmitServer / MICRO_TO_MILLI) + "|" + std::to_string(_receiveServer / MICRO_TO_MILLI),
+        mNtpTime);
     return true;
 }
 
@@ -327,6 +365,31 @@ int64_t SNTPClient::getRoundTripTime()
 {
     return mRoundTripTime;
 }
+
+int64_t SNTPClient::getClockOffsetUs()
+{
+    return m_clockOffset;
+}
+
+int64_t SNTPClient::getNtpTimeReferenceUs()
+{
+    return mNtpTimeReferenceUs;
+}
+
+int64_t SNTPClient::getRoundTripTimeUs()
+{
+    return mRoundTripTimeUs;
+}
+
+int32_t SNTPClient::getStratum()
+{
+    return mStratum;
+}
+
+bool SNTPClient::isStaleAnswer()
+{
+    return mStaleAnswer;
+}
 // LCOV_EXCL_STOP
 } // namespace MiscServices
 } // namespace OHOS
\ No newline at end of file
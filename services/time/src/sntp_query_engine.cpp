@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sntp_query_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+
+#include "ntp_trusted_time.h"
+#include "time_common.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr int32_t NTP_PACKAGE_SIZE = 48;
+constexpr int64_t HALF = 2;
+constexpr int MAX_EVENTS = 16;
+// epoll user data of the resolver eventfd, attempts use their request index and attempt index
+constexpr uint64_t RESOLVE_EVENT = UINT64_MAX;
+constexpr int ATTEMPT_INDEX_BITS = 32;
+constexpr uint64_t ATTEMPT_INDEX_MASK = 0xFFFFFFFF;
+constexpr int64_t MICRO_TO_MILLI = 1000;
+#ifdef CLOCK_DISCIPLINE_ENABLE
+// samples are sent back to back, each one as soon as the previous answer is in
+constexpr size_t NTP_SAMPLE_COUNT = 4;
+#else
+constexpr size_t NTP_SAMPLE_COUNT = 1;
+#endif
+// a lost sample does not hold back a server which has already answered
+constexpr int64_t NTP_SAMPLE_TIMEOUT = 1000;
+// connection attempt delay recommended by RFC 8305
+constexpr int64_t HAPPY_EYEBALLS_DELAY = 250;
+// a lost first request would otherwise keep the server silent for the whole round
+constexpr uint32_t NTP_MAX_RETRANSMIT = 2;
+// lookups beyond this many run one after another on the same threads, for all queries together
+constexpr size_t MAX_RESOLVER_THREADS = 4;
+// resolver threads alive in the process, including those an ended query left in a slow lookup
+std::atomic<size_t> g_resolverThreads {0};
+}
+
+struct SntpQueryEngine::ResolveState {
+    struct Answer {
+        size_t index = 0;
+        std::vector<NtpAddress> addresses;
+    };
+
+    ~ResolveState()
+    {
+        if (eventFd >= 0) {
+            close(eventFd);
+        }
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> hosts;
+    // index of the next host to resolve
+    size_t next = 0;
+    // set when the query ends, the hosts not yet started are skipped
+    bool cancelled = false;
+    std::vector<Answer> answers;
+    int eventFd = -1;
+};
+
+// detached, getaddrinfo has no timeout and must not hold the query past its deadline; the state, the eventfd
+// included, lives until the last lookup in flight returns
+void SntpQueryEngine::Resolve(std::shared_ptr<ResolveState> state)
+{
+    while (true) {
+        ResolveState::Answer answer;
+        std::string host;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->cancelled || state->next >= state->hosts.size()) {
+                break;
+            }
+            answer.index = state->next++;
+            host = state->hosts[answer.index];
+        }
+        answer.addresses = NtpResolver::GetInstance().Resolve(host);
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->answers.push_back(std::move(answer));
+        }
+        uint64_t one = 1;
+        if (write(state->eventFd, &one, sizeof(one)) < 0) {
+            TIME_HILOGE(TIME_MODULE_SERVICE, "notify resolve failed: %{public}s", strerror(errno));
+        }
+    }
+    g_resolverThreads--;
+}
+
+SntpQueryEngine &SntpQueryEngine::GetInstance()
+{
+    static SntpQueryEngine instance;
+    return instance;
+}
+
+bool SntpQueryEngine::Query(const std::vector<std::string> &specServers, const std::vector<std::string> &servers,
+    int64_t timeoutMs)
+{
+    std::vector<Request> requests(specServers.size() + servers.size());
+    for (size_t i = 0; i < requests.size(); i++) {
+        requests[i].trusted = i < specServers.size();
+        requests[i].server = requests[i].trusted ? specServers[i] : servers[i - specServers.size()];
+    }
+    if (requests.empty()) {
+        return false;
+    }
+    int64_t now = 0;
+    TimeUtils::GetBootTimeMs(now);
+    int64_t deadline = now + timeoutMs;
+    QueryContext context;
+    context.startTime = now;
+    context.serverCount = servers.size();
+    context.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (context.epollFd < 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "epoll create failed: %{public}s", strerror(errno));
+        return false;
+    }
+    auto state = std::make_shared<ResolveState>();
+    state->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = RESOLVE_EVENT;
+    if (state->eventFd < 0 || epoll_ctl(context.epollFd, EPOLL_CTL_ADD, state->eventFd, &event) < 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "eventfd init failed: %{public}s", strerror(errno));
+        close(context.epollFd);
+        return false;
+    }
+    for (const auto &request : requests) {
+        state->hosts.push_back(request.server);
+    }
+    for (size_t i = 0; i < std::min(requests.size(), MAX_RESOLVER_THREADS); i++) {
+        if (g_resolverThreads++ >= MAX_RESOLVER_THREADS) {
+            g_resolverThreads--;
+            TIME_HILOGW(TIME_MODULE_SERVICE, "resolver threads busy, started:%{public}zu", i);
+            break;
+        }
+        std::thread(Resolve, state).detach();
+    }
+
+    size_t pending = requests.size();
+    while (!context.success && pending > 0) {
+        TimeUtils::GetBootTimeMs(now);
+        int64_t wakeTime = deadline;
+        for (size_t i = 0; i < requests.size() && !context.success; i++) {
+            auto &request = requests[i];
+            if (request.finished) {
+                continue;
+            }
+            if (!request.samples.empty() && request.sampleDeadline <= now) {
+                CompleteRequest(request, context);
+                FinishRequest(request, context, false);
+                pending--;
+                continue;
+            }
+            if (request.winner < 0 && request.nextAttemptTime > 0 && request.nextAttemptTime <= now &&
+                !StartAttempt(request, i, context) && !HasLiveAttempt(request)) {
+                RecordFailure(request.server, false);
+                request.outcome = NtpSyncOutcome::ERROR;
+                FinishRequest(request, context, false);
+                pending--;
+                continue;
+            }
+            if (request.samples.empty() && request.nextAttemptTime == 0 && request.sampleDeadline > 0 &&
+                request.sampleDeadline <= now && request.retransmits < NTP_MAX_RETRANSMIT) {
+                Retransmit(request);
+            }
+            if (!request.samples.empty()) {
+                wakeTime = std::min(wakeTime, request.sampleDeadline);
+            } else if (request.winner < 0 && request.nextAttemptTime > 0) {
+                wakeTime = std::min(wakeTime, request.nextAttemptTime);
+            } else if (request.sampleDeadline > 0 && request.retransmits < NTP_MAX_RETRANSMIT) {
+                wakeTime = std::min(wakeTime, request.sampleDeadline);
+            }
+        }
+        if (context.success || pending == 0 || now >= deadline) {
+            break;
+        }
+        struct epoll_event events[MAX_EVENTS];
+        // a negative timeout would wait without end
+        int timeout = static_cast<int>(std::max<int64_t>(wakeTime - now, 0));
+        int num = epoll_wait(context.epollFd, events, MAX_EVENTS, timeout);
+        if (num < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            TIME_HILOGE(TIME_MODULE_SERVICE, "epoll wait failed: %{public}s", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < num && !context.success; i++) {
+            if (events[i].data.u64 != RESOLVE_EVENT) {
+                size_t index = static_cast<size_t>(events[i].data.u64 >> ATTEMPT_INDEX_BITS);
+                size_t attemptIndex = static_cast<size_t>(events[i].data.u64 & ATTEMPT_INDEX_MASK);
+                auto &request = requests[index];
+                if (!request.finished && HandleAnswer(request, index, attemptIndex, context)) {
+                    FinishRequest(request, context, false);
+                    pending--;
+                }
+                continue;
+            }
+            uint64_t count = 0;
+            if (read(state->eventFd, &count, sizeof(count)) < 0) {
+                TIME_HILOGW(TIME_MODULE_SERVICE, "read resolve event failed: %{public}s", strerror(errno));
+            }
+            std::vector<ResolveState::Answer> answers;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                answers.swap(state->answers);
+            }
+            for (auto &answer : answers) {
+                auto &request = requests[answer.index];
+                request.addresses = std::move(answer.addresses);
+                if (!StartAttempt(request, answer.index, context)) {
+                    TIME_HILOGE(TIME_MODULE_SERVICE, "no usable address: %{public}s", request.server.c_str());
+                    RecordFailure(request.server, false);
+                    request.outcome = NtpSyncOutcome::ERROR;
+                    FinishRequest(request, context, false);
+                    pending--;
+                }
+            }
+        }
+    }
+    for (auto &request : requests) {
+        if (!request.finished && !context.success && !request.samples.empty()) {
+            CompleteRequest(request, context);
+            FinishRequest(request, context, false);
+        }
+    }
+    for (auto &request : requests) {
+        if (!request.finished) {
+            // requests left behind by an early success are not counted against their server
+            if (!context.success) {
+                TIME_HILOGW(TIME_MODULE_SERVICE, "ntp server timeout: %{public}s", request.server.c_str());
+                RecordFailure(request.server, true);
+            }
+            request.outcome = context.success ? NtpSyncOutcome::CANCELLED : NtpSyncOutcome::TIMEOUT;
+            FinishRequest(request, context, !context.success);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->cancelled = true;
+    }
+    close(context.epollFd);
+    return context.success;
+}
+
+bool SntpQueryEngine::StartAttempt(Request &request, size_t index, QueryContext &context)
+{
+    while (request.nextAddress < request.addresses.size()) {
+        Attempt attempt;
+        attempt.address = request.addresses[request.nextAddress++];
+        const auto &addr = attempt.address.addr;
+        attempt.fd = socket(addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+        if (attempt.fd < 0) {
+            TIME_HILOGE(TIME_MODULE_SERVICE, "create socket failed: %{public}s", strerror(errno));
+            NtpResolver::GetInstance().ReportResult(attempt.address, false);
+            continue;
+        }
+        struct epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.u64 = (static_cast<uint64_t>(index) << ATTEMPT_INDEX_BITS) | request.attempts.size();
+        // connecting a UDP socket does not block, an unreachable family fails right here
+        if (connect(attempt.fd, reinterpret_cast<const struct sockaddr *>(&addr), attempt.address.addrLen) < 0 ||
+            !SendSample(request, attempt) || epoll_ctl(context.epollFd, EPOLL_CTL_ADD, attempt.fd, &event) < 0) {
+            TIME_HILOGE(TIME_MODULE_SERVICE, "attempt failed: %{public}s, Host: %{public}s", strerror(errno),
+                request.server.c_str());
+            NtpResolver::GetInstance().ReportResult(attempt.address, false);
+            close(attempt.fd);
+            continue;
+        }
+        request.attempts.push_back(attempt);
+        int64_t now = 0;
+        TimeUtils::GetBootTimeMs(now);
+        request.nextAttemptTime = (request.nextAddress < request.addresses.size()) ? now + HAPPY_EYEBALLS_DELAY : 0;
+        return true;
+    }
+    request.nextAttemptTime = 0;
+    return false;
+}
+
+bool SntpQueryEngine::SendSample(Request &request, Attempt &attempt)
+{
+    char sendBuf[NTP_PACKAGE_SIZE] = { 0 };
+    attempt.client.CreateMessage(sendBuf);
+    if (send(attempt.fd, sendBuf, NTP_PACKAGE_SIZE, 0) < 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "Send socket message failed: %{public}s, Host: %{public}s",
+            strerror(errno), request.server.c_str());
+        return false;
+    }
+    int64_t now = 0;
+    TimeUtils::GetBootTimeMs(now);
+    request.sampleDeadline = now + NTP_SAMPLE_TIMEOUT;
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    serverStats_[request.server].requests++;
+    return true;
+}
+
+void SntpQueryEngine::Retransmit(Request &request)
+{
+    request.retransmits++;
+    // the next round waits for its timeout even if no resend went out, so that the query does not spin
+    int64_t now = 0;
+    TimeUtils::GetBootTimeMs(now);
+    request.sampleDeadline = now + NTP_SAMPLE_TIMEOUT;
+    for (auto &attempt : request.attempts) {
+        if (attempt.fd >= 0) {
+            TIME_HILOGI(TIME_MODULE_SERVICE, "retransmit to %{public}s", request.server.c_str());
+            SendSample(request, attempt);
+        }
+    }
+}
+
+bool SntpQueryEngine::HandleAnswer(Request &request, size_t index, size_t attemptIndex, QueryContext &context)
+{
+    auto &attempt = request.attempts[attemptIndex];
+    if (attempt.fd < 0) {
+        return false;
+    }
+    char bufferRx[NTP_PACKAGE_SIZE] = { 0 };
+    ssize_t len = recv(attempt.fd, bufferRx, NTP_PACKAGE_SIZE, 0);
+    if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return false;
+    }
+    bool received = len >= NTP_PACKAGE_SIZE && attempt.client.ReceivedMessage(bufferRx);
+    // a late answer to a request already settled, e.g. to a retransmitted copy, is dropped
+    if (!received && len >= NTP_PACKAGE_SIZE && attempt.client.isStaleAnswer()) {
+        return false;
+    }
+    if (attempt.client.getStratum() >= 0) {
+        request.stratum = attempt.client.getStratum();
+    }
+    if (!received) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "Receive socket message failed: %{public}s, Host: %{public}s",
+            len < 0 ? strerror(errno) : "invalid message", request.server.c_str());
+        RecordFailure(request.server, false);
+        NtpResolver::GetInstance().ReportResult(attempt.address, false);
+        CloseAttempt(attempt, context.epollFd);
+        // a rejected sample, e.g. a rate limiting kiss-o'-death, ends the burst but keeps what was collected
+        if (!request.samples.empty()) {
+            CompleteRequest(request, context);
+            return true;
+        }
+        // the race is still open, the next address does not need to wait for its turn
+        if (request.winner < 0) {
+            StartAttempt(request, index, context);
+        }
+        if (HasLiveAttempt(request) || request.nextAddress < request.addresses.size()) {
+            return false;
+        }
+        request.outcome = NtpSyncOutcome::ERROR;
+        return true;
+    }
+    if (request.winner < 0) {
+        request.winner = static_cast<int32_t>(attemptIndex);
+        request.nextAttemptTime = 0;
+        NtpResolver::GetInstance().ReportResult(attempt.address, true);
+        for (size_t i = 0; i < request.attempts.size(); i++) {
+            if (i != attemptIndex) {
+                CloseAttempt(request.attempts[i], context.epollFd);
+            }
+        }
+    }
+    NtpSample sample;
+    sample.offsetUs = attempt.client.getClockOffsetUs();
+    sample.delayUs = attempt.client.getRoundTripTimeUs();
+    sample.referenceUs = attempt.client.getNtpTimeReferenceUs();
+    request.samples.push_back(sample);
+    RecordAnswer(request.server, sample.delayUs / MICRO_TO_MILLI);
+    if (request.samples.size() < NTP_SAMPLE_COUNT && SendSample(request, attempt)) {
+        return false;
+    }
+    CompleteRequest(request, context);
+    return true;
+}
+
+void SntpQueryEngine::CompleteRequest(Request &request, QueryContext &context)
+{
+    NtpSample sample = ClockDiscipline::CombineSamples(request.samples);
+    request.completed = true;
+    request.result = sample;
+    auto timeResult = std::make_shared<NtpTrustedTime::TimeResult>(
+        (sample.referenceUs + sample.offsetUs) / MICRO_TO_MILLI, sample.referenceUs / MICRO_TO_MILLI,
+        sample.delayUs / MICRO_TO_MILLI / HALF, request.server);
+    auto &trustedTime = NtpTrustedTime::GetInstance();
+    if (request.trusted) {
+        TIME_HILOGI(TIME_MODULE_SERVICE, "ntpSpecServer answered:%{public}s", request.server.c_str());
+        trustedTime.UpdateTrustedTimeResult(timeResult);
+        // if refresh time success, need to clear candidates list
+        trustedTime.ClearTimeResultCandidates();
+        request.outcome = NtpSyncOutcome::SPECIFIC;
+    } else if (trustedTime.UpdateTimeResult(timeResult)) {
+        TIME_HILOGI(TIME_MODULE_SERVICE, "ntpServer answered:%{public}s", request.server.c_str());
+        request.outcome = NtpSyncOutcome::AGREED;
+    } else {
+        request.outcome = NtpSyncOutcome::CANDIDATE;
+    }
+    // recorded before the vote, which settles the candidates in the history
+    AddSyncRecord(request, context);
+    if (request.outcome != NtpSyncOutcome::CANDIDATE) {
+        context.success = true;
+    } else if (trustedTime.HasTimeResultQuorum(context.serverCount)) {
+        context.success = trustedTime.FindBestTimeResult();
+    }
+}
+
+bool SntpQueryEngine::HasLiveAttempt(const Request &request)
+{
+    return std::any_of(request.attempts.begin(), request.attempts.end(),
+        [](const Attempt &attempt) { return attempt.fd >= 0; });
+}
+
+void SntpQueryEngine::CloseAttempt(Attempt &attempt, int epollFd)
+{
+    if (attempt.fd >= 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, attempt.fd, nullptr);
+        close(attempt.fd);
+        attempt.fd = -1;
+    }
+}
+
+void SntpQueryEngine::FinishRequest(Request &request, const QueryContext &context, bool isTimeout)
+{
+    for (auto &attempt : request.attempts) {
+        if (isTimeout && attempt.fd >= 0) {
+            NtpResolver::GetInstance().ReportResult(attempt.address, false);
+        }
+        CloseAttempt(attempt, context.epollFd);
+    }
+    if (!request.completed) {
+        AddSyncRecord(request, context);
+    }
+    request.finished = true;
+}
+
+void SntpQueryEngine::AddSyncRecord(const Request &request, const QueryContext &context)
+{
+    NtpSyncRecord record;
+    int64_t bootTime = 0;
+    TimeUtils::GetBootTimeMs(bootTime);
+    TimeUtils::GetWallTimeMs(record.time);
+    record.server = request.server;
+    record.outcome = request.outcome;
+    record.stratum = request.stratum;
+    record.samples = static_cast<uint32_t>(request.samples.size());
+    record.answerTime = bootTime - context.startTime;
+    if (request.winner >= 0) {
+        record.address = request.attempts[request.winner].address.ToString();
+    } else if (!request.attempts.empty()) {
+        record.address = request.attempts.back().address.ToString();
+    }
+    if (request.completed) {
+        int64_t referenceTime = request.result.referenceUs / MICRO_TO_MILLI;
+        int64_t serverTime = (request.result.referenceUs + request.result.offsetUs) / MICRO_TO_MILLI;
+        record.rtt = request.result.delayUs / MICRO_TO_MILLI;
+        // local wall time at the reference point, as the clock reads now
+        record.offset = serverTime - (record.time - (bootTime - referenceTime));
+    }
+    NtpSyncHistory::GetInstance().AddRecord(std::move(record));
+}
+
+void SntpQueryEngine::RecordAnswer(const std::string &server, int64_t rtt)
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    auto &stats = serverStats_[server];
+    stats.minRtt = (stats.answers == 0) ? rtt : std::min(stats.minRtt, rtt);
+    stats.maxRtt = (stats.answers == 0) ? rtt : std::max(stats.maxRtt, rtt);
+    stats.answers++;
+    stats.lastRtt = rtt;
+    stats.totalRtt += rtt;
+}
+
+void SntpQueryEngine::RecordFailure(const std::string &server, bool isTimeout)
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    auto &stats = serverStats_[server];
+    if (isTimeout) {
+        stats.timeouts++;
+    } else {
+        stats.errors++;
+    }
+}
+
+void SntpQueryEngine::ShowServerStats(int fd)
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    for (const auto &[server, stats] : serverStats_) {
+        dprintf(fd, " * server                  = %s\n", server.c_str());
+        dprintf(fd, "   * requests              = %" PRIu64 "\n", stats.requests);
+        dprintf(fd, "   * answers               = %" PRIu64 "\n", stats.answers);
+        dprintf(fd, "   * timeouts              = %" PRIu64 "\n", stats.timeouts);
+        dprintf(fd, "   * errors                = %" PRIu64 "\n", stats.errors);
+        if (stats.answers > 0) {
+            dprintf(fd, "   * rtt last/min/avg/max  = %" PRId64 "/%" PRId64 "/%" PRId64 "/%" PRId64 "ms\n",
+                stats.lastRtt, stats.minRtt, stats.totalRtt / static_cast<int64_t>(stats.answers), stats.maxRtt);
+        }
+    }
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "time_source_arbiter.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+#include "clock_discipline.h"
+#include "ntp_drift_model.h"
+#include "ntp_update_time.h"
+#include "time_common.h"
+#include "time_system_ability.h"
+#include "time_task_executor.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr int64_t SECOND_TO_MILLI = 1000;
+// the RTC counts whole seconds and is not disciplined while the device is off
+constexpr int64_t RTC_UNCERTAINTY = 2000;
+// at most one clock step is taken in this window, in ms
+constexpr int64_t CORRECTION_WINDOW = 60000;
+// executor key of the deferred correction
+constexpr const char* CORRECTION_TASK = "time_correction";
+constexpr const char* SOURCE_NAMES[] = { "nitz", "ntp", "rtc" };
+}
+
+TimeSourceArbiter &TimeSourceArbiter::GetInstance()
+{
+    static TimeSourceArbiter instance;
+    return instance;
+}
+
+void TimeSourceArbiter::Init()
+{
+    time_t rtcTime = 0;
+    int64_t bootTime = 0;
+    if (TimeSystemAbility::GetInstance()->GetRtcTime(rtcTime) != E_TIME_OK ||
+        TimeUtils::GetBootTimeMs(bootTime) != E_TIME_OK) {
+        return;
+    }
+    UpdateSample(TimeSource::RTC, static_cast<int64_t>(rtcTime) * SECOND_TO_MILLI, bootTime, RTC_UNCERTAINTY);
+}
+
+void TimeSourceArbiter::UpdateSample(TimeSource source, int64_t time, int64_t bootTime, int64_t uncertainty)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &sample = samples_[static_cast<size_t>(source)];
+    sample.time = time;
+    sample.bootTime = bootTime;
+    sample.uncertainty = uncertainty;
+    sample.updates++;
+}
+
+int64_t TimeSourceArbiter::GetUncertainty(const Sample &sample, int64_t bootTime)
+{
+    int64_t age = std::max<int64_t>(bootTime - sample.bootTime, 0);
+    return std::max<int64_t>(sample.uncertainty + NtpDriftModel::GetInstance().GetDriftBound(age), 1);
+}
+
+bool TimeSourceArbiter::GetEstimate(int64_t bootTime, int64_t &time, int64_t &uncertainty)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return GetEstimateLocked(bootTime, time, uncertainty);
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+bool TimeSourceArbiter::GetEstimateLocked(int64_t bootTime, int64_t &time, int64_t &uncertainty)
+{
+    const Sample *best = nullptr;
+    int64_t bestUncertainty = 0;
+    for (const auto &sample : samples_) {
+        if (sample.updates == 0) {
+            continue;
+        }
+        int64_t sampleUncertainty = GetUncertainty(sample, bootTime);
+        if (best == nullptr || sampleUncertainty < bestUncertainty) {
+            best = &sample;
+            bestUncertainty = sampleUncertainty;
+        }
+    }
+    if (best == nullptr) {
+        return false;
+    }
+    int64_t bestTime = best->time + bootTime - best->bootTime;
+    double weightSum = 0;
+    double weightedOffset = 0;
+    for (const auto &sample : samples_) {
+        if (sample.updates == 0) {
+            continue;
+        }
+        int64_t sampleTime = sample.time + bootTime - sample.bootTime;
+        int64_t sampleUncertainty = GetUncertainty(sample, bootTime);
+        // a sample whose error bound does not overlap the one of the best sample is an outlier
+        if (std::abs(sampleTime - bestTime) > sampleUncertainty + bestUncertainty) {
+            continue;
+        }
+        double weight = 1.0 / (static_cast<double>(sampleUncertainty) * sampleUncertainty);
+        weightSum += weight;
+        weightedOffset += weight * (sampleTime - bestTime);
+    }
+    time = bestTime + std::llround(weightedOffset / weightSum);
+    uncertainty = std::max<int64_t>(std::llround(1.0 / std::sqrt(weightSum)), 1);
+    return true;
+}
+
+bool TimeSourceArbiter::Correct(TimeSource source)
+{
+    std::lock_guard<std::mutex> correctLock(correctMutex_);
+    int64_t bootTime = 0;
+    int64_t wallTime = 0;
+    if (TimeUtils::GetBootTimeMs(bootTime) != E_TIME_OK || TimeUtils::GetWallTimeMs(wallTime) != E_TIME_OK) {
+        return false;
+    }
+    int64_t time = 0;
+    int64_t uncertainty = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!GetEstimateLocked(bootTime, time, uncertainty)) {
+            return false;
+        }
+        lastOffset_ = time - wallTime;
+        // the clock is as good as the estimate, any correction would only add noise
+        if (std::abs(lastOffset_) <= uncertainty) {
+            skipped_++;
+            return false;
+        }
+    }
+    #ifdef CLOCK_DISCIPLINE_ENABLE
+    // small offsets are slewed away, which spares the time change broadcast and the timer rebatch of a step
+    if (ClockDiscipline::GetInstance().Slew(time)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slews_++;
+        return true;
+    }
+    #endif
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t windowEnd = lastStepTime_ + CORRECTION_WINDOW;
+        if (lastStepTime_ > 0 && bootTime < windowEnd) {
+            deferred_++;
+            TIME_HILOGI(TIME_MODULE_SERVICE, "defer correction, source:%{public}s offset:%{public}" PRId64 "",
+                SOURCE_NAMES[static_cast<size_t>(source)], lastOffset_);
+            // the samples may have moved on by then, the estimate is taken again
+            auto correct = [source]() {
+                if (NtpUpdateTime::GetInstance().CheckStatus()) {
+                    TimeSourceArbiter::GetInstance().Correct(source);
+                }
+            };
+            TimeTaskExecutor::GetInstance().PostPeriodic(CORRECTION_TASK, correct, windowEnd - bootTime);
+            return false;
+        }
+    }
+    TIME_HILOGI(TIME_MODULE_SERVICE, "step clock, source:%{public}s offset:%{public}" PRId64
+        " uncertainty:%{public}" PRId64 "", SOURCE_NAMES[static_cast<size_t>(source)], time - wallTime, uncertainty);
+    return TimeSystemAbility::GetInstance()->SetTimeInner(time) == E_TIME_OK;
+}
+
+void TimeSourceArbiter::OnClockStepped(int64_t bootTime)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    lastStepTime_ = bootTime;
+    steps_++;
+}
+
+void TimeSourceArbiter::ShowArbitrationInfo(int fd)
+{
+    int64_t bootTime = 0;
+    TimeUtils::GetBootTimeMs(bootTime);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < TIME_SOURCE_COUNT; i++) {
+        const auto &sample = samples_[i];
+        dprintf(fd, " * source                  = %s\n", SOURCE_NAMES[i]);
+        if (sample.updates == 0) {
+            dprintf(fd, "   * sample                = none\n");
+            continue;
+        }
+        dprintf(fd, "   * time                  = %" PRId64 "\n", sample.time + bootTime - sample.bootTime);
+        dprintf(fd, "   * age                   = %" PRId64 "s\n", (bootTime - sample.bootTime) / SECOND_TO_MILLI);
+        dprintf(fd, "   * uncertainty           = %" PRId64 "ms\n", GetUncertainty(sample, bootTime));
+        dprintf(fd, "   * updates               = %" PRIu64 "\n", sample.updates);
+    }
+    int64_t time = 0;
+    int64_t uncertainty = 0;
+    if (GetEstimateLocked(bootTime, time, uncertainty)) {
+        dprintf(fd, " * estimate                = %" PRId64 "\n", time);
+        dprintf(fd, " * estimate uncertainty    = %" PRId64 "ms\n", uncertainty);
+    } else {
+        dprintf(fd, " * estimate                = none\n");
+    }
+    dprintf(fd, " * last offset             = %" PRId64 "ms\n", lastOffset_);
+    dprintf(fd, " * clock steps             = %" PRIu64 "\n", steps_);
+    dprintf(fd, " * slewed corrections      = %" PRIu64 "\n", slews_);
+    dprintf(fd, " * skipped corrections     = %" PRIu64 "\n", skipped_);
+    dprintf(fd, " * deferred corrections    = %" PRIu64 "\n", deferred_);
+    if (lastStepTime_ > 0) {
+        dprintf(fd, " * last step age           = %" PRId64 "s\n", (bootTime - lastStepTime_) / SECOND_TO_MILLI);
+    }
+}
+} // namespace MiscServices
+} // namespace OHOS
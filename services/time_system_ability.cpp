@@ -15,6 +15,7 @@
 #include "time_system_ability.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <linux/rtc.h>
 #include <sstream>
 #include <sys/ioctl.h>
@@ -32,12 +33,24 @@
 #include "parameters.h"
 #include "event_manager.h"
 #include "simple_timer_info.h"
+#include "ntp_drift_model.h"
+#include "ntp_sync_history.h"
+#include "sntp_query_engine.h"
+#include "time_source_arbiter.h"
+#include "time_task_executor.h"
+#include "timer_flight_recorder.h"
+#include "timer_lateness.h"
+#include "timer_wakeup_stats.h"
 
 #ifdef MULTI_ACCOUNT_ENABLE
 #include "os_account.h"
 #include "os_account_manager.h"
 #endif
 
+#ifdef POWER_MANAGER_ENABLE
+#include "running_lock_coordinator.h"
+#endif
+
 using namespace std::chrono;
 using namespace OHOS::EventFwk;
 using namespace OHOS::HiviewDFX;
@@ -50,6 +63,11 @@ static constexpr int MILLI_TO_BASE = 1000LL;
 static constexpr int MICR_TO_BASE = 1000000LL;
 static constexpr int NANO_TO_BASE = 1000000000LL;
 static constexpr std::int32_t INIT_INTERVAL = 10L;
+// executor key of the pending RTC write
+static constexpr const char* RTC_WRITE_TASK = "rtc_write";
+// keyed so the retries are never rejected by a full executor queue
+static constexpr const char* INIT_RETRY_TASK = "init_retry";
+static constexpr const char* REPUBLISH_RETRY_TASK = "republish_events_retry";
 static constexpr uint32_t TIMER_TYPE_REALTIME_MASK = 1 << 0;
 static constexpr uint32_t TIMER_TYPE_REALTIME_WAKEUP_MASK = 1 << 1;
 static constexpr uint32_t TIMER_TYPE_EXACT_MASK = 1 << 2;
@@ -109,7 +127,12 @@ TimeSystemAbility::TimeSystemAbility() : state_(ServiceRunningState::STATE_NOT_S
 {
 }
 
-TimeSystemAbility::~TimeSystemAbility(){};
+TimeSystemAbility::~TimeSystemAbility()
+{
+    if (rtcFd_ >= 0) {
+        close(rtcFd_);
+    }
+}
 
 sptr<TimeSystemAbility> TimeSystemAbility::GetInstance()
 {
@@ -168,6 +191,75 @@ void TimeSystemAbility::InitDumpCmd()
         "dump adjust time.",
         [this](int fd, const std::vector<std::string> &input) { DumpAdjustTime(fd, input); });
     TimeCmdDispatcher::GetInstance().RegisterCommand(cmdAdjustTimer);
+
+    auto cmdNtpServer = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-ntp", "-a" }),
+        "dump ntp server statistics, include answers, timeouts and round trip time.",
+        [this](int fd, const std::vector<std::string> &input) { DumpNtpServerInfo(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdNtpServer);
+
+    auto cmdNtpHistory = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-ntp", "-l" }),
+        "dump ntp sync history, include per attempt records and latency percentiles per server.",
+        [this](int fd, const std::vector<std::string> &input) { DumpNtpSyncHistory(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdNtpHistory);
+
+    auto cmdExecutor = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-executor", "-a" }),
+        "dump task executor, include worker threads, queued tasks and coalesced posts.",
+        [this](int fd, const std::vector<std::string> &input) { DumpTaskExecutorInfo(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdExecutor);
+
+    auto cmdTimeSource = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-source", "-a" }),
+        "dump time source arbitration, include nitz, ntp and rtc samples and the corrections taken.",
+        [this](int fd, const std::vector<std::string> &input) { DumpTimeSourceInfo(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdTimeSource);
+
+    auto cmdTimerTrace = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-timer", "-trace", "[on|off]" }),
+        "start or stop recording the timer workload to a trace for timer_replay.",
+        [this](int fd, const std::vector<std::string> &input) { DumpTimerTrace(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdTimerTrace);
+
+    auto cmdCoalesce = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-coalesce", "-a" }),
+        "dump timer coalescing, include the policy in use and the wakeups under each policy.",
+        [this](int fd, const std::vector<std::string> &input) { DumpCoalesceInfo(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdCoalesce);
+
+    auto cmdCoalescePolicy = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-coalesce", "-p", "[policy]" }),
+        "set the timer coalescing policy, first_fit, best_fit or min_wakeup.",
+        [this](int fd, const std::vector<std::string> &input) { DumpSetCoalescePolicy(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdCoalescePolicy);
+
+    auto cmdLateness = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-lateness", "-a" }),
+        "dump timer lateness, include percentiles of the wakeup, collection and delivery stages.",
+        [this](int fd, const std::vector<std::string> &input) { DumpTimerLateness(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdLateness);
+
+    auto cmdFlight = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-flight", "-a" }),
+        "dump the recent timer operations of every thread in time order.",
+        [this](int fd, const std::vector<std::string> &input) { DumpTimerFlightRecords(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdFlight);
+
+    auto cmdWakeup = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-wakeup", "-a" }),
+        "dump kernel wakeups per uid, include batch sizes, charged timers and free riders per window.",
+        [this](int fd, const std::vector<std::string> &input) { DumpTimerWakeupInfo(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdWakeup);
+
+    auto cmdJson = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-json", "-a" }),
+        "dump timer entries, batches, proxies, adjust state and counters as JSON lines.",
+        [this](int fd, const std::vector<std::string> &input) { DumpTimerJsonLines(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdJson);
+
+    #ifdef LOCK_PROFILE_ENABLE
+    auto cmdLock = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-lock", "-a" }),
+        "dump lock profiles, include wait and hold times and the call sites of the longest ones.",
+        [this](int fd, const std::vector<std::string> &input) { DumpLockInfo(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdLock);
+    #endif
+
+    #ifdef POWER_MANAGER_ENABLE
+    auto cmdRunningLock = std::make_shared<TimeCmdParse>(std::vector<std::string>({ "-runninglock", "-a" }),
+        "dump running lock statistics, include lock ipc calls and hold time per wakeup.",
+        [this](int fd, const std::vector<std::string> &input) { DumpRunningLockInfo(fd, input); });
+    TimeCmdDispatcher::GetInstance().RegisterCommand(cmdRunningLock);
+    #endif
 }
 #endif
 
@@ -182,6 +274,8 @@ void TimeSystemAbility::OnStart()
     TimeTickNotify::GetInstance().Init();
     TimeZoneInfo::GetInstance().Init();
     NtpUpdateTime::GetInstance().Init();
+    TimerLateness::GetInstance().StartReport();
+    TimerWakeupStats::GetInstance().StartReport();
     // This parameter is set to true by init only after all services have been started,
     // and is automatically set to false after shutdown. Otherwise it will not be modified.
     std::string bootCompleted = system::GetParameter(BOOTEVENT_PARAMETER, "");
@@ -207,12 +301,8 @@ void TimeSystemAbility::OnStart()
     InitDumpCmd();
     #endif
     if (Init() != ERR_OK) {
-        auto callback = [this]() {
-            sleep(INIT_INTERVAL);
-            Init();
-        };
-        std::thread thread(callback);
-        thread.detach();
+        auto callback = [this]() { Init(); };
+        TimeTaskExecutor::GetInstance().PostPeriodic(INIT_RETRY_TASK, callback, INIT_INTERVAL * MILLI_TO_BASE);
         TIME_HILOGE(TIME_MODULE_SERVICE, "Init failed. Try again 10s later");
     }
 }
@@ -273,12 +363,8 @@ void TimeSystemAbility::RegisterCommonEventSubscriber()
     bool subRes = TimeServiceNotify::GetInstance().RepublishEvents();
     if (!subRes) {
         TIME_HILOGE(TIME_MODULE_SERVICE, "failed to RegisterCommonEventSubscriber");
-        auto callback = [this]() {
-            sleep(INIT_INTERVAL);
-            TimeServiceNotify::GetInstance().RepublishEvents();
-        };
-        std::thread thread(callback);
-        thread.detach();
+        auto callback = []() { TimeServiceNotify::GetInstance().RepublishEvents(); };
+        TimeTaskExecutor::GetInstance().PostPeriodic(REPUBLISH_RETRY_TASK, callback, INIT_INTERVAL * MILLI_TO_BASE);
     }
     RegisterSubscriber();
     NtpUpdateTime::SetSystemTime(NtpUpdateSource::REGISTER_SUBSCRIBER);
@@ -562,6 +648,7 @@ bool TimeSystemAbility::SetRealTime(int64_t time)
             strerror(errno));
         return false;
     }
+    TimeSourceArbiter::GetInstance().OnClockStepped(bootTime);
     auto ret = SetRtcTime(tv.tv_sec);
     if (ret == E_TIME_SET_RTC_FAILED) {
         TIME_HILOGE(TIME_MODULE_SERVICE, "set rtc fail:%{public}d", ret);
@@ -714,31 +801,163 @@ void TimeSystemAbility::DumpAdjustTime(int fd, const std::vector<std::string> &i
     dprintf(fd, "\n - dump adjust timer info:\n");
     TimerProxy::GetInstance().ShowAdjustTimerInfo(fd);
 }
+
+void TimeSystemAbility::DumpNtpServerInfo(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump ntp server info:\n");
+    NtpTrustedTime::GetInstance().ShowTrustedTimeInfo(fd);
+    SntpQueryEngine::GetInstance().ShowServerStats(fd);
+    NtpResolver::GetInstance().ShowResolverInfo(fd);
+    NtpDriftModel::GetInstance().ShowDriftModelInfo(fd);
+    #ifdef CLOCK_DISCIPLINE_ENABLE
+    ClockDiscipline::GetInstance().ShowClockDisciplineInfo(fd);
+    #endif
+}
+
+void TimeSystemAbility::DumpNtpSyncHistory(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump ntp sync history:\n");
+    NtpSyncHistory::GetInstance().ShowSyncHistory(fd);
+}
+
+void TimeSystemAbility::DumpTaskExecutorInfo(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump task executor info:\n");
+    TimeTaskExecutor::GetInstance().ShowExecutorInfo(fd);
+}
+
+void TimeSystemAbility::DumpTimeSourceInfo(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump time source info:\n");
+    TimeSourceArbiter::GetInstance().ShowArbitrationInfo(fd);
+}
+
+void TimeSystemAbility::DumpTimerTrace(int fd, const std::vector<std::string> &input)
+{
+    int paramPos = 2;
+    auto timerManager = TimerManager::GetInstance();
+    if (timerManager == nullptr) {
+        return;
+    }
+    if (input.at(paramPos) == "on") {
+        dprintf(fd, "\n - timer trace %s\n", timerManager->StartTrace() ? "started" : "failed to start");
+    } else if (input.at(paramPos) == "off") {
+        dprintf(fd, "\n - timer trace stopped, records:%" PRIu64 "\n", timerManager->StopTrace());
+    } else {
+        dprintf(fd, "\n - unknown timer trace state:%s\n", input.at(paramPos).c_str());
+    }
+}
+
+void TimeSystemAbility::DumpCoalesceInfo(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump timer coalescing info:\n");
+    auto timerManager = TimerManager::GetInstance();
+    if (timerManager == nullptr) {
+        return;
+    }
+    timerManager->ShowCoalesceInfo(fd);
+}
+
+void TimeSystemAbility::DumpSetCoalescePolicy(int fd, const std::vector<std::string> &input)
+{
+    int paramPos = 2;
+    auto timerManager = TimerManager::GetInstance();
+    if (timerManager == nullptr) {
+        return;
+    }
+    CoalescePolicy policy;
+    if (!TimerScheduler::ParsePolicy(input.at(paramPos), policy)) {
+        dprintf(fd, "\n - unknown coalesce policy:%s\n", input.at(paramPos).c_str());
+        return;
+    }
+    timerManager->SetCoalescePolicy(policy);
+    dprintf(fd, "\n - coalesce policy:%s\n", TimerScheduler::GetPolicyName(policy));
+}
+
+void TimeSystemAbility::DumpTimerLateness(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump timer lateness info:\n");
+    TimerLateness::GetInstance().ShowLatenessInfo(fd);
+}
+
+void TimeSystemAbility::DumpTimerFlightRecords(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump timer flight records:\n");
+    TimerFlightRecorder::GetInstance().ShowRecords(fd);
+}
+
+void TimeSystemAbility::DumpTimerWakeupInfo(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump timer wakeup info:\n");
+    TimerWakeupStats::GetInstance().ShowWakeupInfo(fd);
+}
+
+void TimeSystemAbility::DumpTimerJsonLines(int fd, const std::vector<std::string> &input)
+{
+    // no header, every line of the output is a JSON object
+    auto timerManager = TimerManager::GetInstance();
+    if (timerManager != nullptr) {
+        timerManager->ShowJsonLines(fd);
+    }
+    TimerProxy::GetInstance().ShowJsonLines(fd);
+}
+
+#ifdef LOCK_PROFILE_ENABLE
+void TimeSystemAbility::DumpLockInfo(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump lock profile info:\n");
+    ProfiledMutex::ShowLockInfo(fd);
+}
+#endif
+
+#ifdef POWER_MANAGER_ENABLE
+void TimeSystemAbility::DumpRunningLockInfo(int fd, const std::vector<std::string> &input)
+{
+    dprintf(fd, "\n - dump running lock info:\n");
+    RunningLockCoordinator::GetInstance().ShowRunningLockInfo(fd);
+}
+#endif
 #endif
 
 int TimeSystemAbility::SetRtcTime(time_t sec)
 {
-    struct rtc_time rtc {};
-    struct tm tm {};
-    struct tm *gmtime_res = nullptr;
-    FILE* fd = nullptr;
-    int res;
     if (rtcId < 0) {
         TIME_HILOGE(TIME_MODULE_SERVICE, "invalid rtc id:%{public}s:", strerror(ENODEV));
         return E_TIME_SET_RTC_FAILED;
     }
-    std::stringstream strs;
-    strs << "/dev/rtc" << rtcId;
-    auto rtcDev = strs.str();
-    TIME_HILOGI(TIME_MODULE_SERVICE, "rtc_dev :%{public}s:", rtcDev.data());
-    auto rtcData = rtcDev.data();
-    fd = fopen(rtcData, "r+");
-    if (fd == NULL) {
-        TIME_HILOGE(TIME_MODULE_SERVICE, "open failed %{public}s:%{public}s", rtcDev.data(), strerror(errno));
-        return E_TIME_SET_RTC_FAILED;
+    int64_t bootTime = 0;
+    TimeUtils::GetBootTimeMs(bootTime);
+    {
+        std::lock_guard<std::mutex> lock(rtcMutex_);
+        pendingRtcTime_ = static_cast<int64_t>(sec) * MILLI_TO_BASE;
+        pendingRtcBootTime_ = bootTime;
+    }
+    // slow RTC hardware does not hold up the caller, a write still queued picks up the latest time
+    auto result = TimeTaskExecutor::GetInstance().Post(RTC_WRITE_TASK, [this]() { WriteRtcTime(); });
+    if (result == TimeTaskExecutor::PostResult::REJECTED) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "rtc write dropped, executor queue full");
     }
-    gmtime_res = gmtime_r(&sec, &tm);
-    if (gmtime_res) {
+    return E_TIME_OK;
+}
+
+void TimeSystemAbility::WriteRtcTime()
+{
+    int64_t bootTime = 0;
+    TimeUtils::GetBootTimeMs(bootTime);
+    {
+        std::lock_guard<std::mutex> lock(rtcMutex_);
+        int fd = GetRtcFdLocked();
+        if (fd < 0) {
+            return;
+        }
+        // the time queued has kept running while the write waited
+        time_t sec = static_cast<time_t>((pendingRtcTime_ + bootTime - pendingRtcBootTime_) / MILLI_TO_BASE);
+        struct tm tm {};
+        if (gmtime_r(&sec, &tm) == nullptr) {
+            TIME_HILOGE(TIME_MODULE_SERVICE, "convert rtc time failed:%{public}s", strerror(errno));
+            return;
+        }
+        struct rtc_time rtc {};
         rtc.tm_sec = tm.tm_sec;
         rtc.tm_min = tm.tm_min;
         rtc.tm_hour = tm.tm_hour;
@@ -748,21 +967,62 @@ int TimeSystemAbility::SetRtcTime(time_t sec)
         rtc.tm_wday = tm.tm_wday;
         rtc.tm_yday = tm.tm_yday;
         rtc.tm_isdst = tm.tm_isdst;
-        int fd_int = fileno(fd);
-        res = ioctl(fd_int, RTC_SET_TIME, &rtc);
+        int res = ioctl(fd, RTC_SET_TIME, &rtc);
         if (res < 0) {
             TIME_HILOGE(TIME_MODULE_SERVICE, "ioctl RTC_SET_TIME failed,errno:%{public}s, res:%{public}d",
                 strerror(errno), res);
+            // the device is opened again on the next access
+            close(rtcFd_);
+            rtcFd_ = -1;
+            return;
         }
-    } else {
-        TIME_HILOGE(TIME_MODULE_SERVICE, "convert rtc time failed:%{public}s", strerror(errno));
-        res = E_TIME_SET_RTC_FAILED;
     }
-    int result = fclose(fd);
-    if (result != 0) {
-        TIME_HILOGE(TIME_MODULE_SERVICE, "file close failed:%{public}d", result);
+    // the RTC reading saved with the trusted time is stale once the RTC is set
+    NtpTrustedTime::GetInstance().SaveTimeResult();
+}
+
+// needs to acquire the lock `rtcMutex_` before calling this method
+int TimeSystemAbility::GetRtcFdLocked()
+{
+    if (rtcFd_ >= 0) {
+        return rtcFd_;
     }
-    return res;
+    if (rtcId < 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "invalid rtc id:%{public}s:", strerror(ENODEV));
+        return -1;
+    }
+    std::string rtcDev = "/dev/rtc" + std::to_string(rtcId);
+    rtcFd_ = open(rtcDev.c_str(), O_RDWR | O_CLOEXEC);
+    if (rtcFd_ < 0) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "open failed %{public}s:%{public}s", rtcDev.c_str(), strerror(errno));
+    }
+    return rtcFd_;
+}
+
+int32_t TimeSystemAbility::GetRtcTime(time_t &sec)
+{
+    struct rtc_time rtc {};
+    {
+        std::lock_guard<std::mutex> lock(rtcMutex_);
+        int fd = GetRtcFdLocked();
+        if (fd < 0) {
+            return E_TIME_DEAL_FAILED;
+        }
+        if (ioctl(fd, RTC_RD_TIME, &rtc) < 0) {
+            TIME_HILOGE(TIME_MODULE_SERVICE, "ioctl RTC_RD_TIME failed,errno:%{public}s", strerror(errno));
+            return E_TIME_DEAL_FAILED;
+        }
+    }
+    struct tm tm {};
+    tm.tm_sec = rtc.tm_sec;
+    tm.tm_min = rtc.tm_min;
+    tm.tm_hour = rtc.tm_hour;
+    tm.tm_mday = rtc.tm_mday;
+    tm.tm_mon = rtc.tm_mon;
+    tm.tm_year = rtc.tm_year;
+    // the RTC is kept in UTC, see SetRtcTime
+    sec = timegm(&tm);
+    return (sec < 0) ? E_TIME_DEAL_FAILED : E_TIME_OK;
 }
 
 bool TimeSystemAbility::CheckRtc(const std::string &rtcPath, uint64_t rtcId)
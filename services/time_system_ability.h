@@ -59,6 +59,8 @@ public:
     int32_t SetTime(int64_t time, int8_t apiVersion = APIVersion::API_VERSION_7) override;
     int32_t SetTimeInner(int64_t time, int8_t apiVersion = APIVersion::API_VERSION_7);
     bool SetRealTime(int64_t time);
+    // Reads the wall clock RTC, which keeps running while the device is off, in seconds.
+    int32_t GetRtcTime(time_t &sec);
     int32_t SetAutoTime(bool autoTime) override;
     int32_t SetTimeZone(const std::string &timeZoneId, int8_t apiVersion = APIVersion::API_VERSION_7) override;
     int32_t SetTimeZoneInner(const std::string &timeZoneId, int8_t apiVersion = APIVersion::API_VERSION_7);
@@ -96,6 +98,23 @@ public:
     void DumpPidTimerMapInfo(int fd, const std::vector<std::string> &input);
     void DumpProxyDelayTime(int fd, const std::vector<std::string> &input);
     void DumpAdjustTime(int fd, const std::vector<std::string> &input);
+    void DumpNtpServerInfo(int fd, const std::vector<std::string> &input);
+    void DumpNtpSyncHistory(int fd, const std::vector<std::string> &input);
+    void DumpTaskExecutorInfo(int fd, const std::vector<std::string> &input);
+    void DumpTimeSourceInfo(int fd, const std::vector<std::string> &input);
+    void DumpTimerTrace(int fd, const std::vector<std::string> &input);
+    void DumpCoalesceInfo(int fd, const std::vector<std::string> &input);
+    void DumpSetCoalescePolicy(int fd, const std::vector<std::string> &input);
+    void DumpTimerLateness(int fd, const std::vector<std::string> &input);
+    void DumpTimerFlightRecords(int fd, const std::vector<std::string> &input);
+    void DumpTimerWakeupInfo(int fd, const std::vector<std::string> &input);
+    void DumpTimerJsonLines(int fd, const std::vector<std::string> &input);
+    #ifdef LOCK_PROFILE_ENABLE
+    void DumpLockInfo(int fd, const std::vector<std::string> &input);
+    #endif
+    #ifdef POWER_MANAGER_ENABLE
+    void DumpRunningLockInfo(int fd, const std::vector<std::string> &input);
+    #endif
     void InitDumpCmd();
     #endif
     void RegisterCommonEventSubscriber();
@@ -119,7 +138,11 @@ private:
     void ParseTimerPara(const std::shared_ptr<ITimerInfo> &timerOptions, TimerPara &paras);
     int32_t CheckTimerPara(const DatabaseType type, const TimerPara &paras);
     bool GetTimeByClockId(clockid_t clockId, struct timespec &tv);
+    // Queues `sec` for the RTC writer, a burst of sets only writes the latest time.
     int SetRtcTime(time_t sec);
+    void WriteRtcTime();
+    // needs to acquire the lock `rtcMutex_` before calling this method
+    int GetRtcFdLocked();
     bool CheckRtc(const std::string &rtcPath, uint64_t rtcId);
     int GetWallClockRtcId();
     void RegisterRSSDeathCallback();
@@ -143,6 +166,12 @@ private:
     static std::mutex instanceLock_;
     static sptr<TimeSystemAbility> instance_;
     const int rtcId;
+    std::mutex rtcMutex_;
+    // kept open for the life of the service, -1 until the first access or after a failed write
+    int rtcFd_ = -1;
+    // latest time in ms queued for the RTC and the boot time in ms it was queued at
+    int64_t pendingRtcTime_ = 0;
+    int64_t pendingRtcBootTime_ = 0;
     sptr<RSSSaDeathRecipient> deathRecipient_ {};
 };
 } // namespace MiscServices
@@ -16,6 +16,8 @@
 #ifndef TIMER_BATCH_H
 #define TIMER_BATCH_H
 
+#include <vector>
+
 #include "timer_info.h"
 namespace OHOS {
 namespace MiscServices {
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_LINEAR_HISTOGRAM_H
+#define LOG_LINEAR_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * Histogram of non-negative values, recorded without locks.
+ *
+ * Values below SUB_BUCKETS have a bucket of their own, every power of two above is split into SUB_BUCKETS
+ * linear buckets, so a bucket is at most 1/SUB_BUCKETS of its values wide. Values of 2^MAX_BITS and more
+ * share the last bucket. A snapshot taken while values are recorded may miss some of them.
+ */
+class LogLinearHistogram {
+public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 2;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr uint32_t MAX_BITS = 36;
+    static constexpr size_t BUCKET_COUNT = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKET_COUNT> counts {};
+        uint64_t count = 0;
+
+        // Returns the upper bound of the bucket holding the `p` quantile, 0 if the snapshot is empty.
+        uint64_t GetPercentile(double p) const;
+        // Returns the upper bound of the highest bucket in use.
+        uint64_t GetMax() const;
+        // Returns the values recorded since `earlier` was taken.
+        Snapshot Since(const Snapshot &earlier) const;
+    };
+
+    void Record(uint64_t value);
+    Snapshot GetSnapshot() const;
+    static size_t GetBucket(uint64_t value);
+    static uint64_t GetUpperBound(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_ {};
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // LOG_LINEAR_HISTOGRAM_H
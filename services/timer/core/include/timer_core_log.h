@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMER_CORE_LOG_H
+#define TIMER_CORE_LOG_H
+
+// The scheduling core logs through hilog on the device, a host build defines TIMER_CORE_HOST and drops the logs.
+#ifdef TIMER_CORE_HOST
+#define TIME_HILOGE(module, fmt, ...)
+#define TIME_HILOGW(module, fmt, ...)
+#define TIME_HILOGI(module, fmt, ...)
+#define TIME_HILOGD(module, fmt, ...)
+#else
+#include "time_hilog.h"
+#endif
+
+#endif // TIMER_CORE_LOG_H
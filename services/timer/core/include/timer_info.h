@@ -16,9 +16,20 @@
 #ifndef TIMER_INFO_H
 #define TIMER_INFO_H
 
-#include "timer_manager_interface.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "timer_types.h"
 
 namespace OHOS {
+namespace AbilityRuntime {
+namespace WantAgent {
+class WantAgent;
+}
+}
+
 namespace MiscServices {
 
 class TimerInfo {
@@ -56,6 +67,11 @@ public:
     std::chrono::milliseconds offset;
     std::string bundleName;
     int state;
+    // adjust verdict cached by TimerProxy, only valid while adjustVersion matches the proxy's policy version;
+    // guarded by the proxy's adjust mutex
+    uint64_t adjustVersion = 0;
+    bool isAdjustExempt = false;
+    uint32_t adjustPolicy = 0;
 
     TimerInfo(std::string name, uint64_t id, int type,
         std::chrono::milliseconds when,
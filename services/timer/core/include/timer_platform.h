@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMER_PLATFORM_H
+#define TIMER_PLATFORM_H
+
+#include <atomic>
+#include <chrono>
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * The clocks the scheduling core reads.
+ *
+ * The default reads CLOCK_BOOTTIME and CLOCK_REALTIME, a host tool or a simulation may install its own.
+ */
+class TimerPlatform {
+public:
+    virtual ~TimerPlatform() = default;
+    // Boot time, which keeps counting while the device is suspended.
+    virtual std::chrono::steady_clock::time_point GetBootTime();
+    // Wall time since the epoch.
+    virtual std::chrono::nanoseconds GetWallTime();
+
+    static TimerPlatform &GetInstance();
+    // Installs `platform`, which must outlive its use, nullptr restores the default.
+    static void SetInstance(TimerPlatform *platform);
+
+private:
+    static std::atomic<TimerPlatform *> instance_;
+};
+} // MiscServices
+} // OHOS
+#endif // TIMER_PLATFORM_H
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMER_SCHEDULER_H
+#define TIMER_SCHEDULER_H
+
+#include <string>
+#include <unordered_set>
+
+#include "batch.h"
+
+namespace OHOS {
+namespace MiscServices {
+using BatchList = std::vector<std::shared_ptr<Batch>>;
+
+// How a timer finds its batch.
+enum class CoalescePolicy : uint8_t {
+    // the first batch whose window overlaps
+    FIRST_FIT,
+    // the batch with the tightest window left, batches with wakeups first
+    BEST_FIT,
+    // BEST_FIT, with the batches regrouped into the fewest wakeup batches from time to time
+    MIN_WAKEUP,
+};
+
+/**
+ * The scheduling decisions of TimerManager which depend on nothing but the timers themselves: batching and
+ * coalescing, repeat and idle deadline math and when the kernel timer needs to be programmed again.
+ *
+ * The batch list is kept ordered by batch start, the caller serializes access to it.
+ */
+class TimerScheduler {
+public:
+    // Inserts `batch` by its start, returns true if it became the first batch.
+    static bool AddBatch(BatchList &list, const std::shared_ptr<Batch> &batch);
+    // Returns the index of the first batch the window `whenElapsed`..`maxWhen` fits into, -1 if there is none.
+    static int64_t AttemptCoalesce(const BatchList &list, std::chrono::steady_clock::time_point whenElapsed,
+        std::chrono::steady_clock::time_point maxWhen);
+    // Returns the index of the batch `timer` fits into best as BEST_FIT places it, -1 if there is none.
+    static int64_t AttemptBestFit(const BatchList &list, const TimerInfo &timer);
+    // Adds `timer` to a batch, returns the index of the batch it joined or -1 if it got a batch of its own.
+    static int64_t InsertAndBatch(BatchList &list, const std::shared_ptr<TimerInfo> &timer,
+        CoalescePolicy policy = CoalescePolicy::FIRST_FIT);
+    // Regroups the timers of `list` into the fewest batches with wakeups, the timers without wakeups join them
+    // where they fit. STANDALONE timers keep a batch of their own.
+    static BatchList Coalesce(const BatchList &list);
+    static size_t CountWakeupBatches(const BatchList &list);
+    static const char *GetPolicyName(CoalescePolicy policy);
+    // Returns false if `name` is not the name of a policy.
+    static bool ParsePolicy(const std::string &name, CoalescePolicy &policy);
+    // Takes the timer `id` out of its batch, returns false if no batch holds it.
+    static bool Remove(BatchList &list, uint64_t id);
+    // Takes all `ids` out of the batches in one pass, the batches left non-empty are re-added in order.
+    static void RemoveAll(BatchList &list, const std::unordered_set<uint64_t> &ids);
+    // Takes the batches which started at or before `nowElapsed` out of the list.
+    static std::vector<std::shared_ptr<Batch>> TakeDueBatches(BatchList &list,
+        std::chrono::steady_clock::time_point nowElapsed);
+    static std::shared_ptr<Batch> FindFirstWakeupBatch(const BatchList &list);
+    // Returns the next occurrence of a repeating `timer` due at or before `nowElapsed`, nullptr if it does not repeat.
+    static std::shared_ptr<TimerInfo> NextRepeat(const TimerInfo &timer,
+        std::chrono::steady_clock::time_point nowElapsed);
+    // Holds `timer` back until `idleUntil` fires, returns true if its deadline changed.
+    static bool DeferToIdleUntil(TimerInfo &timer, const TimerInfo &idleUntil,
+        std::chrono::steady_clock::time_point now);
+    // Brings a timer held back by idle to its own deadline again, returns true if its deadline changed.
+    static bool RestoreFromIdle(TimerInfo &timer, std::chrono::steady_clock::time_point now);
+    // Returns true if the kernel timer last set to `lastSet` ns has to be set to `when`.
+    static bool NeedReprogram(std::chrono::nanoseconds when, std::chrono::steady_clock::time_point bootTime,
+        int64_t lastSet);
+    // An unset deadline, zero or below, fires right away.
+    static std::chrono::nanoseconds ClampDeadline(std::chrono::nanoseconds when,
+        std::chrono::steady_clock::time_point bootTime);
+};
+} // MiscServices
+} // OHOS
+#endif // TIMER_SCHEDULER_H
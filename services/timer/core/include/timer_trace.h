@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMER_TRACE_H
+#define TIMER_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+enum class TimerTraceEvent : uint8_t {
+    CREATE,
+    START,
+    STOP,
+    DESTROY,
+    PROXY,
+    ADJUST,
+    IDLE,
+    TIME_CHANGE,
+};
+
+/**
+ * One event of the timer workload.
+ *
+ * The meaning of `when`, `interval` and `flags` depends on the event:
+ *   CREATE       window, interval and timer flags of the timer
+ *   START        trigger time in ms as passed to StartTimer
+ *   PROXY        flags 1 to proxy, 0 to restore, when is the proxy delay in ms
+ *   ADJUST       flags 1 to adjust, 0 to restore, when is the interval and interval the delta in s
+ *   IDLE         flags 1 when the idle timer `id` is set, 0 when idle ends
+ *   TIME_CHANGE  when is the new wall time in ns
+ */
+struct TimerTraceRecord {
+    // boot time of the event in ns
+    int64_t bootTime = 0;
+    uint64_t id = 0;
+    int64_t when = 0;
+    int64_t window = 0;
+    uint64_t interval = 0;
+    uint32_t nameHash = 0;
+    int32_t uid = 0;
+    int32_t pid = 0;
+    TimerTraceEvent event = TimerTraceEvent::CREATE;
+    uint8_t type = 0;
+    uint8_t flags = 0;
+};
+
+/**
+ * Binary trace of the timer workload, little endian: a header of the magic "TMTR", the version, the record size
+ * and the boot and wall time in ns at the start, followed by fixed size records. Timer names are only kept as
+ * their FNV-1a hash.
+ */
+class TimerTrace {
+public:
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 24;
+    static constexpr size_t RECORD_SIZE = 56;
+
+    static uint32_t HashName(const std::string &name);
+};
+
+// Appends records to a trace file, safe to call from any thread.
+class TimerTraceWriter {
+public:
+    ~TimerTraceWriter();
+    // Truncates `path` and writes the header, at most `maxRecords` are taken afterwards.
+    bool Open(const std::string &path, int64_t bootTime, int64_t wallTime, uint64_t maxRecords);
+    // Returns false if the trace is not open or full, the trace is closed once full.
+    bool Write(const TimerTraceRecord &record);
+    // Flushes and closes the trace, returns the number of records written.
+    uint64_t Close();
+    bool IsOpen();
+
+private:
+    // needs to acquire the lock `mutex_` before calling this method
+    bool FlushLocked();
+    // needs to acquire the lock `mutex_` before calling this method
+    uint64_t CloseLocked();
+
+    std::mutex mutex_;
+    FILE *file_ = nullptr;
+    std::vector<uint8_t> buffer_;
+    uint64_t records_ = 0;
+    uint64_t maxRecords_ = 0;
+};
+
+// Reads a trace file written by TimerTraceWriter.
+class TimerTraceReader {
+public:
+    ~TimerTraceReader();
+    // Returns false if `path` cannot be read or is not a trace of a known version.
+    bool Open(const std::string &path);
+    // Returns false at the end of the trace.
+    bool Read(TimerTraceRecord &record);
+    int64_t GetStartBootTime() const;
+    int64_t GetStartWallTime() const;
+
+private:
+    FILE *file_ = nullptr;
+    int64_t startBootTime_ = 0;
+    int64_t startWallTime_ = 0;
+};
+} // MiscServices
+} // OHOS
+#endif // TIMER_TRACE_H
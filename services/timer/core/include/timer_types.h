@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMER_TYPES_H
+#define TIMER_TYPES_H
+
+#include <cstdint>
+
+namespace OHOS {
+namespace MiscServices {
+// Flags and types of a timer, shared by the scheduling core and ITimerManager.
+class TimerTypes {
+public:
+    enum TimerFlag : uint8_t {
+        STANDALONE = 1 << 0,
+        WAKE_FROM_IDLE = 1 << 1,
+        ALLOW_WHILE_IDLE = 1 << 2,
+        ALLOW_WHILE_IDLE_UNRESTRICTED = 1 << 3,
+        IDLE_UNTIL = 1 << 4,
+        INEXACT_REMINDER = 1 << 5,
+        IS_DISPOSABLE = 1 << 6,
+    };
+
+    enum TimerType : uint8_t {
+        RTC_WAKEUP = 0,
+        RTC = 1,
+        ELAPSED_REALTIME_WAKEUP = 2,
+        ELAPSED_REALTIME = 3,
+        #ifdef SET_AUTO_REBOOT_ENABLE
+        POWER_ON_ALARM = 6,
+        #endif
+        TIMER_TYPE_BUTT
+    };
+};
+} // MiscServices
+} // OHOS
+#endif // TIMER_TYPES_H
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VIRTUAL_TIMER_CLOCK_H
+#define VIRTUAL_TIMER_CLOCK_H
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+
+#include "timer_platform.h"
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * Virtual boot and wall clocks together with virtual kernel timers, for simulations of the timer service.
+ *
+ * Waiting for an alarm does not sleep, it moves the clocks to the earliest armed deadline right away, so days
+ * of timers run in seconds. The clocks never pass the horizon, which starts at the initial boot time and lets a
+ * driver step the simulation deterministically. A step of the wall clock is reported like a kernel
+ * TFD_TIMER_CANCEL_ON_SET.
+ */
+class VirtualTimerClock : public TimerPlatform {
+public:
+    // bit of WaitForAlarm reporting a step of the wall clock, the one of the kernel handler
+    static constexpr uint32_t TIME_CHANGED = 1 << 16;
+
+    VirtualTimerClock(std::chrono::steady_clock::time_point bootTime, std::chrono::nanoseconds wallTime);
+    std::chrono::steady_clock::time_point GetBootTime() override;
+    std::chrono::nanoseconds GetWallTime() override;
+
+    // Arms the virtual kernel timer of `type` at `when`, boot time for the elapsed types, wall time otherwise.
+    void Set(uint32_t type, std::chrono::nanoseconds when);
+    // Moves the clocks to the earliest deadline within the horizon and returns the mask of the timers due then,
+    // 0 once stopped.
+    uint32_t WaitForAlarm();
+    // Lets the clocks run up to `horizon` and returns once every timer due until then has been taken.
+    void RunUntil(std::chrono::steady_clock::time_point horizon);
+    // Lets the clocks run freely.
+    void RunFree();
+    // Steps the wall clock by `delta`, the boot clock is not affected.
+    void StepWallTime(std::chrono::nanoseconds delta);
+    // Wakes every waiter, WaitForAlarm returns 0 from now on.
+    void Stop();
+    uint64_t GetAlarmCount();
+    uint64_t GetSetCount();
+
+private:
+    static constexpr size_t TYPE_COUNT = 8;
+
+    // needs to acquire the lock `mutex_` before calling this method
+    bool FindDeadlineLocked(std::chrono::steady_clock::time_point &deadline);
+    // needs to acquire the lock `mutex_` before calling this method
+    std::chrono::steady_clock::time_point ToBootTimeLocked(uint32_t type, std::chrono::nanoseconds when);
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::chrono::steady_clock::time_point bootTime_;
+    // wall time minus boot time
+    std::chrono::nanoseconds wallOffset_;
+    std::chrono::steady_clock::time_point horizon_;
+    std::array<std::chrono::nanoseconds, TYPE_COUNT> deadlines_ {};
+    std::array<bool, TYPE_COUNT> armed_ {};
+    bool timeChanged_ = false;
+    bool waiting_ = false;
+    bool stopped_ = false;
+    uint64_t alarms_ = 0;
+    uint64_t sets_ = 0;
+};
+} // MiscServices
+} // OHOS
+#endif // VIRTUAL_TIMER_CLOCK_H
@@ -15,6 +15,8 @@
 
 #include "batch.h"
 
+#include <algorithm>
+
 namespace OHOS {
 namespace MiscServices {
 constexpr auto TYPE_NONWAKEUP_MASK = 0x1;
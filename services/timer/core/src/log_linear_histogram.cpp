@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_linear_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace OHOS {
+namespace MiscServices {
+void LogLinearHistogram::Record(uint64_t value)
+{
+    counts_[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+LogLinearHistogram::Snapshot LogLinearHistogram::GetSnapshot() const
+{
+    Snapshot snapshot;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+    return snapshot;
+}
+
+size_t LogLinearHistogram::GetBucket(uint64_t value)
+{
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    uint32_t bits = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+    if (bits >= MAX_BITS) {
+        return BUCKET_COUNT - 1;
+    }
+    uint32_t shift = bits - SUB_BUCKET_BITS;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1)));
+}
+
+uint64_t LogLinearHistogram::GetUpperBound(size_t bucket)
+{
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    uint64_t shift = bucket / SUB_BUCKETS - 1;
+    uint64_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+uint64_t LogLinearHistogram::Snapshot::GetPercentile(double p) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(p * static_cast<double>(count))), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return GetUpperBound(i);
+        }
+    }
+    return GetMax();
+}
+
+uint64_t LogLinearHistogram::Snapshot::GetMax() const
+{
+    for (size_t i = BUCKET_COUNT; i > 0; i--) {
+        if (counts[i - 1] != 0) {
+            return GetUpperBound(i - 1);
+        }
+    }
+    return 0;
+}
+
+LogLinearHistogram::Snapshot LogLinearHistogram::Snapshot::Since(const Snapshot &earlier) const
+{
+    Snapshot delta;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        // the counters only grow, a smaller one belongs to a later snapshot than this
+        delta.counts[i] = (counts[i] > earlier.counts[i]) ? counts[i] - earlier.counts[i] : 0;
+        delta.count += delta.counts[i];
+    }
+    return delta;
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -16,8 +16,13 @@
 #include "timer_info.h"
 
 #include <cinttypes>
+#include <cmath>
+#include <limits>
 #include <memory>
 
+#include "timer_core_log.h"
+#include "timer_platform.h"
+
 namespace OHOS {
 namespace MiscServices {
 using namespace std::chrono;
@@ -57,7 +62,7 @@ TimerInfo::TimerInfo(std::string _name, uint64_t _id, int _type,
       id {_id},
       type {_type},
       origWhen {_when},
-      wakeup {_type == ITimerManager::ELAPSED_REALTIME_WAKEUP || _type == ITimerManager::RTC_WAKEUP},
+      wakeup {_type == TimerTypes::ELAPSED_REALTIME_WAKEUP || _type == TimerTypes::RTC_WAKEUP},
       autoRestore {_autoRestore},
       callback {std::move(_callback)},
       wantAgent {_wantAgent},
@@ -118,7 +123,7 @@ std::shared_ptr<TimerInfo> TimerInfo::CreateTimerInfo(std::string _name, uint64_
 
 void TimerInfo::CalculateOriWhenElapsed()
 {
-    auto nowElapsed = TimeUtils::GetBootTimeNs();
+    auto nowElapsed = TimerPlatform::GetInstance().GetBootTime();
     auto elapsed = ConvertToElapsed(origWhen, type);
     steady_clock::time_point maxElapsed;
     if (windowLength == milliseconds::zero()) {
@@ -156,9 +161,9 @@ bool TimerInfo::UpdateWhenElapsedFromNow(std::chrono::steady_clock::time_point n
     auto oldMaxWhenElapsed = maxWhenElapsed;
     maxWhenElapsed = whenElapsed + windowLength;
     std::chrono::milliseconds currentTime;
-    if (type == ITimerManager::RTC || type == ITimerManager::RTC_WAKEUP) {
+    if (type == TimerTypes::RTC || type == TimerTypes::RTC_WAKEUP) {
         currentTime =
-            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+            std::chrono::duration_cast<std::chrono::milliseconds>(TimerPlatform::GetInstance().GetWallTime());
     } else {
         currentTime = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
     }
@@ -237,10 +242,11 @@ bool TimerInfo::AdjustTimer(const std::chrono::steady_clock::time_point &now,
         auto maxTimeSec = ((oldMaxTimeSec + auxiliaryCalcuSec) / intervalSec) * intervalSec + deltaSec;
         maxWhenElapsed = std::chrono::steady_clock::time_point(maxTimeSec);
     }
-    if (whenElapsed < now) {
+    // an aligned time which is not ahead of now would fire right away, on a virtual clock over and over
+    if (whenElapsed <= now) {
         whenElapsed += std::chrono::duration_cast<std::chrono::milliseconds>(intervalSec);
     }
-    if (maxWhenElapsed < now) {
+    if (maxWhenElapsed <= now) {
         maxWhenElapsed += std::chrono::duration_cast<std::chrono::milliseconds>(intervalSec);
     }
     auto elapsedDelta = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -303,9 +309,9 @@ bool TimerInfo::RestoreTimer()
 
 std::chrono::steady_clock::time_point TimerInfo::ConvertToElapsed(std::chrono::milliseconds when, int type)
 {
-    if (type == ITimerManager::RTC || type == ITimerManager::RTC_WAKEUP) {
-        auto systemTimeNow = system_clock::now().time_since_epoch();
-        auto bootTimePoint = TimeUtils::GetBootTimeNs();
+    if (type == TimerTypes::RTC || type == TimerTypes::RTC_WAKEUP) {
+        auto systemTimeNow = TimerPlatform::GetInstance().GetWallTime();
+        auto bootTimePoint = TimerPlatform::GetInstance().GetBootTime();
         auto offset = when - systemTimeNow;
         TIME_HILOGD(TIME_MODULE_SERVICE, "systemTimeNow : %{public}lld offset : %{public}lld",
                     systemTimeNow.count(), offset.count());
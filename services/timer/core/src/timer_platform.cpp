@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "timer_platform.h"
+
+#include <ctime>
+
+namespace OHOS {
+namespace MiscServices {
+std::atomic<TimerPlatform *> TimerPlatform::instance_ {nullptr};
+
+std::chrono::steady_clock::time_point TimerPlatform::GetBootTime()
+{
+    struct timespec tv {};
+    if (clock_gettime(CLOCK_BOOTTIME, &tv) != 0) {
+        return std::chrono::steady_clock::now();
+    }
+    auto bootTime = std::chrono::seconds(tv.tv_sec) + std::chrono::nanoseconds(tv.tv_nsec);
+    return std::chrono::steady_clock::time_point(bootTime);
+}
+
+std::chrono::nanoseconds TimerPlatform::GetWallTime()
+{
+    return std::chrono::system_clock::now().time_since_epoch();
+}
+
+TimerPlatform &TimerPlatform::GetInstance()
+{
+    static TimerPlatform defaultPlatform;
+    TimerPlatform *platform = instance_.load(std::memory_order_acquire);
+    return (platform == nullptr) ? defaultPlatform : *platform;
+}
+
+void TimerPlatform::SetInstance(TimerPlatform *platform)
+{
+    instance_.store(platform, std::memory_order_release);
+}
+} // MiscServices
+} // OHOS
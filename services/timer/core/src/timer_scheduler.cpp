@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "timer_scheduler.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "timer_core_log.h"
+#include "timer_platform.h"
+
+namespace OHOS {
+namespace MiscServices {
+using namespace std::chrono;
+namespace {
+// the time of performing the task of a timer which was held back past its own deadline
+constexpr milliseconds RESTORE_DELAY(2);
+constexpr const char* POLICY_NAMES[] = { "first_fit", "best_fit", "min_wakeup" };
+
+bool IsStandalone(const TimerInfo &timer)
+{
+    return (timer.flags & static_cast<uint32_t>(TimerTypes::STANDALONE)) != 0;
+}
+
+// Groups `timers` into the fewest batches: in the order of their deadlines, a batch is closed at the deadline of
+// its first timer and takes every later timer which is due by then.
+void GroupByDeadline(std::vector<std::shared_ptr<TimerInfo>> &timers, BatchList &list)
+{
+    std::sort(timers.begin(), timers.end(),
+        [](const std::shared_ptr<TimerInfo> &l, const std::shared_ptr<TimerInfo> &r) {
+            return (l->maxWhenElapsed != r->maxWhenElapsed) ? l->maxWhenElapsed < r->maxWhenElapsed :
+                l->whenElapsed < r->whenElapsed;
+        });
+    std::shared_ptr<Batch> batch;
+    for (const auto &timer : timers) {
+        if (batch == nullptr || !batch->CanHold(timer->whenElapsed, timer->maxWhenElapsed)) {
+            if (batch != nullptr) {
+                TimerScheduler::AddBatch(list, batch);
+            }
+            batch = std::make_shared<Batch>();
+        }
+        batch->Add(timer);
+    }
+    if (batch != nullptr) {
+        TimerScheduler::AddBatch(list, batch);
+    }
+}
+}
+
+bool TimerScheduler::AddBatch(BatchList &list, const std::shared_ptr<Batch> &batch)
+{
+    auto it = std::upper_bound(list.begin(),
+                               list.end(),
+                               batch,
+                               [](const std::shared_ptr<Batch> &first, const std::shared_ptr<Batch> &second) {
+                                   return first->GetStart() < second->GetStart();
+                               });
+    return list.insert(it, batch) == list.begin();
+}
+
+int64_t TimerScheduler::AttemptCoalesce(const BatchList &list, steady_clock::time_point whenElapsed,
+    steady_clock::time_point maxWhen)
+{
+    auto it = std::find_if(list.begin(), list.end(),
+        [whenElapsed, maxWhen](const std::shared_ptr<Batch> &batch) {
+            return (batch->GetFlags() & static_cast<uint32_t>(TimerTypes::STANDALONE)) == 0 &&
+                   (batch->CanHold(whenElapsed, maxWhen));
+        });
+    if (it != list.end()) {
+        return std::distance(list.begin(), it);
+    }
+    return -1;
+}
+
+int64_t TimerScheduler::AttemptBestFit(const BatchList &list, const TimerInfo &timer)
+{
+    int64_t best = -1;
+    bool bestHasWakeups = false;
+    steady_clock::duration bestWindow {};
+    for (size_t i = 0; i < list.size(); i++) {
+        const auto &batch = list[i];
+        // the list is ordered by start, no later batch can hold the timer either
+        if (batch->GetStart() > timer.maxWhenElapsed) {
+            break;
+        }
+        if ((batch->GetFlags() & static_cast<uint32_t>(TimerTypes::STANDALONE)) != 0 ||
+            !batch->CanHold(timer.whenElapsed, timer.maxWhenElapsed)) {
+            continue;
+        }
+        // a batch which wakes the device anyway costs no extra wakeup, the tightest window left keeps the looser
+        // batches open for later timers
+        bool hasWakeups = batch->HasWakeups();
+        auto window = std::min(batch->GetEnd(), timer.maxWhenElapsed) -
+            std::max(batch->GetStart(), timer.whenElapsed);
+        if (best < 0 || (hasWakeups && !bestHasWakeups) || (hasWakeups == bestHasWakeups && window < bestWindow)) {
+            best = static_cast<int64_t>(i);
+            bestHasWakeups = hasWakeups;
+            bestWindow = window;
+        }
+    }
+    return best;
+}
+
+int64_t TimerScheduler::InsertAndBatch(BatchList &list, const std::shared_ptr<TimerInfo> &timer,
+    CoalescePolicy policy)
+{
+    int64_t whichBatch = -1;
+    if (!IsStandalone(*timer)) {
+        whichBatch = (policy == CoalescePolicy::FIRST_FIT) ?
+            AttemptCoalesce(list, timer->whenElapsed, timer->maxWhenElapsed) :
+            AttemptBestFit(list, *timer);
+    }
+    if (whichBatch < 0) {
+        AddBatch(list, std::make_shared<Batch>(*timer));
+    } else {
+        auto batch = list.at(whichBatch);
+        if (batch->Add(timer)) {
+            list.erase(list.begin() + whichBatch);
+            AddBatch(list, batch);
+        }
+    }
+    return whichBatch;
+}
+
+bool TimerScheduler::Remove(BatchList &list, uint64_t id)
+{
+    auto whichAlarms = [id](const TimerInfo &timer) {
+        return timer.id == id;
+    };
+    for (auto it = list.begin(); it != list.end(); ++it) {
+        auto batch = *it;
+        if (!batch->Remove(whichAlarms)) {
+            continue;
+        }
+        list.erase(it);
+        if (batch->Size() != 0) {
+            AddBatch(list, batch);
+        }
+        return true;
+    }
+    return false;
+}
+
+void TimerScheduler::RemoveAll(BatchList &list, const std::unordered_set<uint64_t> &ids)
+{
+    auto whichAlarms = [&ids](const TimerInfo &timer) {
+        return ids.find(timer.id) != ids.end();
+    };
+    std::vector<std::shared_ptr<Batch>> touchedBatches;
+    for (auto it = list.begin(); it != list.end();) {
+        auto batch = *it;
+        if (!batch->Remove(whichAlarms)) {
+            ++it;
+            continue;
+        }
+        it = list.erase(it);
+        if (batch->Size() != 0) {
+            touchedBatches.push_back(batch);
+        }
+    }
+    for (const auto &batch : touchedBatches) {
+        AddBatch(list, batch);
+    }
+}
+
+std::vector<std::shared_ptr<Batch>> TimerScheduler::TakeDueBatches(BatchList &list,
+    steady_clock::time_point nowElapsed)
+{
+    std::vector<std::shared_ptr<Batch>> dueBatches;
+    for (auto it = list.begin(); it != list.end();) {
+        if (*it == nullptr) {
+            TIME_HILOGE(TIME_MODULE_SERVICE, "batch list has nullptr");
+            it = list.erase(it);
+            continue;
+        }
+        if ((*it)->GetStart() > nowElapsed) {
+            ++it;
+            continue;
+        }
+        dueBatches.push_back(*it);
+        it = list.erase(it);
+    }
+    return dueBatches;
+}
+
+BatchList TimerScheduler::Coalesce(const BatchList &list)
+{
+    BatchList coalesced;
+    std::vector<std::shared_ptr<TimerInfo>> wakeups;
+    std::vector<std::shared_ptr<TimerInfo>> others;
+    for (const auto &batch : list) {
+        for (size_t i = 0; i < batch->Size(); i++) {
+            auto timer = batch->Get(i);
+            if (IsStandalone(*timer)) {
+                auto own = std::make_shared<Batch>();
+                own->Add(timer);
+                AddBatch(coalesced, own);
+            } else if (timer->wakeup) {
+                wakeups.push_back(timer);
+            } else {
+                others.push_back(timer);
+            }
+        }
+    }
+    GroupByDeadline(wakeups, coalesced);
+    std::vector<std::shared_ptr<TimerInfo>> leftovers;
+    for (const auto &timer : others) {
+        int64_t whichBatch = AttemptBestFit(coalesced, *timer);
+        if (whichBatch < 0) {
+            leftovers.push_back(timer);
+            continue;
+        }
+        auto batch = coalesced.at(whichBatch);
+        if (batch->Add(timer)) {
+            coalesced.erase(coalesced.begin() + whichBatch);
+            AddBatch(coalesced, batch);
+        }
+    }
+    GroupByDeadline(leftovers, coalesced);
+    return coalesced;
+}
+
+size_t TimerScheduler::CountWakeupBatches(const BatchList &list)
+{
+    return static_cast<size_t>(std::count_if(list.begin(), list.end(),
+        [](const std::shared_ptr<Batch> &batch) { return batch->HasWakeups(); }));
+}
+
+const char *TimerScheduler::GetPolicyName(CoalescePolicy policy)
+{
+    auto index = static_cast<size_t>(policy);
+    return (index < std::size(POLICY_NAMES)) ? POLICY_NAMES[index] : "unknown";
+}
+
+bool TimerScheduler::ParsePolicy(const std::string &name, CoalescePolicy &policy)
+{
+    for (size_t i = 0; i < std::size(POLICY_NAMES); i++) {
+        if (name == POLICY_NAMES[i]) {
+            policy = static_cast<CoalescePolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<Batch> TimerScheduler::FindFirstWakeupBatch(const BatchList &list)
+{
+    auto it = std::find_if(list.begin(), list.end(),
+        [](const std::shared_ptr<Batch> &batch) {
+            return batch->HasWakeups();
+        });
+    return (it != list.end()) ? *it : nullptr;
+}
+
+std::shared_ptr<TimerInfo> TimerScheduler::NextRepeat(const TimerInfo &timer, steady_clock::time_point nowElapsed)
+{
+    if (timer.repeatInterval <= milliseconds::zero()) {
+        return nullptr;
+    }
+    uint64_t count = 1 + static_cast<uint64_t>(
+        duration_cast<milliseconds>(nowElapsed - timer.whenElapsed) / timer.repeatInterval);
+    auto delta = count * timer.repeatInterval;
+    steady_clock::time_point nextElapsed = timer.whenElapsed + delta;
+    steady_clock::time_point nextMaxElapsed = (timer.windowLength == milliseconds::zero()) ?
+                                              nextElapsed :
+                                              TimerInfo::MaxTriggerTime(nowElapsed, nextElapsed,
+                                                                        timer.repeatInterval);
+    return std::make_shared<TimerInfo>(timer.name, timer.id, timer.type, timer.when + delta,
+        timer.whenElapsed + delta, timer.windowLength, nextMaxElapsed, timer.repeatInterval, timer.callback,
+        timer.wantAgent, timer.flags, timer.autoRestore, timer.uid, timer.pid, timer.bundleName);
+}
+
+bool TimerScheduler::DeferToIdleUntil(TimerInfo &timer, const TimerInfo &idleUntil, steady_clock::time_point now)
+{
+    auto offset = TimerInfo::ConvertToElapsed(idleUntil.when, idleUntil.type) - now;
+    return timer.UpdateWhenElapsedFromNow(now, offset);
+}
+
+bool TimerScheduler::RestoreFromIdle(TimerInfo &timer, steady_clock::time_point now)
+{
+    milliseconds currentTime;
+    if (timer.type == TimerTypes::RTC || timer.type == TimerTypes::RTC_WAKEUP) {
+        currentTime = duration_cast<milliseconds>(TimerPlatform::GetInstance().GetWallTime());
+    } else {
+        currentTime = duration_cast<milliseconds>(now.time_since_epoch());
+    }
+    if (timer.origWhen > currentTime) {
+        return timer.UpdateWhenElapsedFromNow(now, timer.origWhen - currentTime);
+    }
+    return timer.UpdateWhenElapsedFromNow(now, RESTORE_DELAY);
+}
+
+bool TimerScheduler::NeedReprogram(nanoseconds when, steady_clock::time_point bootTime, int64_t lastSet)
+{
+    // a deadline already due is set again, the kernel timer may have been consumed by the last expiry, which
+    // on a virtual clock happens at exactly the same time
+    return when <= bootTime.time_since_epoch() || when.count() != lastSet;
+}
+
+nanoseconds TimerScheduler::ClampDeadline(nanoseconds when, steady_clock::time_point bootTime)
+{
+    return (when.count() <= 0) ? bootTime.time_since_epoch() : when;
+}
+} // MiscServices
+} // OHOS
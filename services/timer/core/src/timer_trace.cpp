@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "timer_trace.h"
+
+#include <cinttypes>
+
+#include "timer_core_log.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr uint8_t MAGIC[] = { 'T', 'M', 'T', 'R' };
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+constexpr uint32_t FNV_PRIME = 16777619u;
+// records are handed to the file in chunks of this many
+constexpr size_t FLUSH_RECORDS = 64;
+constexpr size_t BYTE_BITS = 8;
+
+template<typename T>
+void Put(uint8_t *&pos, T value)
+{
+    auto bits = static_cast<uint64_t>(value);
+    for (size_t i = 0; i < sizeof(T); i++) {
+        *pos++ = static_cast<uint8_t>(bits >> (i * BYTE_BITS));
+    }
+}
+
+template<typename T>
+T Get(const uint8_t *&pos)
+{
+    uint64_t bits = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        bits |= static_cast<uint64_t>(*pos++) << (i * BYTE_BITS);
+    }
+    return static_cast<T>(bits);
+}
+}
+
+uint32_t TimerTrace::HashName(const std::string &name)
+{
+    uint32_t hash = FNV_OFFSET;
+    for (unsigned char c : name) {
+        hash = (hash ^ c) * FNV_PRIME;
+    }
+    return hash;
+}
+
+TimerTraceWriter::~TimerTraceWriter()
+{
+    Close();
+}
+
+bool TimerTraceWriter::Open(const std::string &path, int64_t bootTime, int64_t wallTime, uint64_t maxRecords)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    CloseLocked();
+    file_ = fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "open trace failed:%{public}s", path.c_str());
+        return false;
+    }
+    uint8_t header[TimerTrace::HEADER_SIZE] = {};
+    uint8_t *pos = header;
+    for (auto byte : MAGIC) {
+        *pos++ = byte;
+    }
+    Put<uint16_t>(pos, TimerTrace::VERSION);
+    Put<uint16_t>(pos, static_cast<uint16_t>(TimerTrace::RECORD_SIZE));
+    Put<int64_t>(pos, bootTime);
+    Put<int64_t>(pos, wallTime);
+    if (fwrite(header, sizeof(header), 1, file_) != 1) {
+        CloseLocked();
+        return false;
+    }
+    buffer_.clear();
+    buffer_.reserve(FLUSH_RECORDS * TimerTrace::RECORD_SIZE);
+    records_ = 0;
+    maxRecords_ = maxRecords;
+    return true;
+}
+
+bool TimerTraceWriter::Write(const TimerTraceRecord &record)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == nullptr) {
+        return false;
+    }
+    if (records_ >= maxRecords_) {
+        TIME_HILOGW(TIME_MODULE_SERVICE, "trace full, records:%{public}" PRIu64 "", records_);
+        CloseLocked();
+        return false;
+    }
+    auto offset = buffer_.size();
+    buffer_.resize(offset + TimerTrace::RECORD_SIZE);
+    uint8_t *pos = buffer_.data() + offset;
+    Put<int64_t>(pos, record.bootTime);
+    Put<uint64_t>(pos, record.id);
+    Put<int64_t>(pos, record.when);
+    Put<int64_t>(pos, record.window);
+    Put<uint64_t>(pos, record.interval);
+    Put<uint32_t>(pos, record.nameHash);
+    Put<int32_t>(pos, record.uid);
+    Put<int32_t>(pos, record.pid);
+    Put<uint8_t>(pos, static_cast<uint8_t>(record.event));
+    Put<uint8_t>(pos, record.type);
+    Put<uint8_t>(pos, record.flags);
+    records_++;
+    if (buffer_.size() >= FLUSH_RECORDS * TimerTrace::RECORD_SIZE && !FlushLocked()) {
+        CloseLocked();
+        return false;
+    }
+    return true;
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+bool TimerTraceWriter::FlushLocked()
+{
+    if (buffer_.empty()) {
+        return true;
+    }
+    bool ret = fwrite(buffer_.data(), buffer_.size(), 1, file_) == 1;
+    buffer_.clear();
+    if (!ret) {
+        TIME_HILOGE(TIME_MODULE_SERVICE, "write trace failed");
+    }
+    return ret;
+}
+
+uint64_t TimerTraceWriter::Close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return CloseLocked();
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+uint64_t TimerTraceWriter::CloseLocked()
+{
+    if (file_ == nullptr) {
+        return records_;
+    }
+    FlushLocked();
+    fclose(file_);
+    file_ = nullptr;
+    return records_;
+}
+
+bool TimerTraceWriter::IsOpen()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ != nullptr;
+}
+
+TimerTraceReader::~TimerTraceReader()
+{
+    if (file_ != nullptr) {
+        fclose(file_);
+    }
+}
+
+bool TimerTraceReader::Open(const std::string &path)
+{
+    if (file_ != nullptr) {
+        fclose(file_);
+    }
+    file_ = fopen(path.c_str(), "rb");
+    if (file_ == nullptr) {
+        return false;
+    }
+    uint8_t header[TimerTrace::HEADER_SIZE] = {};
+    if (fread(header, sizeof(header), 1, file_) != 1) {
+        return false;
+    }
+    const uint8_t *pos = header;
+    for (auto byte : MAGIC) {
+        if (*pos++ != byte) {
+            return false;
+        }
+    }
+    auto version = Get<uint16_t>(pos);
+    auto recordSize = Get<uint16_t>(pos);
+    if (version != TimerTrace::VERSION || recordSize != TimerTrace::RECORD_SIZE) {
+        return false;
+    }
+    startBootTime_ = Get<int64_t>(pos);
+    startWallTime_ = Get<int64_t>(pos);
+    return true;
+}
+
+bool TimerTraceReader::Read(TimerTraceRecord &record)
+{
+    uint8_t data[TimerTrace::RECORD_SIZE] = {};
+    if (file_ == nullptr || fread(data, sizeof(data), 1, file_) != 1) {
+        return false;
+    }
+    const uint8_t *pos = data;
+    record.bootTime = Get<int64_t>(pos);
+    record.id = Get<uint64_t>(pos);
+    record.when = Get<int64_t>(pos);
+    record.window = Get<int64_t>(pos);
+    record.interval = Get<uint64_t>(pos);
+    record.nameHash = Get<uint32_t>(pos);
+    record.uid = Get<int32_t>(pos);
+    record.pid = Get<int32_t>(pos);
+    record.event = static_cast<TimerTraceEvent>(Get<uint8_t>(pos));
+    record.type = Get<uint8_t>(pos);
+    record.flags = Get<uint8_t>(pos);
+    return true;
+}
+
+int64_t TimerTraceReader::GetStartBootTime() const
+{
+    return startBootTime_;
+}
+
+int64_t TimerTraceReader::GetStartWallTime() const
+{
+    return startWallTime_;
+}
+} // MiscServices
+} // OHOS
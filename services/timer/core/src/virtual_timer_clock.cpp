@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "virtual_timer_clock.h"
+
+#include "timer_types.h"
+
+namespace OHOS {
+namespace MiscServices {
+using namespace std::chrono;
+
+VirtualTimerClock::VirtualTimerClock(steady_clock::time_point bootTime, nanoseconds wallTime)
+    : bootTime_ {bootTime},
+      wallOffset_ {wallTime - bootTime.time_since_epoch()},
+      horizon_ {bootTime}
+{
+}
+
+steady_clock::time_point VirtualTimerClock::GetBootTime()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bootTime_;
+}
+
+nanoseconds VirtualTimerClock::GetWallTime()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bootTime_.time_since_epoch() + wallOffset_;
+}
+
+void VirtualTimerClock::Set(uint32_t type, nanoseconds when)
+{
+    if (type >= TYPE_COUNT) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    deadlines_[type] = when;
+    #ifdef SET_AUTO_REBOOT_ENABLE
+    // the device is never off in a simulation
+    armed_[type] = type != TimerTypes::POWER_ON_ALARM;
+    #else
+    armed_[type] = true;
+    #endif
+    sets_++;
+    cond_.notify_all();
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+steady_clock::time_point VirtualTimerClock::ToBootTimeLocked(uint32_t type, nanoseconds when)
+{
+    if (type == TimerTypes::RTC || type == TimerTypes::RTC_WAKEUP) {
+        return steady_clock::time_point(when - wallOffset_);
+    }
+    return steady_clock::time_point(when);
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+bool VirtualTimerClock::FindDeadlineLocked(steady_clock::time_point &deadline)
+{
+    bool found = false;
+    for (uint32_t type = 0; type < TYPE_COUNT; type++) {
+        if (!armed_[type]) {
+            continue;
+        }
+        auto typeDeadline = ToBootTimeLocked(type, deadlines_[type]);
+        if (!found || typeDeadline < deadline) {
+            deadline = typeDeadline;
+            found = true;
+        }
+    }
+    return found && deadline <= horizon_;
+}
+
+uint32_t VirtualTimerClock::WaitForAlarm()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        if (stopped_) {
+            return 0;
+        }
+        if (timeChanged_) {
+            timeChanged_ = false;
+            return TIME_CHANGED;
+        }
+        steady_clock::time_point deadline;
+        if (!FindDeadlineLocked(deadline)) {
+            waiting_ = true;
+            cond_.notify_all();
+            cond_.wait(lock);
+            waiting_ = false;
+            continue;
+        }
+        if (deadline > bootTime_) {
+            bootTime_ = deadline;
+        }
+        uint32_t result = 0;
+        for (uint32_t type = 0; type < TYPE_COUNT; type++) {
+            if (armed_[type] && ToBootTimeLocked(type, deadlines_[type]) <= bootTime_) {
+                armed_[type] = false;
+                result |= (1 << type);
+            }
+        }
+        alarms_++;
+        return result;
+    }
+}
+
+void VirtualTimerClock::RunUntil(steady_clock::time_point horizon)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    horizon_ = horizon;
+    cond_.notify_all();
+    steady_clock::time_point deadline;
+    // the looper is done with the horizon once it waits and has nothing left to take
+    cond_.wait(lock, [this, &deadline] {
+        return stopped_ || (waiting_ && !timeChanged_ && !FindDeadlineLocked(deadline));
+    });
+    if (horizon > bootTime_) {
+        bootTime_ = horizon;
+    }
+}
+
+void VirtualTimerClock::RunFree()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    horizon_ = steady_clock::time_point::max();
+    cond_.notify_all();
+}
+
+void VirtualTimerClock::StepWallTime(nanoseconds delta)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    wallOffset_ += delta;
+    timeChanged_ = true;
+    cond_.notify_all();
+}
+
+void VirtualTimerClock::Stop()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    cond_.notify_all();
+}
+
+uint64_t VirtualTimerClock::GetAlarmCount()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return alarms_;
+}
+
+uint64_t VirtualTimerClock::GetSetCount()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sets_;
+}
+} // MiscServices
+} // OHOS
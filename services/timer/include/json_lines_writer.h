@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef JSON_LINES_WRITER_H
+#define JSON_LINES_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * Writes one flat JSON object per line to a dump fd.
+ *
+ * Every object starts with its "kind". The lines are buffered and written in chunks of about FLUSH_SIZE, the
+ * rest when the writer is destroyed. Integers are written exactly, 64 bit ids included.
+ */
+class JsonLinesWriter {
+public:
+    explicit JsonLinesWriter(int fd);
+    ~JsonLinesWriter();
+    JsonLinesWriter &Begin(const char *kind);
+    JsonLinesWriter &AddInt(const char *key, int64_t value);
+    JsonLinesWriter &AddUint(const char *key, uint64_t value);
+    JsonLinesWriter &AddBool(const char *key, bool value);
+    JsonLinesWriter &AddString(const char *key, const std::string &value);
+    JsonLinesWriter &AddUintArray(const char *key, const std::vector<uint64_t> &values);
+    void End();
+
+private:
+    static constexpr size_t FLUSH_SIZE = 64 * 1024;
+
+    void AddKey(const char *key);
+    void Flush();
+
+    int fd_;
+    std::string buffer_;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // JSON_LINES_WRITER_H
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROFILED_MUTEX_H
+#define PROFILED_MUTEX_H
+
+#include <mutex>
+
+#ifdef LOCK_PROFILE_ENABLE
+#include <atomic>
+#include <chrono>
+
+#include "log_linear_histogram.h"
+#endif
+
+namespace OHOS {
+namespace MiscServices {
+#ifdef LOCK_PROFILE_ENABLE
+/**
+ * std::mutex which measures how long its callers wait for it and how long they hold it.
+ *
+ * The call site of every lock is taken from ProfiledLockGuard, the longest wait and the longest hold are kept
+ * together with theirs. The statistics are only written by the holder and read without the lock by
+ * ShowLockInfo, so a dump never waits for a busy lock.
+ */
+class ProfiledMutex {
+public:
+    explicit ProfiledMutex(const char *name);
+    ~ProfiledMutex();
+    ProfiledMutex(const ProfiledMutex &) = delete;
+    ProfiledMutex &operator=(const ProfiledMutex &) = delete;
+    void lock(const char *function = __builtin_FUNCTION(), uint32_t line = __builtin_LINE());
+    void unlock();
+    // Dumps every profiled mutex, the most waited for first.
+    static void ShowLockInfo(int fd);
+
+private:
+    struct Site {
+        std::atomic<const char *> function {""};
+        std::atomic<uint32_t> line {0};
+    };
+
+    void ShowInfo(int fd) const;
+
+    std::mutex mutex_;
+    const char *name_;
+    // the current holder, guarded by `mutex_`
+    std::chrono::steady_clock::time_point lockedAt_;
+    const char *holderFunction_ = "";
+    uint32_t holderLine_ = 0;
+    std::atomic<uint64_t> acquisitions_ {0};
+    std::atomic<uint64_t> contentions_ {0};
+    // in ns
+    std::atomic<uint64_t> waitTotal_ {0};
+    std::atomic<uint64_t> holdTotal_ {0};
+    std::atomic<uint64_t> maxWait_ {0};
+    std::atomic<uint64_t> maxHold_ {0};
+    Site maxWaitSite_;
+    Site maxHoldSite_;
+    LogLinearHistogram waits_;
+    LogLinearHistogram holds_;
+};
+
+class ProfiledLockGuard {
+public:
+    explicit ProfiledLockGuard(ProfiledMutex &mutex, const char *function = __builtin_FUNCTION(),
+        uint32_t line = __builtin_LINE()) : mutex_(mutex)
+    {
+        mutex_.lock(function, line);
+    }
+
+    ~ProfiledLockGuard()
+    {
+        mutex_.unlock();
+    }
+
+    ProfiledLockGuard(const ProfiledLockGuard &) = delete;
+    ProfiledLockGuard &operator=(const ProfiledLockGuard &) = delete;
+
+private:
+    ProfiledMutex &mutex_;
+};
+
+using TimerMutex = ProfiledMutex;
+using TimerLockGuard = ProfiledLockGuard;
+#else
+// Without the profiler the name is dropped and the mutex is a plain std::mutex.
+class TimerMutex : public std::mutex {
+public:
+    explicit TimerMutex(const char *) {}
+};
+
+using TimerLockGuard = std::lock_guard<std::mutex>;
+#endif
+} // namespace MiscServices
+} // namespace OHOS
+#endif // PROFILED_MUTEX_H
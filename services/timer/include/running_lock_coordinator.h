@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RUNNING_LOCK_COORDINATOR_H
+#define RUNNING_LOCK_COORDINATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "power_mgr_client.h"
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * Owns the running lock of the timer service.
+ *
+ * All hold requests are merged into one window ending at `expiredTime_`, the power manager is only called,
+ * without holding `mutex_`, when a request extends that window. Failed lock calls are retried by one delayed
+ * task on TimeTaskExecutor.
+ */
+class RunningLockCoordinator {
+public:
+    static RunningLockCoordinator &GetInstance();
+    // Holds the lock for `holdTimeNs` on behalf of `wakeups` wakeup timers delivered in the same cycle.
+    void HoldForWakeups(int64_t holdTimeNs, uint32_t wakeups);
+    // Holds the lock until `expiredTime` in boot time, returns true if this extended the current window.
+    bool HoldUntil(int64_t expiredTime);
+    void ShowRunningLockInfo(int fd);
+
+private:
+    RunningLockCoordinator() = default;
+    ~RunningLockCoordinator() = default;
+    // needs to acquire the lock `mutex_` before calling this method
+    bool ExtendLocked(int64_t expiredTime, int64_t now);
+    // Locks for the current window, retrying on failure, must not be called with `mutex_` held.
+    void ApplyLock();
+    // Returns false if the power manager could not be called or did not take the lock.
+    bool CallPowerManager();
+    void PostRetry();
+    void Retry();
+
+    std::mutex mutex_;
+    // serializes the power manager calls, `mutex_` is never held while waiting for it
+    std::mutex ipcMutex_;
+    std::shared_ptr<PowerMgr::RunningLock> runningLock_;
+    int64_t expiredTime_ = 0;
+    int32_t retryTimes_ = 0;
+    std::atomic<uint64_t> lockCalls_ {0};
+    std::atomic<uint64_t> retryCalls_ {0};
+    uint64_t wakeups_ = 0;
+    uint64_t cycles_ = 0;
+    int64_t holdTimeNs_ = 0;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // RUNNING_LOCK_COORDINATOR_H
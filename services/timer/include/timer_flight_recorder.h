@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMER_FLIGHT_RECORDER_H
+#define TIMER_FLIGHT_RECORDER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+enum class FlightOp : uint8_t {
+    // value is the trigger time as passed, extra the calling pid, type the timer type
+    START,
+    STOP,
+    DESTROY,
+    // taken out of its batch
+    REMOVE,
+    // value is whenElapsed in ms, extra the window in ms, batch the one joined or -1 for a batch of its own
+    BATCH,
+    // value is whenElapsed in ms, type 1 for a wakeup timer
+    TRIGGER,
+    // the WantAgent of the timer was triggered
+    DELIVER,
+    // value is the deadline in ms, type the alarm type, id is 0
+    KERNEL_SET,
+};
+
+struct FlightRecord {
+    // boot time in ns
+    int64_t time = 0;
+    uint64_t id = 0;
+    int64_t value = 0;
+    int32_t extra = 0;
+    int32_t uid = 0;
+    int32_t tid = 0;
+    int16_t batch = -1;
+    FlightOp op = FlightOp::START;
+    uint8_t type = 0;
+};
+
+/**
+ * The recent timer operations of every thread, kept in binary so that recording neither formats nor allocates.
+ *
+ * Every thread writes to a ring of its own, taken on its first record and handed on to a new thread once it
+ * exits. A thread finding all MAX_RINGS rings taken drops its records. The rings are only decoded for
+ * hidumper and for fault reports.
+ */
+class TimerFlightRecorder {
+public:
+    static constexpr size_t RING_SIZE = 256;
+    static constexpr size_t MAX_RINGS = 32;
+
+    static TimerFlightRecorder &GetInstance();
+    void Record(FlightOp op, uint64_t id, int64_t value = 0, int32_t extra = 0, int32_t uid = 0,
+        int64_t batch = -1, uint8_t type = 0);
+    // Returns the last `count` records of timer `id`, decoded on one line.
+    std::string DescribeTimer(uint64_t id, size_t count);
+    void ShowRecords(int fd);
+
+private:
+    struct Ring;
+    // the ring of the current thread, handed back when the thread exits
+    struct ThreadRing {
+        Ring *ring = nullptr;
+        bool exhausted = false;
+        ~ThreadRing();
+    };
+
+    TimerFlightRecorder() = default;
+    ~TimerFlightRecorder() = default;
+    Ring *AcquireRing();
+    std::vector<FlightRecord> Collect();
+
+    static thread_local ThreadRing threadRing_;
+    // guards the hand over of the rings, never taken to record
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    std::atomic<uint64_t> dropped_ {0};
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // TIMER_FLIGHT_RECORDER_H
@@ -17,6 +17,7 @@
 #define TIMER_HANDLER_H
 
 #include "time_common.h"
+#include "virtual_timer_clock.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -31,14 +32,20 @@ typedef std::array<int, N_TIMER_FDS> TimerFds;
 class TimerHandler {
 public:
     static std::shared_ptr<TimerHandler> Create();
+    // A handler which fires by advancing `clock` instead of the kernel timers, for simulations.
+    static std::shared_ptr<TimerHandler> CreateVirtual(std::shared_ptr<VirtualTimerClock> clock);
     int Set(uint32_t type, std::chrono::nanoseconds when, std::chrono::steady_clock::time_point bootTime);
     uint32_t WaitForAlarm();
+    // Releases a virtual handler waiting for an alarm, the wait on the kernel timers cannot be interrupted.
+    void Stop();
     ~TimerHandler();
 private:
     TimerHandler(const TimerFds &fds, int epollfd);
+    explicit TimerHandler(std::shared_ptr<VirtualTimerClock> clock);
     static int SetRealTimeFd(TimerFds fds);
     const TimerFds fds_;
     const int epollFd_;
+    const std::shared_ptr<VirtualTimerClock> virtualClock_;
 };
 } // MiscService
 } // OHOS
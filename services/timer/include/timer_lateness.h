@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMER_LATENESS_H
+#define TIMER_LATENESS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#include "log_linear_histogram.h"
+#include "timer_info.h"
+
+namespace OHOS {
+namespace MiscServices {
+enum class LatenessStage : uint8_t {
+    // from the start of the window of the timer to the kernel wakeup which delivered it
+    WAKEUP,
+    // from the wakeup to the looper taking the timer out of its batch
+    COLLECT,
+    // from the collection to the return of the callback or the WantAgent
+    DELIVER,
+};
+
+/**
+ * How late timers fire, per delivery stage, in microseconds.
+ *
+ * Every stage has a LogLinearHistogram per timer type, exactness and uid bucket, recorded without locks from
+ * the looper. The histograms are shown by hidumper, what was recorded since the last report is sent as the
+ * TIMER_LATENESS statistic event every REPORT_INTERVAL.
+ */
+class TimerLateness {
+public:
+    static TimerLateness &GetInstance();
+    void Record(LatenessStage stage, const TimerInfo &timer, std::chrono::nanoseconds lateness);
+    // Counts a timer whose wakeup came after the end of its window.
+    void RecordMissedWindow(const TimerInfo &timer);
+    // Starts the periodic statistic event.
+    void StartReport();
+    void ShowLatenessInfo(int fd);
+
+private:
+    static constexpr size_t TYPE_COUNT = TimerTypes::ELAPSED_REALTIME + 1;
+    static constexpr size_t UID_BUCKET_COUNT = 3;
+    static constexpr size_t KEY_COUNT = TYPE_COUNT * 2 * UID_BUCKET_COUNT;
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(LatenessStage::DELIVER) + 1;
+
+    TimerLateness() = default;
+    ~TimerLateness() = default;
+    static size_t GetKey(const TimerInfo &timer);
+    void Report();
+
+    std::array<std::array<LogLinearHistogram, KEY_COUNT>, STAGE_COUNT> histograms_;
+    std::array<std::atomic<uint64_t>, KEY_COUNT> missedWindows_ {};
+    // guards the state of the last report
+    std::mutex reportMutex_;
+    // <stage * KEY_COUNT + key, snapshot>, only the histograms which had values by the last report
+    std::map<size_t, LogLinearHistogram::Snapshot> reported_;
+    std::array<uint64_t, KEY_COUNT> reportedMissedWindows_ {};
+    uint64_t reports_ = 0;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // TIMER_LATENESS_H
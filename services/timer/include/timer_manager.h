@@ -15,12 +15,16 @@
 #ifndef TIMER_MANAGER_H
 #define TIMER_MANAGER_H
 
+#include <array>
 #include <random>
 #include <thread>
 #include <cinttypes>
 
-#include "batch.h"
+#include "profiled_mutex.h"
 #include "timer_handler.h"
+#include "timer_manager_interface.h"
+#include "timer_scheduler.h"
+#include "timer_trace.h"
 
 #ifdef POWER_MANAGER_ENABLE
 #include "completed_callback.h"
@@ -34,6 +38,7 @@
 namespace OHOS {
 namespace MiscServices {
 static std::vector<std::string> NEED_RECOVER_ON_REBOOT = { "not_support" };
+class JsonLinesWriter;
 
 class TimerManager : public ITimerManager {
 public:
@@ -61,6 +66,9 @@ public:
     bool ShowTimerEntryById(int fd, uint64_t timerId);
     bool ShowTimerTriggerById(int fd, uint64_t timerId);
     bool ShowIdleTimerInfo(int fd);
+    void ShowCoalesceInfo(int fd);
+    // Entries, batches, idle state, adjust state and counters, one JSON object per line.
+    void ShowJsonLines(int fd);
     #endif
     #ifdef MULTI_ACCOUNT_ENABLE
     void OnUserRemoved(int userId);
@@ -69,33 +77,74 @@ public:
     ~TimerManager() override;
     void HandleRSSDeath();
     static TimerManager* GetInstance();
+    // A manager on the virtual `clock`, which also becomes the clock of the scheduling core until the manager is
+    // destroyed. It delivers to the callbacks only: no running locks, events, reports, want agents or database.
+    // The global instance keeps the kernel timers, at most one simulated manager may exist at a time.
+    static std::unique_ptr<TimerManager> CreateSimulated(const std::shared_ptr<VirtualTimerClock> &clock);
     #ifdef SET_AUTO_REBOOT_ENABLE
     void ShutDownReschedulePowerOnTimer();
     #endif
+    // Starts recording the timer workload, beginning with the timers which exist already.
+    bool StartTrace();
+    // Stops recording, returns the number of records in the trace.
+    uint64_t StopTrace();
+    // Switches how timers find their batches, for A/B comparisons of the wakeups under each policy.
+    void SetCoalescePolicy(CoalescePolicy policy);
+    // Regroups the batches if MIN_WAKEUP is in use. A simulated manager does not regroup on its own, its driver
+    // calls this every COALESCE_INTERVAL ms of virtual time.
+    void Coalesce();
+    static constexpr int64_t COALESCE_INTERVAL = 5 * 60 * 1000;
 
 private:
-    explicit TimerManager(std::shared_ptr<TimerHandler> impl);
+    #ifdef HIDUMPER_ENABLE
+    // the scheduling state of a timer, copied under `mutex_` so that the dumps format it after releasing the lock
+    struct TimerSnapshot {
+        uint64_t id = 0;
+        int type = 0;
+        uint32_t flags = 0;
+        int uid = 0;
+        bool wakeup = false;
+        int state = 0;
+        // in ms
+        int64_t origWhen = 0;
+        int64_t windowLength = 0;
+        int64_t repeatInterval = 0;
+        // boot time in ns
+        int64_t whenElapsed = 0;
+        int64_t maxWhenElapsed = 0;
+    };
+    static TimerSnapshot TakeSnapshot(const TimerInfo &timer);
+    static void ShowTimerSnapshot(int fd, const TimerSnapshot &timer);
+    static void WriteTimerSnapshot(JsonLinesWriter &writer, const char *kind, const TimerSnapshot &timer);
+    std::vector<std::shared_ptr<TimerEntry>> GetEntrySnapshot();
+    #endif
+
+    explicit TimerManager(std::shared_ptr<TimerHandler> impl, bool simulated = false);
     void TimerLooper();
 
     void SetHandlerLocked(std::shared_ptr<TimerInfo> timer);
     void RemoveHandler(uint64_t id);
     void RemoveLocked(uint64_t id, bool needReschedule);
+    void RemoveTimersLocked(const std::unordered_set<uint64_t> &ids);
+    void RemoveFromBatchesLocked(const std::unordered_set<uint64_t> &ids);
+    void RecordAdjustableTimerLocked(const std::shared_ptr<TimerInfo> &timer);
+    void RebuildAdjustableTimersLocked();
+    bool ExitIdleLocked();
     void ReBatchAllTimers();
     void ReAddTimerLocked(std::shared_ptr<TimerInfo> timer,
                           std::chrono::steady_clock::time_point nowElapsed);
     void SetHandlerLocked(std::shared_ptr<TimerInfo> alarm, bool rebatching, bool isRebatched);
     void InsertAndBatchTimerLocked(std::shared_ptr<TimerInfo> alarm);
-    int64_t AttemptCoalesceLocked(std::chrono::steady_clock::time_point whenElapsed,
-                                  std::chrono::steady_clock::time_point maxWhen);
     void TriggerIdleTimer();
     bool ProcTriggerTimer(std::shared_ptr<TimerInfo> &alarm,
                           const std::chrono::steady_clock::time_point &nowElapsed);
+    // `fired` has the bit of every kernel timer which fired
     bool TriggerTimersLocked(std::vector<std::shared_ptr<TimerInfo>> &triggerList,
-                             std::chrono::steady_clock::time_point nowElapsed);
+                             std::chrono::steady_clock::time_point nowElapsed, uint32_t fired);
     void RescheduleKernelTimerLocked();
-    void DeliverTimersLocked(const std::vector<std::shared_ptr<TimerInfo>> &triggerList);
-    void NotifyWantAgentRetry(std::shared_ptr<TimerInfo> timer);
-    std::shared_ptr<Batch> FindFirstWakeupBatchLocked();
+    void DeliverTimersLocked(const std::vector<std::shared_ptr<TimerInfo>> &triggerList,
+        std::chrono::steady_clock::time_point collected);
+    void NotifyWantAgentRetry(std::shared_ptr<TimerInfo> timer, int retryTimes = 0);
     void SetLocked(int type, std::chrono::nanoseconds when, std::chrono::steady_clock::time_point bootTime);
     int32_t StopTimerInner(uint64_t timerNumber, bool needDestroy);
     int32_t StopTimerInnerLocked(bool needDestroy, uint64_t timerNumber, bool &needRecover);
@@ -111,19 +160,20 @@ private:
     inline bool CheckNeedRecoverOnReboot(std::string bundleName, int type, bool autoRestore);
     #ifdef POWER_MANAGER_ENABLE
     void HandleRunningLock(const std::shared_ptr<Batch> &firstWakeup);
-    void AddRunningLock(long long holdLockTime);
-    void AddRunningLockRetry(long long holdLockTime);
     #endif
 
-    void UpdateTimersState(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger);
+    void UpdateTimersStateLocked(const std::vector<std::pair<std::shared_ptr<TimerInfo>, bool>> &alarms);
     bool AdjustSingleTimer(std::shared_ptr<TimerInfo> timer);
-    bool AdjustSingleTimerLocked(std::shared_ptr<TimerInfo> timer);
     void IncreaseTimerCount(int uid);
     void DecreaseTimerCount(int uid);
     void CheckTimerCount();
     void ShowTimerCountByUid(int count);
     void AddTimerName(int uid, std::string name, uint64_t timerId);
     void DeleteTimerName(int uid, std::string name, uint64_t timerId);
+    void RecordTrace(TimerTraceEvent event, const TimerEntry &entry, int64_t when);
+    void CoalesceLocked();
+    void ScheduleCoalesce();
+    void WriteTrace(TimerTraceRecord &record);
     #ifdef SET_AUTO_REBOOT_ENABLE
     bool IsPowerOnTimer(std::shared_ptr<TimerInfo> timerInfo);
     void DeleteTimerFromPowerOnTimerListById(uint64_t timerId);
@@ -137,12 +187,16 @@ private:
     std::map<int32_t, std::map<std::string, uint64_t>> timerNameMap_;
     std::default_random_engine random_;
     std::atomic_bool runFlag_;
+    // set by CreateSimulated, the manager then has no effect outside of its callbacks
+    const bool simulated_;
     std::shared_ptr<TimerHandler> handler_;
     std::unique_ptr<std::thread> alarmThread_;
     std::vector<std::shared_ptr<Batch>> alarmBatches_;
-    std::mutex mutex_;
-    std::mutex entryMapMutex_;
-    std::mutex timerMapMutex_;
+    // <id, timer> timers in alarmBatches_ that the adjust policy may move
+    std::unordered_map<uint64_t, std::shared_ptr<TimerInfo>> adjustableTimers_;
+    TimerMutex mutex_ {"TimerManager::mutex_"};
+    TimerMutex entryMapMutex_ {"TimerManager::entryMapMutex_"};
+    TimerMutex timerMapMutex_ {"TimerManager::timerMapMutex_"};
     std::chrono::system_clock::time_point lastTimeChangeClockTime_;
     std::chrono::steady_clock::time_point lastTimeChangeRealtime_;
     static std::mutex instanceLock_;
@@ -159,15 +213,26 @@ private:
     uint32_t adjustDelta_ = 0;
     int64_t timerOutOfRangeTimes_ = 0;
     std::chrono::steady_clock::time_point lastTimerOutOfRangeTime_;
+    struct CoalesceStats {
+        std::chrono::nanoseconds activeTime {0};
+        // looper rounds which delivered timers with wakeups
+        uint64_t wakeups = 0;
+        uint64_t batches = 0;
+        uint64_t wakeupBatches = 0;
+    };
+    CoalescePolicy coalescePolicy_ = CoalescePolicy::FIRST_FIT;
+    std::chrono::steady_clock::time_point coalescePolicySince_;
+    std::array<CoalesceStats, static_cast<size_t>(CoalescePolicy::MIN_WAKEUP) + 1> coalesceStats_;
+    uint64_t coalesceRuns_ = 0;
+    // wakeup batches the MIN_WAKEUP regroups took out
+    uint64_t coalesceSavedBatches_ = 0;
+    // the workload is only recorded while a trace is open, see StartTrace
+    std::atomic_bool tracing_ {false};
+    TimerTraceWriter traceWriter_;
     #ifdef SET_AUTO_REBOOT_ENABLE
     std::vector<std::shared_ptr<TimerInfo>> powerOnTriggerTimerList_;
     std::vector<std::string> powerOnApps_;
     #endif
-    #ifdef POWER_MANAGER_ENABLE
-    std::mutex runningLockMutex_;
-    std::shared_ptr<PowerMgr::RunningLock> runningLock_;
-    int64_t lockExpiredTime_ = 0;
-    #endif
 }; // timer_manager
 } // MiscServices
 } // OHOS
@@ -18,6 +18,7 @@
 
 #include "want_agent_helper.h"
 #include "time_common.h"
+#include "timer_types.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -36,29 +37,8 @@ struct TimerEntry {
     std::string bundleName;
 };
 
-class ITimerManager {
+class ITimerManager : public TimerTypes {
 public:
-    enum TimerFlag : uint8_t {
-        STANDALONE = 1 << 0,
-        WAKE_FROM_IDLE = 1 << 1,
-        ALLOW_WHILE_IDLE = 1 << 2,
-        ALLOW_WHILE_IDLE_UNRESTRICTED = 1 << 3,
-        IDLE_UNTIL = 1 << 4,
-        INEXACT_REMINDER = 1 << 5,
-        IS_DISPOSABLE = 1 << 6,
-    };
-
-    enum TimerType : uint8_t {
-        RTC_WAKEUP = 0,
-        RTC = 1,
-        ELAPSED_REALTIME_WAKEUP = 2,
-        ELAPSED_REALTIME = 3,
-        #ifdef SET_AUTO_REBOOT_ENABLE
-        POWER_ON_ALARM = 6,
-        #endif
-        TIMER_TYPE_BUTT
-    };
-
     virtual int32_t CreateTimer(TimerPara &paras,
                                 std::function<int32_t (const uint64_t)> callback,
                                 std::shared_ptr<OHOS::AbilityRuntime::WantAgent::WantAgent> wantAgent,
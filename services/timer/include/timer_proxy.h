@@ -15,8 +15,16 @@
 #ifndef TIMER_PROXY_H
 #define TIMER_PROXY_H
 
+#include <atomic>
+#include <set>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "profiled_mutex.h"
 #include "single_instance.h"
 #include "timer_info.h"
+#include "timer_manager_interface.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -25,18 +33,21 @@ class TimerProxy {
     DECLARE_SINGLE_INSTANCE(TimerProxy)
 public:
     int32_t CallbackAlarmIfNeed(const std::shared_ptr<TimerInfo> &alarm);
-    bool ProxyTimer(int32_t uid, int pid, bool isProxy, bool needRetrigger,
+    // affected timers are reported through `insertAlarmCallback` with their deadlines already updated
+    bool ProxyTimer(int32_t uid, const std::set<int> &pidList, bool isProxy, bool needRetrigger,
         const std::chrono::steady_clock::time_point &now,
         std::function<void(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger)> insertAlarmCallback);
     bool AdjustTimer(bool isAdjust, uint32_t interval,
         const std::chrono::steady_clock::time_point &now, uint32_t delta,
         std::function<void(AdjustTimerCallback adjustTimer)> updateTimerDeliveries);
     bool SetTimerExemption(const std::unordered_set<std::string> &nameArr, bool isExemption);
-    bool IsTimerExemption(std::shared_ptr<TimerInfo> time);
+    bool IsTimerExemption(const std::shared_ptr<TimerInfo> &timer);
     void SetAdjustPolicy(const std::unordered_map<std::string, uint32_t> &policyMap);
     bool ResetAllProxy(const std::chrono::steady_clock::time_point &now,
         std::function<void(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger)> insertAlarmCallback);
-    void EraseTimerFromProxyTimerMap(const uint64_t id, const int uid, const int pid);
+    void EraseTimerFromProxyTimerMap(const uint64_t id);
+    // drops a removed timer from the adjusted set so it is not restored later
+    void EraseAdjustTimer(uint64_t id);
     void RecordUidTimerMap(const std::shared_ptr<TimerInfo> &alarm, const bool isRebatched);
     void RecordProxyTimerMap(const std::shared_ptr<TimerInfo> &alarm, bool isPid);
     void RemoveUidTimerMap(const std::shared_ptr<TimerInfo> &alarm);
@@ -44,18 +55,33 @@ public:
     void RemoveUidTimerMap(const uint64_t id);
     int32_t CountUidTimerMapByUid(int32_t uid);
     bool IsProxy(const int32_t uid, const int32_t pid);
-    bool IsProxyLocked(const int32_t uid, const int32_t pid);
+    // checks both the whole uid and the single pid against one snapshot
+    bool IsUidOrPidProxy(const int32_t uid, const int32_t pid);
     #ifdef HIDUMPER_ENABLE
     bool ShowProxyTimerInfo(int fd, const int64_t now);
     bool ShowUidTimerMapInfo(int fd, const int64_t now);
     bool ShowProxyDelayTime(int fd);
     void ShowAdjustTimerInfo(int fd);
+    // Proxies, uid timers and adjusted timers, one JSON object per line.
+    void ShowJsonLines(int fd);
     #endif
     int64_t GetProxyDelayTime() const;
 
 private:
+    #ifdef HIDUMPER_ENABLE
+    // copied under the lock of each map, the dumps format them after releasing it
+    std::vector<std::pair<uint64_t, std::vector<uint64_t>>> GetProxyTimerSnapshot();
+    std::vector<std::tuple<int32_t, uint64_t, int64_t>> GetUidTimerSnapshot();
+    std::vector<uint64_t> GetAdjustTimerSnapshot();
+    #endif
+    using ProxyKeySet = std::unordered_set<uint64_t>;
+
     void EraseAlarmItem(
         const uint64_t id, std::unordered_map<uint64_t, std::shared_ptr<TimerInfo>> &idAlarmsMap);
+    std::shared_ptr<const ProxyKeySet> LoadProxyKeys();
+    void PublishProxyKeysLocked();
+    void IndexProxyTimerLocked(const uint64_t id, const uint64_t key);
+    void EraseProxyKeyLocked(const uint64_t key);
     void UpdateProxyWhenElapsedForProxyTimers(const int32_t uid, const int32_t pid,
         const std::chrono::steady_clock::time_point &now,
         std::function<void(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger)> insertAlarmCallback,
@@ -63,6 +89,7 @@ private:
     bool UpdateAdjustWhenElapsed(const std::chrono::steady_clock::time_point &now,  uint32_t delta,
         uint32_t interval, std::shared_ptr<TimerInfo> &timer);
     bool RestoreAdjustWhenElapsed(std::shared_ptr<TimerInfo> &timer);
+    bool IsTimerExemptionLocked(const std::shared_ptr<TimerInfo> &timer);
     bool RestoreProxyWhenElapsed(const int32_t uid, const int32_t pid,
         const std::chrono::steady_clock::time_point &now,
         std::function<void(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger)> insertAlarmCallback,
@@ -74,16 +101,25 @@ private:
     void ResetAllProxyWhenElapsed(const std::chrono::steady_clock::time_point &now,
         std::function<void(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger)> insertAlarmCallback);
 
-    std::mutex uidTimersMutex_;
+    TimerMutex uidTimersMutex_ {"TimerProxy::uidTimersMutex_"};
     /* <uid, <id, alarm ptr>> */
     std::unordered_map<int32_t, std::unordered_map<uint64_t, std::shared_ptr<TimerInfo>>> uidTimersMap_ {};
-    std::mutex proxyMutex_;
+    /* <id, uid> */
+    std::unordered_map<uint64_t, int32_t> timerUidIndex_ {};
+    TimerMutex proxyMutex_ {"TimerProxy::proxyMutex_"};
     /* <(uid << 32) | pid, [timerid]> */
-    std::unordered_map<uint64_t, std::vector<uint64_t>> proxyTimers_ {};
-    std::mutex adjustMutex_;
+    std::unordered_map<uint64_t, std::unordered_set<uint64_t>> proxyTimers_ {};
+    /* <id, [(uid << 32) | pid]>, a timer is recorded under its uid key, its pid key or both */
+    std::unordered_map<uint64_t, std::vector<uint64_t>> timerProxyKeyIndex_ {};
+    /* immutable copy of the keys of proxyTimers_, replaced under proxyMutex_ and read without locking */
+    std::shared_ptr<const ProxyKeySet> proxyKeys_ = std::make_shared<const ProxyKeySet>();
+    std::atomic<bool> hasProxyKeys_ {false};
+    TimerMutex adjustMutex_ {"TimerProxy::adjustMutex_"};
     std::unordered_set<std::string> adjustExemptionList_ { "time_service" };
     std::unordered_set<uint64_t> adjustTimers_ {};
     std::unordered_map<std::string, uint32_t> adjustPolicyList_ {};
+    /* bumped whenever adjustExemptionList_ or adjustPolicyList_ changes, invalidates cached verdicts */
+    uint64_t adjustVersion_ = 1;
     /* ms for 3 days */
     int64_t proxyDelayTime_ = 3 * 24 * 60 * 60 * 1000;
 }; // timer_proxy
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMER_WAKEUP_STATS_H
+#define TIMER_WAKEUP_STATS_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "timer_info.h"
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * Which uids the kernel wakeups are charged to.
+ *
+ * A fire of the RTC_WAKEUP or ELAPSED_REALTIME_WAKEUP kernel timer is charged to the wakeup timer with the
+ * earliest deadline among the timers due, the other timers due ride along for free. The counts are kept per
+ * window of WINDOW_LENGTH, hidumper shows the open window and the last WINDOW_COUNT closed ones, and each
+ * window is sent as the TIMER_WAKEUP statistic event when it closes. The looper only counts, timer names are
+ * looked up when a window is shown or reported.
+ */
+class TimerWakeupStats {
+public:
+    static TimerWakeupStats &GetInstance();
+    // `fired` has the bit of every kernel timer which fired, `timers` are the timers due, before they are
+    // rescheduled.
+    void RecordWakeup(uint32_t fired, const std::vector<std::shared_ptr<TimerInfo>> &timers);
+    // Starts closing and reporting the windows.
+    void StartReport();
+    void ShowWakeupInfo(int fd);
+
+private:
+    static constexpr size_t WINDOW_COUNT = 24;
+    static constexpr size_t MAX_TIMER_NAMES = 8;
+    static constexpr size_t BATCH_SIZE_BUCKETS = 5;
+
+    struct TimerCount {
+        uint64_t id = 0;
+        // the name is read from the timer when shown, a destroyed timer is shown by its id
+        std::weak_ptr<TimerInfo> timer;
+        // wakeups charged to the timer
+        uint64_t wakeups = 0;
+    };
+    struct UidStats {
+        // wakeups charged to the uid
+        uint64_t wakeups = 0;
+        // timers of other uids due at the wakeups charged to the uid
+        uint64_t riders = 0;
+        // timers of the uid due at wakeups charged to other uids
+        uint64_t rides = 0;
+        // the first MAX_TIMER_NAMES timers charged, the wakeups of any further ones go to otherWakeups
+        std::array<TimerCount, MAX_TIMER_NAMES> timers {};
+        size_t timerCount = 0;
+        uint64_t otherWakeups = 0;
+    };
+    struct Window {
+        // boot time in ms
+        int64_t start = 0;
+        int64_t end = 0;
+        uint64_t wakeups = 0;
+        uint64_t rtcWakeups = 0;
+        uint64_t elapsedWakeups = 0;
+        uint64_t timers = 0;
+        // wakeups with 1, 2, 3 to 4, 5 to 8 and more timers due
+        std::array<uint64_t, BATCH_SIZE_BUCKETS> batchSizes {};
+        std::map<int32_t, UidStats> uids;
+    };
+
+    TimerWakeupStats() = default;
+    ~TimerWakeupStats() = default;
+    static int64_t GetBootTimeMs();
+    static std::string GetTimerName(const TimerCount &count);
+    static void ShowWindow(int fd, const Window &window);
+    void CloseWindow();
+
+    std::mutex mutex_;
+    Window current_;
+    std::deque<Window> closed_;
+    uint64_t reports_ = 0;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // TIMER_WAKEUP_STATS_H
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "json_lines_writer.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+constexpr unsigned char FIRST_PRINTABLE = 0x20;
+constexpr int HIGH_NIBBLE_SHIFT = 4;
+constexpr unsigned char LOW_NIBBLE_MASK = 0xf;
+}
+
+JsonLinesWriter::JsonLinesWriter(int fd) : fd_(fd)
+{
+    buffer_.reserve(FLUSH_SIZE);
+}
+
+JsonLinesWriter::~JsonLinesWriter()
+{
+    Flush();
+}
+
+JsonLinesWriter &JsonLinesWriter::Begin(const char *kind)
+{
+    buffer_ += "{\"kind\":\"";
+    buffer_ += kind;
+    buffer_ += "\"";
+    return *this;
+}
+
+void JsonLinesWriter::AddKey(const char *key)
+{
+    buffer_ += ",\"";
+    buffer_ += key;
+    buffer_ += "\":";
+}
+
+JsonLinesWriter &JsonLinesWriter::AddInt(const char *key, int64_t value)
+{
+    AddKey(key);
+    buffer_ += std::to_string(value);
+    return *this;
+}
+
+JsonLinesWriter &JsonLinesWriter::AddUint(const char *key, uint64_t value)
+{
+    AddKey(key);
+    buffer_ += std::to_string(value);
+    return *this;
+}
+
+JsonLinesWriter &JsonLinesWriter::AddBool(const char *key, bool value)
+{
+    AddKey(key);
+    buffer_ += value ? "true" : "false";
+    return *this;
+}
+
+JsonLinesWriter &JsonLinesWriter::AddString(const char *key, const std::string &value)
+{
+    AddKey(key);
+    buffer_ += '"';
+    for (char c : value) {
+        auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            buffer_ += '\\';
+            buffer_ += c;
+        } else if (byte < FIRST_PRINTABLE) {
+            buffer_ += "\\u00";
+            buffer_ += HEX_DIGITS[byte >> HIGH_NIBBLE_SHIFT];
+            buffer_ += HEX_DIGITS[byte & LOW_NIBBLE_MASK];
+        } else {
+            buffer_ += c;
+        }
+    }
+    buffer_ += '"';
+    return *this;
+}
+
+JsonLinesWriter &JsonLinesWriter::AddUintArray(const char *key, const std::vector<uint64_t> &values)
+{
+    AddKey(key);
+    buffer_ += '[';
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) {
+            buffer_ += ',';
+        }
+        buffer_ += std::to_string(values[i]);
+    }
+    buffer_ += ']';
+    return *this;
+}
+
+void JsonLinesWriter::End()
+{
+    buffer_ += "}\n";
+    if (buffer_.size() >= FLUSH_SIZE) {
+        Flush();
+    }
+}
+
+void JsonLinesWriter::Flush()
+{
+    size_t written = 0;
+    while (written < buffer_.size()) {
+        auto ret = write(fd_, buffer_.data() + written, buffer_.size() - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break;
+        }
+        written += static_cast<size_t>(ret);
+    }
+    buffer_.clear();
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "profiled_mutex.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+using namespace std::chrono;
+namespace {
+constexpr uint64_t NANO_TO_MICRO = 1000;
+constexpr double P50 = 0.5;
+constexpr double P99 = 0.99;
+
+std::mutex &GetRegistryMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<const ProfiledMutex *> &GetRegistry()
+{
+    static std::vector<const ProfiledMutex *> registry;
+    return registry;
+}
+}
+
+ProfiledMutex::ProfiledMutex(const char *name) : name_(name)
+{
+    std::lock_guard<std::mutex> lock(GetRegistryMutex());
+    GetRegistry().push_back(this);
+}
+
+ProfiledMutex::~ProfiledMutex()
+{
+    std::lock_guard<std::mutex> lock(GetRegistryMutex());
+    auto &registry = GetRegistry();
+    registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+}
+
+void ProfiledMutex::lock(const char *function, uint32_t line)
+{
+    uint64_t wait = 0;
+    if (mutex_.try_lock()) {
+        lockedAt_ = steady_clock::now();
+    } else {
+        auto start = steady_clock::now();
+        mutex_.lock();
+        lockedAt_ = steady_clock::now();
+        wait = static_cast<uint64_t>(duration_cast<nanoseconds>(lockedAt_ - start).count());
+        contentions_.store(contentions_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        waitTotal_.store(waitTotal_.load(std::memory_order_relaxed) + wait, std::memory_order_relaxed);
+        if (wait > maxWait_.load(std::memory_order_relaxed)) {
+            maxWait_.store(wait, std::memory_order_relaxed);
+            maxWaitSite_.function.store(function, std::memory_order_relaxed);
+            maxWaitSite_.line.store(line, std::memory_order_relaxed);
+        }
+    }
+    // only the holder writes the statistics, a load and a store are enough
+    acquisitions_.store(acquisitions_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    waits_.Record(wait);
+    holderFunction_ = function;
+    holderLine_ = line;
+}
+
+void ProfiledMutex::unlock()
+{
+    auto hold = static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now() - lockedAt_).count());
+    holdTotal_.store(holdTotal_.load(std::memory_order_relaxed) + hold, std::memory_order_relaxed);
+    holds_.Record(hold);
+    if (hold > maxHold_.load(std::memory_order_relaxed)) {
+        maxHold_.store(hold, std::memory_order_relaxed);
+        maxHoldSite_.function.store(holderFunction_, std::memory_order_relaxed);
+        maxHoldSite_.line.store(holderLine_, std::memory_order_relaxed);
+    }
+    mutex_.unlock();
+}
+
+void ProfiledMutex::ShowLockInfo(int fd)
+{
+    std::lock_guard<std::mutex> lock(GetRegistryMutex());
+    auto mutexes = GetRegistry();
+    std::sort(mutexes.begin(), mutexes.end(), [](const ProfiledMutex *l, const ProfiledMutex *r) {
+        return l->waitTotal_.load(std::memory_order_relaxed) > r->waitTotal_.load(std::memory_order_relaxed);
+    });
+    for (const auto mutex : mutexes) {
+        mutex->ShowInfo(fd);
+    }
+}
+
+void ProfiledMutex::ShowInfo(int fd) const
+{
+    auto waits = waits_.GetSnapshot();
+    auto holds = holds_.GetSnapshot();
+    dprintf(fd, " * lock                    = %s\n", name_);
+    dprintf(fd, "   * acquisitions          = %" PRIu64 "\n", acquisitions_.load(std::memory_order_relaxed));
+    dprintf(fd, "   * contentions           = %" PRIu64 "\n", contentions_.load(std::memory_order_relaxed));
+    dprintf(fd, "   * wait total            = %" PRIu64 "us\n",
+        waitTotal_.load(std::memory_order_relaxed) / NANO_TO_MICRO);
+    auto maxWait = maxWait_.load(std::memory_order_relaxed);
+    dprintf(fd, "   * wait p50/p99/max(ns)  = %" PRIu64 "/%" PRIu64 "/%" PRIu64 "\n",
+        std::min(waits.GetPercentile(P50), maxWait), std::min(waits.GetPercentile(P99), maxWait), maxWait);
+    dprintf(fd, "   * longest waiter        = %s:%u\n", maxWaitSite_.function.load(std::memory_order_relaxed),
+        maxWaitSite_.line.load(std::memory_order_relaxed));
+    dprintf(fd, "   * hold total            = %" PRIu64 "us\n",
+        holdTotal_.load(std::memory_order_relaxed) / NANO_TO_MICRO);
+    auto maxHold = maxHold_.load(std::memory_order_relaxed);
+    dprintf(fd, "   * hold p50/p99/max(ns)  = %" PRIu64 "/%" PRIu64 "/%" PRIu64 "\n",
+        std::min(holds.GetPercentile(P50), maxHold), std::min(holds.GetPercentile(P99), maxHold), maxHold);
+    dprintf(fd, "   * longest holder        = %s:%u\n", maxHoldSite_.function.load(std::memory_order_relaxed),
+        maxHoldSite_.line.load(std::memory_order_relaxed));
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "running_lock_coordinator.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "time_common.h"
+#include "time_task_executor.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr int64_t NANO_TO_MILLI = 1000000;
+// a window is held this much longer than requested, requests ending within it are served by it
+constexpr int64_t MERGE_TOLERANCE = 10 * NANO_TO_MILLI;
+constexpr int POWER_RETRY_TIMES = 10;
+constexpr int64_t POWER_RETRY_INTERVAL = 10;
+constexpr const char* POWER_RETRY_TASK = "running_lock_retry";
+}
+
+RunningLockCoordinator &RunningLockCoordinator::GetInstance()
+{
+    static RunningLockCoordinator instance;
+    return instance;
+}
+
+void RunningLockCoordinator::HoldForWakeups(int64_t holdTimeNs, uint32_t wakeups)
+{
+    int64_t now = 0;
+    TimeUtils::GetBootTimeNs(now);
+    bool extended = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wakeups_ += wakeups;
+        cycles_++;
+        // every window of the cycle starts now, so their union simply ends at the longest one
+        extended = ExtendLocked(now + holdTimeNs, now);
+    }
+    if (extended) {
+        ApplyLock();
+    }
+}
+
+bool RunningLockCoordinator::HoldUntil(int64_t expiredTime)
+{
+    int64_t now = 0;
+    TimeUtils::GetBootTimeNs(now);
+    bool extended = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        extended = ExtendLocked(expiredTime, now);
+    }
+    if (extended) {
+        ApplyLock();
+    }
+    return extended;
+}
+
+bool RunningLockCoordinator::ExtendLocked(int64_t expiredTime, int64_t now)
+{
+    if (expiredTime <= now || expiredTime <= expiredTime_) {
+        return false;
+    }
+    // held a little past the request, the requests ending just after it are then served by this window
+    expiredTime += MERGE_TOLERANCE;
+    holdTimeNs_ += expiredTime - std::max(now, expiredTime_);
+    expiredTime_ = expiredTime;
+    return true;
+}
+
+void RunningLockCoordinator::ApplyLock()
+{
+    if (CallPowerManager()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retryTimes_ = POWER_RETRY_TIMES;
+    }
+    PostRetry();
+}
+
+bool RunningLockCoordinator::CallPowerManager()
+{
+    // the calls are serialized and each one takes the window as it is by then, so a call made for a shorter
+    // window never lands after the one for a longer window
+    std::lock_guard<std::mutex> ipcLock(ipcMutex_);
+    int64_t now = 0;
+    TimeUtils::GetBootTimeNs(now);
+    int64_t expiredTime = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expiredTime = expiredTime_;
+    }
+    if (expiredTime <= now) {
+        return true;
+    }
+    if (runningLock_ == nullptr) {
+        TIME_HILOGI(TIME_MODULE_SERVICE, "runningLock is nullptr, create runningLock");
+        runningLock_ = PowerMgr::PowerMgrClient::GetInstance().CreateRunningLock("timeServiceRunningLock",
+            PowerMgr::RunningLockType::RUNNINGLOCK_BACKGROUND_NOTIFICATION);
+        if (runningLock_ == nullptr) {
+            return false;
+        }
+    }
+    lockCalls_.fetch_add(1, std::memory_order_relaxed);
+    runningLock_->Lock(static_cast<int32_t>((expiredTime - now) / NANO_TO_MILLI));
+    return runningLock_->IsUsed();
+}
+
+void RunningLockCoordinator::PostRetry()
+{
+    // a retry still waiting in the executor picks up the refreshed retry times
+    TimeTaskExecutor::GetInstance().PostPeriodic(POWER_RETRY_TASK, [this] { Retry(); }, POWER_RETRY_INTERVAL);
+}
+
+void RunningLockCoordinator::Retry()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (retryTimes_ <= 0) {
+            return;
+        }
+        retryTimes_--;
+    }
+    retryCalls_.fetch_add(1, std::memory_order_relaxed);
+    bool locked = CallPowerManager();
+    bool retry = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (locked) {
+            retryTimes_ = 0;
+        }
+        retry = retryTimes_ > 0;
+    }
+    if (retry) {
+        PostRetry();
+    }
+}
+
+void RunningLockCoordinator::ShowRunningLockInfo(int fd)
+{
+    int64_t now = 0;
+    TimeUtils::GetBootTimeNs(now);
+    std::lock_guard<std::mutex> lock(mutex_);
+    dprintf(fd, " * wakeups                 = %" PRIu64 "\n", wakeups_);
+    dprintf(fd, " * delivery cycles         = %" PRIu64 "\n", cycles_);
+    uint64_t lockCalls = lockCalls_.load(std::memory_order_relaxed);
+    dprintf(fd, " * lock ipc calls          = %" PRIu64 "\n", lockCalls);
+    dprintf(fd, " * lock retry calls        = %" PRIu64 "\n", retryCalls_.load(std::memory_order_relaxed));
+    dprintf(fd, " * lock hold time          = %" PRId64 "ms\n", holdTimeNs_ / NANO_TO_MILLI);
+    if (wakeups_ > 0) {
+        dprintf(fd, " * lock ipc calls/wakeup   = %.3f\n", static_cast<double>(lockCalls) / wakeups_);
+        dprintf(fd, " * lock hold time/wakeup   = %.3fms\n",
+            static_cast<double>(holdTimeNs_) / NANO_TO_MILLI / wakeups_);
+    }
+    dprintf(fd, " * lock remaining          = %" PRId64 "ms\n",
+        expiredTime_ > now ? (expiredTime_ - now) / NANO_TO_MILLI : 0);
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "timer_flight_recorder.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "timer_platform.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr int64_t NANO_TO_MILLI = 1000000;
+constexpr int64_t NANO_TO_MICRO = 1000;
+constexpr int64_t MICRO_TO_SECOND = 1000000;
+constexpr size_t THREAD_NAME_LEN = 16;
+constexpr const char* OP_NAMES[] = {
+    "start", "stop", "destroy", "remove", "batch", "trigger", "deliver", "kernel_set"
+};
+}
+
+struct TimerFlightRecorder::Ring {
+    std::array<FlightRecord, RING_SIZE> records;
+    // count of the records written, the next one goes to `head % RING_SIZE`
+    std::atomic<uint64_t> head {0};
+    std::atomic<bool> inUse {false};
+    // the thread writing to the ring, its records stay after it exits
+    int32_t tid = 0;
+    char threadName[THREAD_NAME_LEN] = {};
+};
+
+thread_local TimerFlightRecorder::ThreadRing TimerFlightRecorder::threadRing_;
+
+TimerFlightRecorder::ThreadRing::~ThreadRing()
+{
+    if (ring != nullptr) {
+        ring->inUse.store(false, std::memory_order_release);
+    }
+}
+
+TimerFlightRecorder &TimerFlightRecorder::GetInstance()
+{
+    static TimerFlightRecorder instance;
+    return instance;
+}
+
+TimerFlightRecorder::Ring *TimerFlightRecorder::AcquireRing()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Ring *ring = nullptr;
+    for (auto &candidate : rings_) {
+        if (!candidate->inUse.load(std::memory_order_acquire)) {
+            ring = candidate.get();
+            break;
+        }
+    }
+    if (ring == nullptr) {
+        if (rings_.size() >= MAX_RINGS) {
+            return nullptr;
+        }
+        rings_.push_back(std::make_unique<Ring>());
+        ring = rings_.back().get();
+    }
+    ring->inUse.store(true, std::memory_order_relaxed);
+    ring->tid = static_cast<int32_t>(syscall(SYS_gettid));
+    if (pthread_getname_np(pthread_self(), ring->threadName, THREAD_NAME_LEN) != 0) {
+        ring->threadName[0] = '\0';
+    }
+    return ring;
+}
+
+void TimerFlightRecorder::Record(FlightOp op, uint64_t id, int64_t value, int32_t extra, int32_t uid,
+    int64_t batch, uint8_t type)
+{
+    auto &threadRing = threadRing_;
+    if (threadRing.ring == nullptr) {
+        // a thread left without a ring does not contend for one again
+        if (!threadRing.exhausted) {
+            threadRing.ring = AcquireRing();
+            threadRing.exhausted = threadRing.ring == nullptr;
+        }
+        if (threadRing.ring == nullptr) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    Ring *ring = threadRing.ring;
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    auto &record = ring->records[head % RING_SIZE];
+    record.time = TimerPlatform::GetInstance().GetBootTime().time_since_epoch().count();
+    record.id = id;
+    record.value = value;
+    record.extra = extra;
+    record.uid = uid;
+    record.tid = ring->tid;
+    record.batch = static_cast<int16_t>(std::clamp<int64_t>(batch, -1, INT16_MAX));
+    record.op = op;
+    record.type = type;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+// Copies the records of all rings in time order. The writers are not stopped, a slot they may have
+// overwritten during the copy is left out.
+std::vector<FlightRecord> TimerFlightRecorder::Collect()
+{
+    std::vector<FlightRecord> records;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto copy = std::make_unique<std::array<FlightRecord, RING_SIZE>>();
+    for (auto &ring : rings_) {
+        uint64_t end = ring->head.load(std::memory_order_acquire);
+        *copy = ring->records;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = ring->head.load(std::memory_order_relaxed);
+        // the writer was at most at `after`, which overwrites the record RING_SIZE before it
+        uint64_t begin = (end > RING_SIZE) ? end - RING_SIZE : 0;
+        if (after + 1 > RING_SIZE) {
+            begin = std::max(begin, after + 1 - RING_SIZE);
+        }
+        for (uint64_t i = begin; i < end; i++) {
+            records.push_back((*copy)[i % RING_SIZE]);
+        }
+    }
+    std::stable_sort(records.begin(), records.end(),
+        [](const FlightRecord &a, const FlightRecord &b) { return a.time < b.time; });
+    return records;
+}
+
+std::string TimerFlightRecorder::DescribeTimer(uint64_t id, size_t count)
+{
+    auto records = Collect();
+    std::string description;
+    size_t skip = std::count_if(records.begin(), records.end(),
+        [id](const FlightRecord &record) { return record.id == id; });
+    skip = (skip > count) ? skip - count : 0;
+    for (const auto &record : records) {
+        if (record.id != id) {
+            continue;
+        }
+        if (skip > 0) {
+            skip--;
+            continue;
+        }
+        if (!description.empty()) {
+            description += " ";
+        }
+        description += OP_NAMES[static_cast<size_t>(record.op)];
+        description += "@" + std::to_string(record.time / NANO_TO_MILLI);
+    }
+    return description;
+}
+
+void TimerFlightRecorder::ShowRecords(int fd)
+{
+    auto records = Collect();
+    std::vector<std::pair<int32_t, std::string>> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &ring : rings_) {
+            threads.emplace_back(ring->tid, ring->threadName);
+        }
+    }
+    dprintf(fd, " * rings                   = %zu\n", threads.size());
+    for (const auto &thread : threads) {
+        dprintf(fd, "   * thread                = %s(%d)\n", thread.second.c_str(), thread.first);
+    }
+    dprintf(fd, " * dropped records         = %" PRIu64 "\n", dropped_.load(std::memory_order_relaxed));
+    dprintf(fd, " * records                 = %zu\n", records.size());
+    for (const auto &record : records) {
+        int64_t micros = record.time / NANO_TO_MICRO;
+        dprintf(fd, "   * %" PRId64 ".%06" PRId64 " tid:%d %s", micros / MICRO_TO_SECOND, micros % MICRO_TO_SECOND,
+            record.tid, OP_NAMES[static_cast<size_t>(record.op)]);
+        switch (record.op) {
+            case FlightOp::START:
+                dprintf(fd, " id:%" PRIu64 " uid:%d pid:%d type:%u trigger:%" PRId64 "\n", record.id, record.uid,
+                    record.extra, record.type, record.value);
+                break;
+            case FlightOp::BATCH:
+                dprintf(fd, " id:%" PRIu64 " uid:%d when:%" PRId64 " window:%d batch:%d\n", record.id, record.uid,
+                    record.value, record.extra, record.batch);
+                break;
+            case FlightOp::TRIGGER:
+                dprintf(fd, " id:%" PRIu64 " uid:%d when:%" PRId64 " wakeup:%u\n", record.id, record.uid,
+                    record.value, record.type);
+                break;
+            case FlightOp::KERNEL_SET:
+                dprintf(fd, " type:%u deadline:%" PRId64 "\n", record.type, record.value);
+                break;
+            default:
+                dprintf(fd, " id:%" PRIu64 " uid:%d\n", record.id, record.uid);
+                break;
+        }
+    }
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -18,12 +18,14 @@
 #include <sys/timerfd.h>
 #include <sstream>
 #include "timer_handler.h"
+#include "timer_flight_recorder.h"
 #include "timer_manager_interface.h"
 
 namespace OHOS {
 namespace MiscServices {
 namespace {
 static constexpr uint32_t ALARM_TIME_CHANGE_MASK = 1 << 16;
+static_assert(VirtualTimerClock::TIME_CHANGED == ALARM_TIME_CHANGE_MASK, "virtual time change bit mismatch");
 constexpr int CLOCK_POWEROFF_ALARM = 12;
 static constexpr clockid_t alarm_to_clock_id[N_TIMER_FDS] = {
     CLOCK_REALTIME_ALARM,
@@ -108,13 +110,29 @@ int TimerHandler::SetRealTimeFd(TimerFds fds)
     return err;
 }
 
+std::shared_ptr<TimerHandler> TimerHandler::CreateVirtual(std::shared_ptr<VirtualTimerClock> clock)
+{
+    if (clock == nullptr) {
+        return nullptr;
+    }
+    return std::shared_ptr<TimerHandler>(new (std::nothrow)TimerHandler(std::move(clock)));
+}
+
 TimerHandler::TimerHandler(const TimerFds &fds, int epollfd)
     : fds_ {fds}, epollFd_ {epollfd}
 {
 }
 
+TimerHandler::TimerHandler(std::shared_ptr<VirtualTimerClock> clock)
+    : fds_ {}, epollFd_ {-1}, virtualClock_ {std::move(clock)}
+{
+}
+
 TimerHandler::~TimerHandler()
 {
+    if (virtualClock_ != nullptr) {
+        return;
+    }
     for (auto fd : fds_) {
         epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
         close(fd);
@@ -128,16 +146,15 @@ int TimerHandler::Set(uint32_t type, std::chrono::nanoseconds when, std::chrono:
         errno = EINVAL;
         return -1;
     }
+    if (virtualClock_ != nullptr) {
+        virtualClock_->Set(type, when);
+        return 0;
+    }
 
     auto second = std::chrono::duration_cast<std::chrono::seconds>(when);
     auto milliSecond = std::chrono::duration_cast<std::chrono::milliseconds>(when);
-    auto bootTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(bootTime.time_since_epoch());
-    if (type == static_cast<uint32_t>(ITimerManager::TimerType::ELAPSED_REALTIME_WAKEUP)) {
-        TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "t%{public}d %{public}lld bt:%{public}lld", type,
-            milliSecond.count(), bootTimeMs.count());
-    } else {
-        TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "t%{public}d %{public}lld", type, milliSecond.count());
-    }
+    TimerFlightRecorder::GetInstance().Record(FlightOp::KERNEL_SET, 0, milliSecond.count(), 0, 0, -1,
+        static_cast<uint8_t>(type));
     timespec ts {second.count(), (when - second).count()};
     itimerspec spec {timespec {}, ts};
     int ret = timerfd_settime(fds_[type], TFD_TIMER_ABSTIME, &spec, nullptr);
@@ -150,6 +167,9 @@ int TimerHandler::Set(uint32_t type, std::chrono::nanoseconds when, std::chrono:
 
 uint32_t TimerHandler::WaitForAlarm()
 {
+    if (virtualClock_ != nullptr) {
+        return virtualClock_->WaitForAlarm();
+    }
     epoll_event events[N_TIMER_FDS];
 
     int nevents = 0;
@@ -174,5 +194,12 @@ uint32_t TimerHandler::WaitForAlarm()
     }
     return result;
 }
+
+void TimerHandler::Stop()
+{
+    if (virtualClock_ != nullptr) {
+        virtualClock_->Stop();
+    }
+}
 } // MiscServices
 } // OHOS
\ No newline at end of file
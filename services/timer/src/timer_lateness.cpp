@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "timer_lateness.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "time_sysevent.h"
+#include "time_task_executor.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr int64_t NANO_TO_MICRO = 1000;
+// executor key and period of the statistic event
+constexpr const char* REPORT_TASK = "timer_lateness_report";
+constexpr int64_t REPORT_INTERVAL = 60 * 60 * 1000;
+constexpr int ROOT_UID = 0;
+constexpr int APP_UID_START = 10000;
+constexpr double P50 = 0.5;
+constexpr double P90 = 0.9;
+constexpr double P99 = 0.99;
+constexpr const char* STAGE_NAMES[] = { "wakeup", "collect", "deliver" };
+constexpr const char* TYPE_NAMES[] = { "rtc_wakeup", "rtc", "realtime_wakeup", "realtime" };
+constexpr const char* UID_BUCKET_NAMES[] = { "root", "system", "app" };
+}
+
+TimerLateness &TimerLateness::GetInstance()
+{
+    static TimerLateness instance;
+    return instance;
+}
+
+size_t TimerLateness::GetKey(const TimerInfo &timer)
+{
+    // the power on alarm is an RTC wakeup alarm
+    size_t type = (timer.type >= 0 && static_cast<size_t>(timer.type) < TYPE_COUNT) ?
+        static_cast<size_t>(timer.type) : TimerTypes::RTC_WAKEUP;
+    size_t exact = (timer.windowLength == std::chrono::milliseconds::zero()) ? 1 : 0;
+    size_t uidBucket = (timer.uid == ROOT_UID) ? 0 : ((timer.uid < APP_UID_START) ? 1 : 2);
+    return (type * 2 + exact) * UID_BUCKET_COUNT + uidBucket;
+}
+
+void TimerLateness::Record(LatenessStage stage, const TimerInfo &timer, std::chrono::nanoseconds lateness)
+{
+    auto micros = std::max<int64_t>(lateness.count() / NANO_TO_MICRO, 0);
+    histograms_[static_cast<size_t>(stage)][GetKey(timer)].Record(static_cast<uint64_t>(micros));
+}
+
+void TimerLateness::RecordMissedWindow(const TimerInfo &timer)
+{
+    missedWindows_[GetKey(timer)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void TimerLateness::StartReport()
+{
+    auto report = [this]() {
+        Report();
+        StartReport();
+    };
+    // periodic, so a full executor queue can not end the chain; a coalesced post leaves the pending task running it
+    TimeTaskExecutor::GetInstance().PostPeriodic(REPORT_TASK, report, REPORT_INTERVAL);
+}
+
+void TimerLateness::Report()
+{
+    std::lock_guard<std::mutex> lock(reportMutex_);
+    TimerLatenessStatistic statistic;
+    for (size_t stage = 0; stage < STAGE_COUNT; stage++) {
+        for (size_t key = 0; key < KEY_COUNT; key++) {
+            auto snapshot = histograms_[stage][key].GetSnapshot();
+            if (snapshot.count == 0) {
+                continue;
+            }
+            auto &reported = reported_[stage * KEY_COUNT + key];
+            auto delta = snapshot.Since(reported);
+            reported = snapshot;
+            if (delta.count == 0) {
+                continue;
+            }
+            uint64_t missedWindows = 0;
+            if (stage == static_cast<size_t>(LatenessStage::WAKEUP)) {
+                auto missed = missedWindows_[key].load(std::memory_order_relaxed);
+                missedWindows = missed - reportedMissedWindows_[key];
+                reportedMissedWindows_[key] = missed;
+            }
+            statistic.stages.push_back(static_cast<int32_t>(stage));
+            statistic.types.push_back(static_cast<int32_t>(key / UID_BUCKET_COUNT / 2));
+            statistic.exacts.push_back(static_cast<int32_t>(key / UID_BUCKET_COUNT % 2));
+            statistic.uidBuckets.push_back(static_cast<int32_t>(key % UID_BUCKET_COUNT));
+            statistic.counts.push_back(static_cast<int64_t>(delta.count));
+            statistic.p50s.push_back(static_cast<int64_t>(delta.GetPercentile(P50)));
+            statistic.p90s.push_back(static_cast<int64_t>(delta.GetPercentile(P90)));
+            statistic.p99s.push_back(static_cast<int64_t>(delta.GetPercentile(P99)));
+            statistic.maxs.push_back(static_cast<int64_t>(delta.GetMax()));
+            statistic.missedWindows.push_back(static_cast<int64_t>(missedWindows));
+        }
+    }
+    if (!statistic.counts.empty()) {
+        TimerLatenessReporter(statistic);
+        reports_++;
+    }
+}
+
+void TimerLateness::ShowLatenessInfo(int fd)
+{
+    for (size_t stage = 0; stage < STAGE_COUNT; stage++) {
+        dprintf(fd, " * stage                   = %s\n", STAGE_NAMES[stage]);
+        for (size_t key = 0; key < KEY_COUNT; key++) {
+            auto snapshot = histograms_[stage][key].GetSnapshot();
+            if (snapshot.count == 0) {
+                continue;
+            }
+            dprintf(fd, "   * timers                = %s %s %s\n", TYPE_NAMES[key / UID_BUCKET_COUNT / 2],
+                (key / UID_BUCKET_COUNT % 2 == 1) ? "exact" : "inexact", UID_BUCKET_NAMES[key % UID_BUCKET_COUNT]);
+            dprintf(fd, "     * count               = %" PRIu64 "\n", snapshot.count);
+            dprintf(fd, "     * p50/p90/p99/max(us) = %" PRIu64 "/%" PRIu64 "/%" PRIu64 "/%" PRIu64 "\n",
+                snapshot.GetPercentile(P50), snapshot.GetPercentile(P90), snapshot.GetPercentile(P99),
+                snapshot.GetMax());
+            if (stage == static_cast<size_t>(LatenessStage::WAKEUP)) {
+                dprintf(fd, "     * missed windows      = %" PRIu64 "\n",
+                    missedWindows_[key].load(std::memory_order_relaxed));
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(reportMutex_);
+    dprintf(fd, " * statistic events        = %" PRIu64 "\n", reports_);
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -18,7 +18,12 @@
 #include "timer_manager.h"
 
 #include "time_file_utils.h"
+#include "time_task_executor.h"
+#include "json_lines_writer.h"
+#include "timer_flight_recorder.h"
+#include "timer_lateness.h"
 #include "timer_proxy.h"
+#include "timer_wakeup_stats.h"
 #include "time_tick_notify.h"
 
 #ifdef RDB_ENABLE
@@ -36,6 +41,7 @@
 #endif
 
 #ifdef POWER_MANAGER_ENABLE
+#include "running_lock_coordinator.h"
 #include "time_system_ability.h"
 #endif
 
@@ -68,7 +74,15 @@ constexpr const char* SCHEDULED_POWER_ON_APPS = "persist.time.scheduled_power_on
 constexpr int64_t TEN_YEARS_TO_SECOND = 10 * 365 * 24 * 60 * 60;
 constexpr uint64_t TWO_MINUTES_TO_MILLI = 120000;
 #endif
-constexpr std::array<const char*, 2> NO_LOG_APP_LIST = { "wifi_manager_service", "telephony" };
+constexpr const char* TIMER_TRACE_PATH = "/data/service/el1/public/database/time/timer_trace.bin";
+// 56 bytes a record, about 14 MiB
+constexpr uint64_t TIMER_TRACE_MAX_RECORDS = 1 << 18;
+// executor key and period of the MIN_WAKEUP regroup
+constexpr const char* COALESCE_TASK = "timer_coalesce";
+constexpr const char* WANT_RETRY_TASK = "want_agent_retry_";
+constexpr double SECONDS_PER_HOUR = 3600;
+// flight records of the timer attached to a fault report
+constexpr size_t FAULT_REPORT_RECORDS = 8;
 
 #ifdef RDB_ENABLE
 static const std::vector<std::string> ALL_DATA = { "timerId", "type", "flag", "windowLength", "interval", \
@@ -83,10 +97,7 @@ constexpr const char* TIMER_ACROSS_ACCOUNTS = "persist.time.timer_across_account
 #ifdef POWER_MANAGER_ENABLE
 constexpr int64_t USE_LOCK_ONE_SEC_IN_NANO = 1 * NANO_TO_SECOND;
 constexpr int64_t USE_LOCK_TIME_IN_NANO = 2 * NANO_TO_SECOND;
-constexpr int32_t NANO_TO_MILLI = 1000000;
 constexpr int64_t ONE_HUNDRED_MILLI = 100000000; // 100ms
-constexpr int POWER_RETRY_TIMES = 10;
-constexpr int POWER_RETRY_INTERVAL = 10000;
 constexpr const char* RUNNING_LOCK_DURATION_PARAMETER = "persist.time.running_lock_duration";
 static int64_t RUNNING_LOCK_DURATION = 1 * NANO_TO_SECOND;
 #endif
@@ -95,21 +106,27 @@ static int64_t RUNNING_LOCK_DURATION = 1 * NANO_TO_SECOND;
 constexpr int REASON_NATIVE_API = 0;
 constexpr int REASON_APP_API = 1;
 #endif
+
+// the boot clock of the scheduling core, virtual in a simulation
+steady_clock::time_point GetBootTime()
+{
+    return TimerPlatform::GetInstance().GetBootTime();
+}
 }
 
 std::mutex TimerManager::instanceLock_;
 TimerManager* TimerManager::instance_ = nullptr;
 
-extern bool AddBatchLocked(std::vector<std::shared_ptr<Batch>> &list, const std::shared_ptr<Batch> &batch);
-
-TimerManager::TimerManager(std::shared_ptr<TimerHandler> impl)
+TimerManager::TimerManager(std::shared_ptr<TimerHandler> impl, bool simulated)
     : random_ {static_cast<uint64_t>(time(nullptr))},
       runFlag_ {true},
+      simulated_ {simulated},
       handler_ {std::move(impl)},
       lastTimeChangeClockTime_ {system_clock::time_point::min()},
       lastTimeChangeRealtime_ {steady_clock::time_point::min()},
       lastTimerOutOfRangeTime_ {steady_clock::time_point::min()}
 {
+    coalescePolicySince_ = GetBootTime();
     alarmThread_.reset(new std::thread([this] { this->TimerLooper(); }));
     #ifdef SET_AUTO_REBOOT_ENABLE
     powerOnApps_ = TimeFileUtils::GetParameterList(SCHEDULED_POWER_ON_APPS);
@@ -224,7 +241,7 @@ int32_t TimerManager::CreateTimer(TimerPara &paras,
     auto timerName = paras.name;
     std::shared_ptr<TimerEntry> timerInfo;
     {
-        std::lock_guard<std::mutex> lock(entryMapMutex_);
+        TimerLockGuard lock(entryMapMutex_);
         while (timerId == 0) {
             // random_() needs to be protected in a lock.
             timerId = random_();
@@ -238,6 +255,7 @@ int32_t TimerManager::CreateTimer(TimerPara &paras,
         if (timerName != "") {
             AddTimerName(uid, timerName, timerId);
         }
+        RecordTrace(TimerTraceEvent::CREATE, *timerInfo, 0);
     }
     if (type == NOT_STORE) {
         return E_TIME_OK;
@@ -255,43 +273,42 @@ int32_t TimerManager::CreateTimer(TimerPara &paras,
 
 void TimerManager::ReCreateTimer(uint64_t timerId, std::shared_ptr<TimerEntry> timerInfo)
 {
-    std::lock_guard<std::mutex> lock(entryMapMutex_);
+    TimerLockGuard lock(entryMapMutex_);
     timerEntryMap_.insert(std::make_pair(timerId, timerInfo));
     if (timerInfo->name != "") {
         AddTimerName(timerInfo->uid, timerInfo->name, timerId);
     }
     IncreaseTimerCount(timerInfo->uid);
+    RecordTrace(TimerTraceEvent::CREATE, *timerInfo, 0);
 }
 
 int32_t TimerManager::StartTimer(uint64_t timerId, uint64_t triggerTime)
 {
     std::shared_ptr<TimerEntry> timerInfo;
     {
-        std::lock_guard<std::mutex> lock(entryMapMutex_);
+        TimerLockGuard lock(entryMapMutex_);
         auto it = timerEntryMap_.find(timerId);
         if (it == timerEntryMap_.end()) {
             TIME_HILOGE(TIME_MODULE_SERVICE, "id not found:%{public}" PRId64 "", timerId);
             return E_TIME_NOT_FOUND;
         }
         timerInfo = it->second;
-        if (timerId != TimeTickNotify::GetInstance().GetTickTimerId()) {
-            TIME_SIMPLIFY_HILOGI(TIME_MODULE_SERVICE, "start:%{public}" PRIu64 " typ:%{public}d "
-                "int:%{public}" PRId64 " trig:%{public}s pid:%{public}d", timerId, timerInfo->type, timerInfo->interval,
-                std::to_string(triggerTime).c_str(), IPCSkeleton::GetCallingPid());
-        }
+        TimerFlightRecorder::GetInstance().Record(FlightOp::START, timerId, static_cast<int64_t>(triggerTime),
+            IPCSkeleton::GetCallingPid(), timerInfo->uid, -1, static_cast<uint8_t>(timerInfo->type));
         {
             // To prevent the same ID from being started repeatedly,
             // the later start overwrites the earlier start.
-            std::lock_guard<std::mutex> lock(mutex_);
+            TimerLockGuard lock(mutex_);
             RemoveLocked(timerId, false);
         }
         auto alarm = TimerInfo::CreateTimerInfo(timerInfo->name, timerInfo->id, timerInfo->type, triggerTime,
             timerInfo->windowLength, timerInfo->interval, timerInfo->flag, timerInfo->autoRestore, timerInfo->callback,
             timerInfo->wantAgent, timerInfo->uid, timerInfo->pid, timerInfo->bundleName);
-        std::lock_guard<std::mutex> lockGuard(mutex_);
+        RecordTrace(TimerTraceEvent::START, *timerInfo, static_cast<int64_t>(triggerTime));
+        TimerLockGuard lockGuard(mutex_);
         SetHandlerLocked(alarm);
     }
-    if (timerInfo->wantAgent) {
+    if (timerInfo->wantAgent && !simulated_) {
         auto tableName = (CheckNeedRecoverOnReboot(timerInfo->bundleName, timerInfo->type, timerInfo->autoRestore)
             ? HOLD_ON_REBOOT
             : DROP_ON_REBOOT);
@@ -313,7 +330,7 @@ int32_t TimerManager::StartTimer(uint64_t timerId, uint64_t triggerTime)
 #ifndef RDB_ENABLE
 int32_t TimerManager::StartTimerGroup(std::vector<std::pair<uint64_t, uint64_t>> timerVec, std::string tableName)
 {
-    std::lock_guard<std::mutex> lock(entryMapMutex_);
+    TimerLockGuard lock(entryMapMutex_);
     for (auto iter = timerVec.begin(); iter != timerVec.end(); ++iter) {
         uint64_t timerId = iter->first;
         uint64_t triggerTime = iter->second;
@@ -324,19 +341,19 @@ int32_t TimerManager::StartTimerGroup(std::vector<std::pair<uint64_t, uint64_t>>
             continue;
         }
         timerInfo = it->second;
-        TIME_SIMPLIFY_HILOGI(TIME_MODULE_SERVICE, "start:%{public}" PRIu64 " typ:%{public}d "
-            "int:%{public}" PRId64 " trig:%{public}s pid:%{public}d", timerId, timerInfo->type, timerInfo->interval,
-            std::to_string(triggerTime).c_str(), IPCSkeleton::GetCallingPid());
+        TimerFlightRecorder::GetInstance().Record(FlightOp::START, timerId, static_cast<int64_t>(triggerTime),
+            IPCSkeleton::GetCallingPid(), timerInfo->uid, -1, static_cast<uint8_t>(timerInfo->type));
         {
             // To prevent the same ID from being started repeatedly,
             // the later start overwrites the earlier start
-            std::lock_guard<std::mutex> lock(mutex_);
+            TimerLockGuard lock(mutex_);
             RemoveLocked(timerId, false);
         }
         auto alarm = TimerInfo::CreateTimerInfo(timerInfo->name, timerInfo->id, timerInfo->type, triggerTime,
             timerInfo->windowLength, timerInfo->interval, timerInfo->flag, timerInfo->autoRestore, timerInfo->callback,
             timerInfo->wantAgent, timerInfo->uid, timerInfo->pid, timerInfo->bundleName);
-        std::lock_guard<std::mutex> lockGuard(mutex_);
+        RecordTrace(TimerTraceEvent::START, *timerInfo, static_cast<int64_t>(triggerTime));
+        TimerLockGuard lockGuard(mutex_);
         SetHandlerLocked(alarm);
     }
     CjsonHelper::GetInstance().UpdateTriggerGroup(tableName, timerVec);
@@ -373,7 +390,10 @@ void TimerManager::DecreaseTimerCount(int uid)
 
 void TimerManager::CheckTimerCount()
 {
-    steady_clock::time_point bootTimePoint = TimeUtils::GetBootTimeNs();
+    if (simulated_) {
+        return;
+    }
+    steady_clock::time_point bootTimePoint = GetBootTime();
     int count = static_cast<int>(timerEntryMap_.size());
     if (count > (timerOutOfRangeTimes_ + 1) * TIMER_ALARM_COUNT) {
         timerOutOfRangeTimes_ += 1;
@@ -430,15 +450,11 @@ int32_t TimerManager::DestroyTimer(uint64_t timerId)
 
 int32_t TimerManager::StopTimerInner(uint64_t timerNumber, bool needDestroy)
 {
-    if (needDestroy) {
-        TIME_SIMPLIFY_HILOGI(TIME_MODULE_SERVICE, "drop:%{public}" PRId64 "", timerNumber);
-    } else {
-        TIME_SIMPLIFY_HILOGI(TIME_MODULE_SERVICE, "stop:%{public}" PRId64 "", timerNumber);
-    }
+    TimerFlightRecorder::GetInstance().Record(needDestroy ? FlightOp::DESTROY : FlightOp::STOP, timerNumber);
     int32_t ret;
     bool needRecover = false;
     {
-        std::lock_guard<std::mutex> lock(entryMapMutex_);
+        TimerLockGuard lock(entryMapMutex_);
         ret = StopTimerInnerLocked(needDestroy, timerNumber, needRecover);
     }
     UpdateOrDeleteDatabase(needDestroy, timerNumber, needRecover);
@@ -453,8 +469,9 @@ int32_t TimerManager::StopTimerInnerLocked(bool needDestroy, uint64_t timerNumbe
         TIME_HILOGW(TIME_MODULE_SERVICE, "timer not exist");
         return E_TIME_NOT_FOUND;
     }
+    RecordTrace(needDestroy ? TimerTraceEvent::DESTROY : TimerTraceEvent::STOP, *it->second, 0);
     RemoveHandler(timerNumber);
-    TimerProxy::GetInstance().EraseTimerFromProxyTimerMap(timerNumber, it->second->uid, it->second->pid);
+    TimerProxy::GetInstance().EraseTimerFromProxyTimerMap(timerNumber);
     needRecover = CheckNeedRecoverOnReboot(it->second->bundleName, it->second->type, it->second->autoRestore);
     if (needDestroy) {
         auto uid = it->second->uid;
@@ -470,6 +487,9 @@ int32_t TimerManager::StopTimerInnerLocked(bool needDestroy, uint64_t timerNumbe
 
 void TimerManager::UpdateOrDeleteDatabase(bool needDestroy, uint64_t timerNumber, bool needRecover)
 {
+    if (simulated_) {
+        return;
+    }
     auto tableName = (needRecover ? HOLD_ON_REBOOT : DROP_ON_REBOOT);
     if (needDestroy) {
         #ifdef RDB_ENABLE
@@ -495,7 +515,11 @@ void TimerManager::UpdateOrDeleteDatabase(bool needDestroy, uint64_t timerNumber
 void TimerManager::SetHandlerLocked(std::shared_ptr<TimerInfo> alarm)
 {
     TIME_HILOGD(TIME_MODULE_SERVICE, "start id:%{public}" PRId64 "", alarm->id);
-    auto bootTimePoint = TimeUtils::GetBootTimeNs();
+    if (!TimerProxy::GetInstance().IsUidOrPidProxy(alarm->uid, alarm->pid)) {
+        SetHandlerLocked(alarm, false, false);
+        return;
+    }
+    auto bootTimePoint = GetBootTime();
     if (TimerProxy::GetInstance().IsProxy(alarm->uid, 0)) {
         TIME_HILOGI(TIME_MODULE_SERVICE, "Timer already proxy, uid=%{public}d id=%{public}" PRId64 "",
             alarm->uid, alarm->id);
@@ -515,52 +539,25 @@ void TimerManager::SetHandlerLocked(std::shared_ptr<TimerInfo> alarm)
 
 void TimerManager::RemoveHandler(uint64_t id)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TimerLockGuard lock(mutex_);
     RemoveLocked(id, true);
     TimerProxy::GetInstance().RemoveUidTimerMap(id);
+    TimerProxy::GetInstance().EraseAdjustTimer(id);
 }
 
 // needs to acquire the lock `mutex_` before calling this method
 void TimerManager::RemoveLocked(uint64_t id, bool needReschedule)
 {
-    auto whichAlarms = [id](const TimerInfo &timer) {
-        return timer.id == id;
-    };
-    bool didRemove = false;
-    for (auto it = alarmBatches_.begin(); it != alarmBatches_.end();) {
-        auto batch = *it;
-        didRemove = batch->Remove(whichAlarms);
-        if (didRemove) {
-            TIME_SIMPLIFY_HILOGI(TIME_MODULE_SERVICE, "remove:%{public}" PRIu64 "", id);
-            it = alarmBatches_.erase(it);
-            if (batch->Size() != 0) {
-                AddBatchLocked(alarmBatches_, batch);
-            }
-            break;
-        }
-        ++it;
+    bool didRemove = TimerScheduler::Remove(alarmBatches_, id);
+    if (didRemove) {
+        TimerFlightRecorder::GetInstance().Record(FlightOp::REMOVE, id);
+        adjustableTimers_.erase(id);
     }
     pendingDelayTimers_.erase(remove_if(pendingDelayTimers_.begin(), pendingDelayTimers_.end(),
         [id](const std::shared_ptr<TimerInfo> &timer) { return timer->id == id; }), pendingDelayTimers_.end());
     delayedTimers_.erase(id);
     if (mPendingIdleUntil_ != nullptr && id == mPendingIdleUntil_->id) {
-        TIME_HILOGI(TIME_MODULE_SERVICE, "Idle alarm removed");
-        mPendingIdleUntil_ = nullptr;
-        bool isAdjust = AdjustTimersBasedOnDeviceIdle();
-        delayedTimers_.clear();
-        for (const auto &pendingTimer : pendingDelayTimers_) {
-            TIME_HILOGI(TIME_MODULE_SERVICE, "Set timer from delay list, id=%{public}" PRId64 "", pendingTimer->id);
-            auto bootTimePoint = TimeUtils::GetBootTimeNs();
-            if (pendingTimer->whenElapsed <= bootTimePoint) {
-                // 2 means the time of performing task.
-                pendingTimer->UpdateWhenElapsedFromNow(bootTimePoint, milliseconds(2));
-            } else {
-                pendingTimer->UpdateWhenElapsedFromNow(bootTimePoint, pendingTimer->offset);
-            }
-            SetHandlerLocked(pendingTimer, false, false);
-        }
-        pendingDelayTimers_.clear();
-        if (isAdjust) {
+        if (ExitIdleLocked()) {
             ReBatchAllTimers();
             return;
         }
@@ -573,6 +570,86 @@ void TimerManager::RemoveLocked(uint64_t id, bool needReschedule)
     #endif
 }
 
+// needs to acquire the lock `mutex_` before calling this method
+// Removes all `ids` in one pass over the batches, the caller is responsible for the kernel reschedule.
+void TimerManager::RemoveTimersLocked(const std::unordered_set<uint64_t> &ids)
+{
+    RemoveFromBatchesLocked(ids);
+    pendingDelayTimers_.erase(remove_if(pendingDelayTimers_.begin(), pendingDelayTimers_.end(),
+        [&ids](const std::shared_ptr<TimerInfo> &timer) { return ids.find(timer->id) != ids.end(); }),
+        pendingDelayTimers_.end());
+    for (auto id : ids) {
+        delayedTimers_.erase(id);
+        #ifdef SET_AUTO_REBOOT_ENABLE
+        DeleteTimerFromPowerOnTimerListById(id);
+        #endif
+    }
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+// Takes `ids` out of the batches only, the batches left non-empty are re-added in order.
+void TimerManager::RemoveFromBatchesLocked(const std::unordered_set<uint64_t> &ids)
+{
+    TimerScheduler::RemoveAll(alarmBatches_, ids);
+    for (auto id : ids) {
+        adjustableTimers_.erase(id);
+    }
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+void TimerManager::RecordAdjustableTimerLocked(const std::shared_ptr<TimerInfo> &timer)
+{
+    // an adjusted timer stays indexed after becoming exempt so that it can still be restored;
+    // proxied and overdue timers are never adjusted, they are indexed again when reinserted
+    if (timer->state == TimerInfo::ADJUST || (timer->state != TimerInfo::PROXY
+        && timer->originWhenElapsed >= GetBootTime()
+        && !TimerProxy::GetInstance().IsUidOrPidProxy(timer->uid, timer->pid)
+        && !TimerProxy::GetInstance().IsTimerExemption(timer))) {
+        adjustableTimers_[timer->id] = timer;
+    } else {
+        adjustableTimers_.erase(timer->id);
+    }
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+void TimerManager::RebuildAdjustableTimersLocked()
+{
+    adjustableTimers_.clear();
+    for (const auto &batch : alarmBatches_) {
+        auto n = batch->Size();
+        for (unsigned int i = 0; i < n; i++) {
+            RecordAdjustableTimerLocked(batch->Get(i));
+        }
+    }
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+// Returns true if the delayed timers were adjusted and all batches have to be rebuilt.
+bool TimerManager::ExitIdleLocked()
+{
+    TIME_HILOGI(TIME_MODULE_SERVICE, "Idle alarm removed");
+    TimerTraceRecord record;
+    record.event = TimerTraceEvent::IDLE;
+    record.id = mPendingIdleUntil_ != nullptr ? mPendingIdleUntil_->id : 0;
+    WriteTrace(record);
+    mPendingIdleUntil_ = nullptr;
+    bool isAdjust = AdjustTimersBasedOnDeviceIdle();
+    delayedTimers_.clear();
+    for (const auto &pendingTimer : pendingDelayTimers_) {
+        TIME_HILOGI(TIME_MODULE_SERVICE, "Set timer from delay list, id=%{public}" PRId64 "", pendingTimer->id);
+        auto bootTimePoint = GetBootTime();
+        if (pendingTimer->whenElapsed <= bootTimePoint) {
+            // 2 means the time of performing task.
+            pendingTimer->UpdateWhenElapsedFromNow(bootTimePoint, milliseconds(2));
+        } else {
+            pendingTimer->UpdateWhenElapsedFromNow(bootTimePoint, pendingTimer->offset);
+        }
+        SetHandlerLocked(pendingTimer, false, false);
+    }
+    pendingDelayTimers_.clear();
+    return isAdjust;
+}
+
 // needs to acquire the lock `mutex_` before calling this method
 void TimerManager::SetHandlerLocked(std::shared_ptr<TimerInfo> alarm, bool rebatching, bool isRebatched)
 {
@@ -582,7 +659,7 @@ void TimerManager::SetHandlerLocked(std::shared_ptr<TimerInfo> alarm, bool rebat
     if (!isRebatched && mPendingIdleUntil_ != nullptr && !CheckAllowWhileIdle(alarm)) {
         TIME_HILOGI(TIME_MODULE_SERVICE, "Pending not-allowed alarm in idle state, id=%{public}" PRId64 "",
             alarm->id);
-        alarm->offset = duration_cast<milliseconds>(alarm->whenElapsed - TimeUtils::GetBootTimeNs());
+        alarm->offset = duration_cast<milliseconds>(alarm->whenElapsed - GetBootTime());
         pendingDelayTimers_.push_back(alarm);
         return;
     }
@@ -592,6 +669,11 @@ void TimerManager::SetHandlerLocked(std::shared_ptr<TimerInfo> alarm, bool rebat
     bool isAdjust = false;
     if (!isRebatched && alarm->flags & static_cast<uint32_t>(IDLE_UNTIL)) {
         TIME_HILOGI(TIME_MODULE_SERVICE, "Set idle timer, id=%{public}" PRId64 "", alarm->id);
+        TimerTraceRecord record;
+        record.event = TimerTraceEvent::IDLE;
+        record.id = alarm->id;
+        record.flags = 1;
+        WriteTrace(record);
         mPendingIdleUntil_ = alarm;
         isAdjust = AdjustTimersBasedOnDeviceIdle();
     }
@@ -624,13 +706,17 @@ void TimerManager::ReBatchAllTimers()
 {
     auto oldSet = alarmBatches_;
     alarmBatches_.clear();
-    auto nowElapsed = TimeUtils::GetBootTimeNs();
+    adjustableTimers_.clear();
+    auto nowElapsed = GetBootTime();
     for (const auto &batch : oldSet) {
         auto n = batch->Size();
         for (unsigned int i = 0; i < n; i++) {
             ReAddTimerLocked(batch->Get(i), nowElapsed);
         }
     }
+    if (coalescePolicy_ == CoalescePolicy::MIN_WAKEUP) {
+        CoalesceLocked();
+    }
     RescheduleKernelTimerLocked();
 }
 
@@ -652,15 +738,16 @@ void TimerManager::TimerLooper()
     std::vector<std::shared_ptr<TimerInfo>> triggerList;
     while (runFlag_) {
         uint32_t result = handler_->WaitForAlarm();
-        auto nowRtc = std::chrono::system_clock::now();
-        auto nowElapsed = TimeUtils::GetBootTimeNs();
+        auto nowRtc = system_clock::time_point(
+            duration_cast<system_clock::duration>(TimerPlatform::GetInstance().GetWallTime()));
+        auto nowElapsed = GetBootTime();
         triggerList.clear();
 
         if ((result & TIME_CHANGED_MASK) != 0) {
             TIME_HILOGI(TIME_MODULE_SERVICE, "ret:%{public}u", result);
             system_clock::time_point lastTimeChangeClockTime;
             system_clock::time_point expectedClockTime;
-            std::lock_guard<std::mutex> lock(mutex_);
+            TimerLockGuard lock(mutex_);
             lastTimeChangeClockTime = lastTimeChangeClockTime_;
             expectedClockTime = lastTimeChangeClockTime +
                 (duration_cast<milliseconds>(nowElapsed.time_since_epoch()) -
@@ -668,6 +755,10 @@ void TimerManager::TimerLooper()
             if (lastTimeChangeClockTime == system_clock::time_point::min()
                 || nowRtc < expectedClockTime
                 || nowRtc > (expectedClockTime + milliseconds(ONE_THOUSAND))) {
+                TimerTraceRecord record;
+                record.event = TimerTraceEvent::TIME_CHANGE;
+                record.when = duration_cast<nanoseconds>(nowRtc.time_since_epoch()).count();
+                WriteTrace(record);
                 ReBatchAllTimers();
                 lastTimeChangeClockTime_ = nowRtc;
                 lastTimeChangeRealtime_ = nowElapsed;
@@ -676,39 +767,206 @@ void TimerManager::TimerLooper()
 
         if (result != TIME_CHANGED_MASK) {
             {
-                std::lock_guard<std::mutex> lock(mutex_);
-                TriggerTimersLocked(triggerList, nowElapsed);
+                TimerLockGuard lock(mutex_);
+                TriggerTimersLocked(triggerList, nowElapsed, result);
+            }
+            auto collected = GetBootTime();
+            for (const auto &timer : triggerList) {
+                TimerLateness::GetInstance().Record(LatenessStage::COLLECT, *timer, collected - nowElapsed);
             }
             // in this function, timeservice apply a runninglock from powermanager
             // release mutex to prevent powermanager from using the interface of timeservice
             // which may cause deadlock
-            DeliverTimersLocked(triggerList);
+            DeliverTimersLocked(triggerList, collected);
             {
-                std::lock_guard<std::mutex> lock(mutex_);
+                TimerLockGuard lock(mutex_);
                 RescheduleKernelTimerLocked();
             }
         }
     }
 }
 
+std::unique_ptr<TimerManager> TimerManager::CreateSimulated(const std::shared_ptr<VirtualTimerClock> &clock)
+{
+    auto impl = TimerHandler::CreateVirtual(clock);
+    if (impl == nullptr) {
+        return nullptr;
+    }
+    TimerPlatform::SetInstance(clock.get());
+    return std::unique_ptr<TimerManager>(new TimerManager(impl, true));
+}
+
 TimerManager::~TimerManager()
 {
     if (alarmThread_ && alarmThread_->joinable()) {
         runFlag_ = false;
+        handler_->Stop();
         alarmThread_->join();
     }
+    if (simulated_) {
+        // the handler owns the clock, which goes with it
+        TimerPlatform::SetInstance(nullptr);
+    }
+}
+
+bool TimerManager::StartTrace()
+{
+    TimerLockGuard entryLock(entryMapMutex_);
+    TimerLockGuard lock(mutex_);
+    if (!traceWriter_.Open(TIMER_TRACE_PATH, duration_cast<nanoseconds>(GetBootTime().time_since_epoch()).count(),
+        TimerPlatform::GetInstance().GetWallTime().count(), TIMER_TRACE_MAX_RECORDS)) {
+        return false;
+    }
+    tracing_ = true;
+    // the trace starts with the current state, so that a replay does not miss the timers set before
+    for (const auto &entry : timerEntryMap_) {
+        RecordTrace(TimerTraceEvent::CREATE, *entry.second, 0);
+    }
+    if (adjustPolicy_) {
+        TimerTraceRecord record;
+        record.event = TimerTraceEvent::ADJUST;
+        record.when = adjustInterval_;
+        record.interval = adjustDelta_;
+        record.flags = 1;
+        WriteTrace(record);
+    }
+    auto recordStart = [this](const std::shared_ptr<TimerInfo> &timer) {
+        auto it = timerEntryMap_.find(timer->id);
+        if (it != timerEntryMap_.end()) {
+            RecordTrace(TimerTraceEvent::START, *it->second, timer->origWhen.count());
+        }
+    };
+    for (const auto &batch : alarmBatches_) {
+        for (unsigned int i = 0; i < batch->Size(); i++) {
+            recordStart(batch->Get(i));
+        }
+    }
+    for (const auto &timer : pendingDelayTimers_) {
+        recordStart(timer);
+    }
+    TIME_HILOGI(TIME_MODULE_SERVICE, "timer trace started, timers:%{public}zu", timerEntryMap_.size());
+    return true;
+}
+
+uint64_t TimerManager::StopTrace()
+{
+    tracing_ = false;
+    auto records = traceWriter_.Close();
+    TIME_HILOGI(TIME_MODULE_SERVICE, "timer trace stopped, records:%{public}" PRIu64 "", records);
+    return records;
+}
+
+void TimerManager::SetCoalescePolicy(CoalescePolicy policy)
+{
+    {
+        TimerLockGuard lock(mutex_);
+        if (policy == coalescePolicy_) {
+            return;
+        }
+        auto now = GetBootTime();
+        coalesceStats_[static_cast<size_t>(coalescePolicy_)].activeTime += now - coalescePolicySince_;
+        coalescePolicySince_ = now;
+        coalescePolicy_ = policy;
+        TIME_HILOGI(TIME_MODULE_SERVICE, "coalesce policy:%{public}s", TimerScheduler::GetPolicyName(policy));
+        if (policy != CoalescePolicy::MIN_WAKEUP) {
+            return;
+        }
+        CoalesceLocked();
+        RescheduleKernelTimerLocked();
+    }
+    ScheduleCoalesce();
+}
+
+void TimerManager::Coalesce()
+{
+    TimerLockGuard lock(mutex_);
+    if (coalescePolicy_ != CoalescePolicy::MIN_WAKEUP) {
+        return;
+    }
+    CoalesceLocked();
+    RescheduleKernelTimerLocked();
+}
+
+// needs to acquire the lock `mutex_` before calling this method
+void TimerManager::CoalesceLocked()
+{
+    auto before = TimerScheduler::CountWakeupBatches(alarmBatches_);
+    alarmBatches_ = TimerScheduler::Coalesce(alarmBatches_);
+    auto after = TimerScheduler::CountWakeupBatches(alarmBatches_);
+    coalesceRuns_++;
+    if (before > after) {
+        coalesceSavedBatches_ += before - after;
+    }
+}
+
+// Best fit placement drifts away from the fewest wakeups as timers come and go, the batches are regrouped
+// periodically while MIN_WAKEUP is in use.
+void TimerManager::ScheduleCoalesce()
+{
+    // the executor runs on real time, a simulation is coalesced by its driver
+    if (simulated_) {
+        return;
+    }
+    auto coalesce = [this]() {
+        {
+            TimerLockGuard lock(mutex_);
+            if (coalescePolicy_ != CoalescePolicy::MIN_WAKEUP) {
+                return;
+            }
+            CoalesceLocked();
+            RescheduleKernelTimerLocked();
+        }
+        ScheduleCoalesce();
+    };
+    // periodic, so a full executor queue can not end the chain; a coalesced post leaves the pending task running it
+    TimeTaskExecutor::GetInstance().PostPeriodic(COALESCE_TASK, coalesce, COALESCE_INTERVAL);
+}
+
+void TimerManager::RecordTrace(TimerTraceEvent event, const TimerEntry &entry, int64_t when)
+{
+    if (!tracing_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    TimerTraceRecord record;
+    record.event = event;
+    record.id = entry.id;
+    record.when = when;
+    record.window = entry.windowLength;
+    record.interval = entry.interval;
+    record.nameHash = TimerTrace::HashName(entry.name);
+    record.uid = entry.uid;
+    record.pid = entry.pid;
+    record.type = static_cast<uint8_t>(entry.type);
+    record.flags = static_cast<uint8_t>(entry.flag);
+    WriteTrace(record);
+}
+
+void TimerManager::WriteTrace(TimerTraceRecord &record)
+{
+    if (!tracing_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    record.bootTime = duration_cast<nanoseconds>(GetBootTime().time_since_epoch()).count();
+    if (!traceWriter_.Write(record)) {
+        // full or failed, the writer has closed the trace
+        tracing_ = false;
+    }
 }
 
 // needs to acquire the lock `mutex_` before calling this method
 void TimerManager::TriggerIdleTimer()
 {
     TIME_HILOGI(TIME_MODULE_SERVICE, "Idle alarm triggers");
+    TimerTraceRecord record;
+    record.event = TimerTraceEvent::IDLE;
+    record.id = mPendingIdleUntil_ != nullptr ? mPendingIdleUntil_->id : 0;
+    WriteTrace(record);
     mPendingIdleUntil_ = nullptr;
     delayedTimers_.clear();
     std::for_each(pendingDelayTimers_.begin(), pendingDelayTimers_.end(),
         [this](const std::shared_ptr<TimerInfo> &pendingTimer) {
             TIME_HILOGI(TIME_MODULE_SERVICE, "Set timer from delay list, id=%{public}" PRId64 "", pendingTimer->id);
-            auto bootTimePoint = TimeUtils::GetBootTimeNs();
+            auto bootTimePoint = GetBootTime();
             if (pendingTimer->whenElapsed > bootTimePoint) {
                 pendingTimer->UpdateWhenElapsedFromNow(bootTimePoint, pendingTimer->offset);
             } else {
@@ -728,8 +986,7 @@ bool TimerManager::ProcTriggerTimer(std::shared_ptr<TimerInfo> &alarm,
     if (mPendingIdleUntil_ != nullptr && mPendingIdleUntil_->id == alarm->id) {
         TriggerIdleTimer();
     }
-    if (TimerProxy::GetInstance().IsProxy(alarm->uid, 0)
-        || TimerProxy::GetInstance().IsProxy(alarm->uid, alarm->pid)) {
+    if (TimerProxy::GetInstance().IsUidOrPidProxy(alarm->uid, alarm->pid)) {
         alarm->ProxyTimer(nowElapsed, milliseconds(TimerProxy::GetInstance().GetProxyDelayTime()));
         SetHandlerLocked(alarm, false, false);
         return false;
@@ -742,54 +999,51 @@ bool TimerManager::ProcTriggerTimer(std::shared_ptr<TimerInfo> &alarm,
     }
 }
 
-bool IsNoLog(std::shared_ptr<TimerInfo> alarm)
-{
-    return (std::find(NO_LOG_APP_LIST.begin(), NO_LOG_APP_LIST.end(), alarm->bundleName) != NO_LOG_APP_LIST.end())
-        && (alarm->repeatInterval != std::chrono::milliseconds(0))
-        && (!alarm->wakeup);
-}
-
 // needs to acquire the lock `mutex_` before calling this method
 bool TimerManager::TriggerTimersLocked(std::vector<std::shared_ptr<TimerInfo>> &triggerList,
-                                       std::chrono::steady_clock::time_point nowElapsed)
+                                       std::chrono::steady_clock::time_point nowElapsed, uint32_t fired)
 {
     bool hasWakeup = false;
-    int64_t bootTime = 0;
-    TimeUtils::GetBootTimeNs(bootTime);
-    TIME_HILOGD(TIME_MODULE_SERVICE, "current time %{public}" PRId64 "", bootTime);
-
-    for (auto iter = alarmBatches_.begin(); iter != alarmBatches_.end();) {
-        if (*iter == nullptr) {
-            TIME_HILOGE(TIME_MODULE_SERVICE, "alarmBatches_ has nullptr");
-            iter = alarmBatches_.erase(iter);
-            continue;
-        }
-        if ((*iter)->GetStart() > nowElapsed) {
-            ++iter;
-            continue;
-        }
-        auto batch = *iter;
-        iter = alarmBatches_.erase(iter);
+    TIME_HILOGD(TIME_MODULE_SERVICE, "current time %{public}lld", nowElapsed.time_since_epoch().count());
+
+    auto &coalesceStats = coalesceStats_[static_cast<size_t>(coalescePolicy_)];
+    for (const auto &batch : TimerScheduler::TakeDueBatches(alarmBatches_, nowElapsed)) {
         TIME_HILOGD(
             TIME_MODULE_SERVICE, "batch size= %{public}d", static_cast<int>(alarmBatches_.size()));
+        coalesceStats.batches++;
+        if (batch->HasWakeups()) {
+            coalesceStats.wakeupBatches++;
+        }
         const auto n = batch->Size();
         for (unsigned int i = 0; i < n; ++i) {
             auto alarm = batch->Get(i);
+            adjustableTimers_.erase(alarm->id);
             triggerList.push_back(alarm);
-            if (!IsNoLog(alarm) && alarm->id != TimeTickNotify::GetInstance().GetTickTimerId()) {
-                TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "uid:%{public}d id:%{public}" PRId64 " wk:%{public}u",
-                    alarm->uid, alarm->id, alarm->wakeup);
-            }
+            TimerFlightRecorder::GetInstance().Record(FlightOp::TRIGGER, alarm->id,
+                std::chrono::duration_cast<std::chrono::milliseconds>(alarm->whenElapsed.time_since_epoch()).count(),
+                0, alarm->uid, -1, alarm->wakeup ? 1 : 0);
             if (alarm->wakeup) {
                 hasWakeup = true;
             }
         }
     }
+    if (hasWakeup) {
+        coalesceStats.wakeups++;
+    }
+    // charged before the repeating timers are set for their next round
+    TimerWakeupStats::GetInstance().RecordWakeup(fired, triggerList);
     for (auto iter = triggerList.begin(); iter != triggerList.end();) {
         auto alarm = *iter;
+        // a repeating timer is set for its next round while it is processed
+        auto wakeupLateness = nowElapsed - alarm->whenElapsed;
+        bool missedWindow = nowElapsed > alarm->maxWhenElapsed;
         if (!ProcTriggerTimer(alarm, nowElapsed)) {
             iter = triggerList.erase(iter);
         } else {
+            TimerLateness::GetInstance().Record(LatenessStage::WAKEUP, *alarm, wakeupLateness);
+            if (missedWindow) {
+                TimerLateness::GetInstance().RecordMissedWindow(*alarm);
+            }
             ++iter;
         }
     }
@@ -805,24 +1059,25 @@ bool TimerManager::TriggerTimersLocked(std::vector<std::shared_ptr<TimerInfo>> &
 // needs to acquire the lock `mutex_` before calling this method
 void TimerManager::RescheduleKernelTimerLocked()
 {
-    auto bootTime = TimeUtils::GetBootTimeNs();
+    auto bootTime = GetBootTime();
     if (!alarmBatches_.empty()) {
-        auto firstWakeup = FindFirstWakeupBatchLocked();
+        auto firstWakeup = TimerScheduler::FindFirstWakeupBatch(alarmBatches_);
         auto firstBatch = alarmBatches_.front();
         if (firstWakeup != nullptr) {
             #ifdef POWER_MANAGER_ENABLE
-            HandleRunningLock(firstWakeup);
+            if (!simulated_) {
+                HandleRunningLock(firstWakeup);
+            }
             #endif
             auto setTimePoint = firstWakeup->GetStart().time_since_epoch();
-            if (setTimePoint < bootTime.time_since_epoch() ||
-                setTimePoint.count() != lastSetTime_[ELAPSED_REALTIME_WAKEUP]) {
+            if (TimerScheduler::NeedReprogram(setTimePoint, bootTime, lastSetTime_[ELAPSED_REALTIME_WAKEUP])) {
                 SetLocked(ELAPSED_REALTIME_WAKEUP, setTimePoint, bootTime);
                 lastSetTime_[ELAPSED_REALTIME_WAKEUP] = setTimePoint.count();
             }
         }
         if (firstBatch != firstWakeup) {
             auto setTimePoint = firstBatch->GetStart().time_since_epoch();
-            if (setTimePoint < bootTime.time_since_epoch() || setTimePoint.count() != lastSetTime_[ELAPSED_REALTIME]) {
+            if (TimerScheduler::NeedReprogram(setTimePoint, bootTime, lastSetTime_[ELAPSED_REALTIME])) {
                 SetLocked(ELAPSED_REALTIME, setTimePoint, bootTime);
                 lastSetTime_[ELAPSED_REALTIME] = setTimePoint.count();
             }
@@ -856,7 +1111,7 @@ void TimerManager::DeleteTimerFromPowerOnTimerListById(uint64_t timerId)
 
 void TimerManager::ReschedulePowerOnTimerLocked(bool isShutDown)
 {
-    auto bootTime = TimeUtils::GetBootTimeNs();
+    auto bootTime = GetBootTime();
     int64_t currentTime = 0;
     if (TimeUtils::GetWallTimeMs(currentTime) != ERR_OK) {
         TIME_HILOGE(TIME_MODULE_SERVICE, "currentTime get failed");
@@ -902,32 +1157,19 @@ void TimerManager::ReschedulePowerOnTimerLocked(bool isShutDown)
 
 void TimerManager::ShutDownReschedulePowerOnTimer()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TimerLockGuard lock(mutex_);
     ReschedulePowerOnTimerLocked(true);
 }
 #endif
 
-// needs to acquire the lock `mutex_` before calling this method
-std::shared_ptr<Batch> TimerManager::FindFirstWakeupBatchLocked()
-{
-    auto it = std::find_if(alarmBatches_.begin(),
-                           alarmBatches_.end(),
-                           [](const std::shared_ptr<Batch> &batch) {
-                               return batch->HasWakeups();
-                           });
-    return (it != alarmBatches_.end()) ? *it : nullptr;
-}
-
 void TimerManager::SetLocked(int type, std::chrono::nanoseconds when, std::chrono::steady_clock::time_point bootTime)
 {
     #ifdef SET_AUTO_REBOOT_ENABLE
-    if (type != POWER_ON_ALARM && when.count() <= 0) {
-        when = bootTime.time_since_epoch();
+    if (type != POWER_ON_ALARM) {
+        when = TimerScheduler::ClampDeadline(when, bootTime);
     }
     #else
-    if (when.count() <= 0) {
-        when = bootTime.time_since_epoch();
-    }
+    when = TimerScheduler::ClampDeadline(when, bootTime);
     #endif
     handler_->Set(static_cast<uint32_t>(type), when, bootTime);
 }
@@ -935,71 +1177,38 @@ void TimerManager::SetLocked(int type, std::chrono::nanoseconds when, std::chron
 // needs to acquire the lock `mutex_` before calling this method
 void TimerManager::InsertAndBatchTimerLocked(std::shared_ptr<TimerInfo> alarm)
 {
-    int64_t whichBatch = (alarm->flags & static_cast<uint32_t>(STANDALONE)) ?
-        -1 :
-        AttemptCoalesceLocked(alarm->whenElapsed, alarm->maxWhenElapsed);
-    if (!IsNoLog(alarm)) {
-        auto whenElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
-            alarm->whenElapsed.time_since_epoch()).count();
-        auto maxWhenElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
-            alarm->maxWhenElapsed.time_since_epoch()).count();
-        if (whenElapsedMs != maxWhenElapsedMs) {
-            if (whichBatch == -1) {
-                TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "id:%{public}" PRIu64 " we:%{public}lld mwe:%{public}lld",
-                    alarm->id, whenElapsedMs, maxWhenElapsedMs);
-            } else {
-                TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "bat:%{public}" PRId64 " id:%{public}" PRIu64 " "
-                    "we:%{public}lld mwe:%{public}lld", whichBatch, alarm->id, whenElapsedMs, maxWhenElapsedMs);
-            }
-        } else {
-            if (whichBatch == -1) {
-                TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "id:%{public}" PRIu64 " we:%{public}lld",
-                    alarm->id, whenElapsedMs);
-            } else {
-                TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "bat:%{public}" PRId64 " id:%{public}" PRIu64 " "
-                    "we:%{public}lld", whichBatch, alarm->id, whenElapsedMs);
-            }
-        }
-    }
-    if (whichBatch < 0) {
-        AddBatchLocked(alarmBatches_, std::make_shared<Batch>(*alarm));
-    } else {
-        auto batch = alarmBatches_.at(whichBatch);
-        if (batch->Add(alarm)) {
-            alarmBatches_.erase(alarmBatches_.begin() + whichBatch);
-            AddBatchLocked(alarmBatches_, batch);
-        }
-    }
+    RecordAdjustableTimerLocked(alarm);
+    int64_t whichBatch = TimerScheduler::InsertAndBatch(alarmBatches_, alarm, coalescePolicy_);
+    auto whenElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        alarm->whenElapsed.time_since_epoch()).count();
+    auto windowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        alarm->maxWhenElapsed - alarm->whenElapsed).count();
+    TimerFlightRecorder::GetInstance().Record(FlightOp::BATCH, alarm->id, whenElapsedMs,
+        static_cast<int32_t>(std::min<int64_t>(windowMs, INT32_MAX)), alarm->uid, whichBatch);
 }
 
-// needs to acquire the lock `mutex_` before calling this method
-int64_t TimerManager::AttemptCoalesceLocked(std::chrono::steady_clock::time_point whenElapsed,
-                                            std::chrono::steady_clock::time_point maxWhen)
+void TimerManager::NotifyWantAgentRetry(std::shared_ptr<TimerInfo> timer, int retryTimes)
 {
-    auto it = std::find_if(alarmBatches_.begin(), alarmBatches_.end(),
-        [whenElapsed, maxWhen](const std::shared_ptr<Batch> &batch) {
-            return (batch->GetFlags() & static_cast<uint32_t>(STANDALONE)) == 0 &&
-                   (batch->CanHold(whenElapsed, maxWhen));
-        });
-    if (it != alarmBatches_.end()) {
-        return std::distance(alarmBatches_.begin(), it);
+    if (retryTimes >= WANT_RETRY_TIMES) {
+        return;
     }
-    return -1;
-}
-
-void TimerManager::NotifyWantAgentRetry(std::shared_ptr<TimerInfo> timer)
-{
-    auto retryRegister = [timer]() {
-        for (int i = 0; i < WANT_RETRY_TIMES; i++) {
-            sleep(WANT_RETRY_INTERVAL << i);
-            if (TimerManager::GetInstance()->NotifyWantAgent(timer)) {
-                return;
-            }
-            TIME_HILOGI(TIME_MODULE_SERVICE, "retry trigWA:times:%{public}d id=%{public}" PRId64 "", i, timer->id);
+    // each retry is a delayed task of its own, no executor thread sleeps through the backoff
+    auto retryRegister = [timer, retryTimes]() {
+        if (TimerManager::GetInstance()->NotifyWantAgent(timer)) {
+            return;
         }
+        TIME_HILOGI(TIME_MODULE_SERVICE, "retry trigWA:times:%{public}d id=%{public}" PRId64 "", retryTimes,
+            timer->id);
+        TimerManager::GetInstance()->NotifyWantAgentRetry(timer, retryTimes + 1);
     };
-    std::thread thread(retryRegister);
-    thread.detach();
+    // keyed by timer, so a timer has one retry pending at most; a storm of failing want agents is held to the
+    // executor queue limit and the retries beyond it are dropped
+    auto result = TimeTaskExecutor::GetInstance().Post(WANT_RETRY_TASK + std::to_string(timer->id), retryRegister,
+        static_cast<int64_t>(WANT_RETRY_INTERVAL << retryTimes) * ONE_THOUSAND);
+    if (result != TimeTaskExecutor::PostResult::POSTED) {
+        TIME_HILOGW(TIME_MODULE_SERVICE, "retry trigWA not posted:%{public}d id=%{public}" PRId64 "",
+            static_cast<int32_t>(result), timer->id);
+    }
 }
 
 #ifdef MULTI_ACCOUNT_ENABLE
@@ -1032,17 +1241,19 @@ int32_t TimerManager::CheckUserIdForNotify(const std::shared_ptr<TimerInfo> &tim
 }
 #endif
 
-void TimerManager::DeliverTimersLocked(const std::vector<std::shared_ptr<TimerInfo>> &triggerList)
+void TimerManager::DeliverTimersLocked(const std::vector<std::shared_ptr<TimerInfo>> &triggerList,
+    std::chrono::steady_clock::time_point collected)
 {
     auto wakeupNums = std::count_if(triggerList.begin(), triggerList.end(), [](auto timer) {return timer->wakeup;});
-    if (wakeupNums > 0) {
+    if (wakeupNums > 0 && !simulated_) {
+        #ifdef POWER_MANAGER_ENABLE
+        RunningLockCoordinator::GetInstance().HoldForWakeups(RUNNING_LOCK_DURATION,
+            static_cast<uint32_t>(wakeupNums));
+        #endif
         TimeServiceNotify::GetInstance().PublishTimerTriggerEvents();
     }
     for (const auto &timer : triggerList) {
-        if (timer->wakeup) {
-            #ifdef POWER_MANAGER_ENABLE
-            AddRunningLock(RUNNING_LOCK_DURATION);
-            #endif
+        if (timer->wakeup && !simulated_) {
             TimerBehaviorReport(timer, false);
             StatisticReporter(wakeupNums, timer);
         }
@@ -1053,11 +1264,12 @@ void TimerManager::DeliverTimersLocked(const std::vector<std::shared_ptr<TimerIn
                 continue;
             }
         }
-        if (timer->wantAgent) {
-            if (!NotifyWantAgent(timer) &&
-                CheckNeedRecoverOnReboot(timer->bundleName, timer->type, timer->autoRestore)) {
-                NotifyWantAgentRetry(timer);
-            }
+        if (timer->wantAgent && !simulated_ && !NotifyWantAgent(timer) &&
+            CheckNeedRecoverOnReboot(timer->bundleName, timer->type, timer->autoRestore)) {
+            NotifyWantAgentRetry(timer);
+        }
+        TimerLateness::GetInstance().Record(LatenessStage::DELIVER, *timer, GetBootTime() - collected);
+        if (timer->wantAgent && !simulated_) {
             if (timer->repeatInterval != milliseconds::zero()) {
                 continue;
             }
@@ -1156,128 +1368,175 @@ bool TimerManager::NotifyWantAgent(const std::shared_ptr<TimerInfo> &timer)
         data, nullptr);
     if (code != ERR_OK) {
         TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "trigWA id:%{public}" PRId64 " ret:%{public}d", timer->id, code);
-        auto extraInfo = "timer id:" + std::to_string(timer->id);
+        // the recent operations on the timer, decoded only now that they are needed
+        auto extraInfo = "timer id:" + std::to_string(timer->id) + " recent:" +
+            TimerFlightRecorder::GetInstance().DescribeTimer(timer->id, FAULT_REPORT_RECORDS);
         TimeServiceFaultReporter(ReportEventCode::TIMER_WANTAGENT_FAULT_REPORT, code, timer->uid, timer->bundleName,
             extraInfo);
     } else {
-        TIME_SIMPLIFY_HILOGW(TIME_MODULE_SERVICE, "trigWA id:%{public}" PRId64 "", timer->id);
+        TimerFlightRecorder::GetInstance().Record(FlightOp::DELIVER, timer->id, 0, 0, timer->uid);
     }
     return code == ERR_OK;
 }
 
 // needs to acquire the lock `mutex_` before calling this method
-void TimerManager::UpdateTimersState(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger)
+// Applies the outcome of a proxy change to all `alarms` with one pass over the batches and a single kernel
+// reprogram. Retriggered timers are rebatched, the others are stopped.
+void TimerManager::UpdateTimersStateLocked(
+    const std::vector<std::pair<std::shared_ptr<TimerInfo>, bool>> &alarms)
 {
-    if (needRetrigger) {
-        RemoveLocked(alarm->id, false);
-        AdjustSingleTimerLocked(alarm);
-        InsertAndBatchTimerLocked(alarm);
-        RescheduleKernelTimerLocked();
-    } else {
-        RemoveLocked(alarm->id, true);
-        TimerProxy::GetInstance().RemoveUidTimerMapLocked(alarm);
+    if (alarms.empty()) {
+        return;
+    }
+    // a timer can be reported by its uid and by its pid, the last report wins
+    std::unordered_map<uint64_t, size_t> lastReport;
+    for (size_t i = 0; i < alarms.size(); ++i) {
+        lastReport[alarms[i].first->id] = i;
+    }
+    std::unordered_set<uint64_t> ids;
+    for (const auto &item : lastReport) {
+        ids.insert(item.first);
+    }
+    bool isIdleRemoved = mPendingIdleUntil_ != nullptr && ids.find(mPendingIdleUntil_->id) != ids.end();
+    RemoveTimersLocked(ids);
+    bool needRebatch = isIdleRemoved && ExitIdleLocked();
+    for (size_t i = 0; i < alarms.size(); ++i) {
+        auto alarm = alarms[i].first;
+        if (lastReport[alarm->id] != i) {
+            continue;
+        }
+        if (alarms[i].second) {
+            AdjustSingleTimer(alarm);
+            InsertAndBatchTimerLocked(alarm);
+            continue;
+        }
+        TimerProxy::GetInstance().RemoveUidTimerMap(alarm);
         bool needRecover = CheckNeedRecoverOnReboot(alarm->bundleName, alarm->type, alarm->autoRestore);
         UpdateOrDeleteDatabase(false, alarm->id, needRecover);
     }
+    if (needRebatch) {
+        ReBatchAllTimers();
+        return;
+    }
+    RescheduleKernelTimerLocked();
 }
 
 bool TimerManager::AdjustTimer(bool isAdjust, uint32_t interval, uint32_t delta)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TimerLockGuard lock(mutex_);
     if (adjustPolicy_ == isAdjust && adjustInterval_ == interval && adjustDelta_ == delta) {
         TIME_HILOGI(TIME_MODULE_SERVICE, "already deal timer adjust, flag:%{public}d", isAdjust);
         return false;
     }
-    std::chrono::steady_clock::time_point now = TimeUtils::GetBootTimeNs();
+    std::chrono::steady_clock::time_point now = GetBootTime();
     adjustPolicy_ = isAdjust;
     adjustInterval_ = interval;
     adjustDelta_ = delta;
-    auto callback = [this] (AdjustTimerCallback adjustTimer) {
-        bool isChanged = false;
-        for (const auto &batch : alarmBatches_) {
-            if (!batch) {
+    TimerTraceRecord record;
+    record.event = TimerTraceEvent::ADJUST;
+    record.when = interval;
+    record.interval = delta;
+    record.flags = isAdjust ? 1 : 0;
+    WriteTrace(record);
+    std::vector<std::shared_ptr<TimerInfo>> movedTimers;
+    std::unordered_set<uint64_t> movedIds;
+    auto callback = [this, &movedTimers, &movedIds] (AdjustTimerCallback adjustTimer) {
+        for (const auto &item : adjustableTimers_) {
+            auto timer = item.second;
+            if (TimerProxy::GetInstance().IsUidOrPidProxy(timer->uid, timer->pid)) {
                 continue;
             }
-            auto n = batch->Size();
-            for (unsigned int i = 0; i < n; i++) {
-                auto timer = batch->Get(i);
-                isChanged = adjustTimer(timer) || isChanged;
+            if (adjustTimer(timer)) {
+                movedTimers.push_back(timer);
+                movedIds.insert(timer->id);
             }
         }
-        if (isChanged) {
-            TIME_HILOGI(TIME_MODULE_SERVICE, "timer adjust executing, policy:%{public}d", adjustPolicy_);
-            ReBatchAllTimers();
-        }
     };
-
-    return TimerProxy::GetInstance().AdjustTimer(isAdjust, interval, now, delta, callback);
+    auto ret = TimerProxy::GetInstance().AdjustTimer(isAdjust, interval, now, delta, callback);
+    if (movedTimers.empty()) {
+        return ret;
+    }
+    // rebatched after the proxy released its adjust lock, reinserting looks up the exemptions again
+    TIME_HILOGI(TIME_MODULE_SERVICE, "timer adjust executing, policy:%{public}d, moved:%{public}zu",
+        adjustPolicy_, movedTimers.size());
+    RemoveFromBatchesLocked(movedIds);
+    for (const auto &timer : movedTimers) {
+        InsertAndBatchTimerLocked(timer);
+    }
+    RescheduleKernelTimerLocked();
+    return ret;
 }
 
 bool TimerManager::ProxyTimer(int32_t uid, std::set<int> pidList, bool isProxy, bool needRetrigger)
 {
-    std::set<int> failurePid;
-    auto bootTimePoint = TimeUtils::GetBootTimeNs();
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (pidList.size() == 0) {
-        return TimerProxy::GetInstance().ProxyTimer(uid, 0, isProxy, needRetrigger, bootTimePoint,
-            [this] (std::shared_ptr<TimerInfo> &alarm, bool needRetrigger) {
-                UpdateTimersState(alarm, needRetrigger);
-            });
-    }
-    for (std::set<int>::iterator pid = pidList.begin(); pid != pidList.end(); ++pid) {
-        if (!TimerProxy::GetInstance().ProxyTimer(uid, *pid, isProxy, needRetrigger, bootTimePoint,
-            [this] (std::shared_ptr<TimerInfo> &alarm, bool needRetrigger) {
-                UpdateTimersState(alarm, needRetrigger);
-            })) {
-            failurePid.insert(*pid);
-        }
-    }
-    return (failurePid.size() == 0);
+    auto bootTimePoint = GetBootTime();
+    if (pidList.empty()) {
+        pidList.insert(0);
+    }
+    std::vector<std::pair<std::shared_ptr<TimerInfo>, bool>> affectedTimers;
+    TimerLockGuard lock(mutex_);
+    for (auto pid : pidList) {
+        TimerTraceRecord record;
+        record.event = TimerTraceEvent::PROXY;
+        record.uid = uid;
+        record.pid = pid;
+        record.when = TimerProxy::GetInstance().GetProxyDelayTime();
+        record.flags = isProxy ? 1 : 0;
+        WriteTrace(record);
+    }
+    bool ret = TimerProxy::GetInstance().ProxyTimer(uid, pidList, isProxy, needRetrigger, bootTimePoint,
+        [&affectedTimers] (std::shared_ptr<TimerInfo> &alarm, bool needRetrigger) {
+            affectedTimers.emplace_back(alarm, needRetrigger);
+        });
+    UpdateTimersStateLocked(affectedTimers);
+    return ret;
 }
 
 void TimerManager::SetTimerExemption(const std::unordered_set<std::string> &nameArr, bool isExemption)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TimerLockGuard lock(mutex_);
     TimerProxy::GetInstance().SetTimerExemption(nameArr, isExemption);
+    RebuildAdjustableTimersLocked();
 }
 
 void TimerManager::SetAdjustPolicy(const std::unordered_map<std::string, uint32_t> &policyMap)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TimerLockGuard lock(mutex_);
     TimerProxy::GetInstance().SetAdjustPolicy(policyMap);
 }
 
 bool TimerManager::AdjustSingleTimer(std::shared_ptr<TimerInfo> timer)
 {
-    if (!adjustPolicy_ || TimerProxy::GetInstance().IsProxy(timer->uid, 0)
-        || TimerProxy::GetInstance().IsProxy(timer->uid, timer->pid)) {
+    if (TimerProxy::GetInstance().IsUidOrPidProxy(timer->uid, timer->pid)) {
         return false;
     }
-    return TimerProxy::GetInstance().AdjustTimer(adjustPolicy_, adjustInterval_, TimeUtils::GetBootTimeNs(),
-        adjustDelta_, [this, timer] (AdjustTimerCallback adjustTimer) { adjustTimer(timer); });
-}
-
-// needs to acquire the lock `proxyMutex_` before calling this method
-bool TimerManager::AdjustSingleTimerLocked(std::shared_ptr<TimerInfo> timer)
-{
-    if (!adjustPolicy_|| TimerProxy::GetInstance().IsProxyLocked(timer->uid, 0)
-        || TimerProxy::GetInstance().IsProxyLocked(timer->uid, timer->pid)) {
+    if (!adjustPolicy_ && timer->state != TimerInfo::ADJUST) {
         return false;
     }
-    return TimerProxy::GetInstance().AdjustTimer(adjustPolicy_, adjustInterval_, TimeUtils::GetBootTimeNs(),
+    // with adjust off this restores a timer that was skipped by the last restore pass while proxied
+    return TimerProxy::GetInstance().AdjustTimer(adjustPolicy_, adjustInterval_, GetBootTime(),
         adjustDelta_, [this, timer] (AdjustTimerCallback adjustTimer) { adjustTimer(timer); });
 }
 
 bool TimerManager::ResetAllProxy()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return TimerProxy::GetInstance().ResetAllProxy(TimeUtils::GetBootTimeNs(),
-        [this] (std::shared_ptr<TimerInfo> &alarm, bool needRetrigger) { UpdateTimersState(alarm, true); });
+    std::vector<std::pair<std::shared_ptr<TimerInfo>, bool>> affectedTimers;
+    TimerLockGuard lock(mutex_);
+    bool ret = TimerProxy::GetInstance().ResetAllProxy(GetBootTime(),
+        [&affectedTimers] (std::shared_ptr<TimerInfo> &alarm, bool needRetrigger) {
+            affectedTimers.emplace_back(alarm, true);
+        });
+    UpdateTimersStateLocked(affectedTimers);
+    return ret;
 }
 
 bool TimerManager::CheckAllowWhileIdle(const std::shared_ptr<TimerInfo> &alarm)
 {
     #ifdef DEVICE_STANDBY_ENABLE
+    // a simulation has no standby service, so nothing is on its restrict lists
+    if (simulated_) {
+        return true;
+    }
     if (TimePermission::CheckSystemUidCallingPermission(IPCSkeleton::GetCallingFullTokenID())) {
         std::vector<DevStandbyMgr::AllowInfo> restrictList;
         DevStandbyMgr::StandbyServiceClient::GetInstance().GetRestrictList(DevStandbyMgr::AllowType::TIMER,
@@ -1319,19 +1578,7 @@ bool TimerManager::AdjustDeliveryTimeBasedOnDeviceIdle(const std::shared_ptr<Tim
     if (mPendingIdleUntil_ == nullptr) {
         auto itMap = delayedTimers_.find(alarm->id);
         if (itMap != delayedTimers_.end()) {
-            std::chrono::milliseconds currentTime;
-            if (alarm->type == RTC || alarm->type == RTC_WAKEUP) {
-                currentTime = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-            } else {
-                currentTime = duration_cast<milliseconds>(TimeUtils::GetBootTimeNs().time_since_epoch());
-            }
-
-            if (alarm->origWhen > currentTime) {
-                auto offset = alarm->origWhen - currentTime;
-                return alarm->UpdateWhenElapsedFromNow(TimeUtils::GetBootTimeNs(), offset);
-            }
-            // 2 means the time of performing task.
-            return alarm->UpdateWhenElapsedFromNow(TimeUtils::GetBootTimeNs(), milliseconds(2));
+            return TimerScheduler::RestoreFromIdle(*alarm, GetBootTime());
         }
         return false;
     }
@@ -1345,9 +1592,7 @@ bool TimerManager::AdjustDeliveryTimeBasedOnDeviceIdle(const std::shared_ptr<Tim
     } else {
         TIME_HILOGD(TIME_MODULE_SERVICE, "Timer not allowed, id=%{public}" PRId64 "", alarm->id);
         delayedTimers_[alarm->id] = alarm->whenElapsed;
-        auto bootTimePoint = TimeUtils::GetBootTimeNs();
-        auto offset = TimerInfo::ConvertToElapsed(mPendingIdleUntil_->when, mPendingIdleUntil_->type) - bootTimePoint;
-        return alarm->UpdateWhenElapsedFromNow(bootTimePoint, offset);
+        return TimerScheduler::DeferToIdleUntil(*alarm, *mPendingIdleUntil_, GetBootTime());
     }
 }
 
@@ -1367,34 +1612,58 @@ bool TimerManager::AdjustTimersBasedOnDeviceIdle()
     return isAdjust;
 }
 
-// needs to acquire the lock `mutex_` before calling this method
-bool AddBatchLocked(std::vector<std::shared_ptr<Batch>> &list, const std::shared_ptr<Batch> &newBatch)
+#ifdef HIDUMPER_ENABLE
+TimerManager::TimerSnapshot TimerManager::TakeSnapshot(const TimerInfo &timer)
 {
-    auto it = std::upper_bound(list.begin(),
-                               list.end(),
-                               newBatch,
-                               [](const std::shared_ptr<Batch> &first, const std::shared_ptr<Batch> &second) {
-                                   return first->GetStart() < second->GetStart();
-                               });
-    list.insert(it, newBatch);
-    return it == list.begin();
+    TimerSnapshot snapshot;
+    snapshot.id = timer.id;
+    snapshot.type = timer.type;
+    snapshot.flags = timer.flags;
+    snapshot.uid = timer.uid;
+    snapshot.wakeup = timer.wakeup;
+    snapshot.state = timer.state;
+    snapshot.origWhen = timer.origWhen.count();
+    snapshot.windowLength = timer.windowLength.count();
+    snapshot.repeatInterval = timer.repeatInterval.count();
+    snapshot.whenElapsed = timer.whenElapsed.time_since_epoch().count();
+    snapshot.maxWhenElapsed = timer.maxWhenElapsed.time_since_epoch().count();
+    return snapshot;
+}
+
+void TimerManager::ShowTimerSnapshot(int fd, const TimerSnapshot &timer)
+{
+    dprintf(fd, " * timer type          = %d\n", timer.type);
+    dprintf(fd, " * timer flag          = %u\n", timer.flags);
+    dprintf(fd, " * timer window Length = %" PRId64 "\n", timer.windowLength);
+    dprintf(fd, " * timer interval      = %" PRId64 "\n", timer.repeatInterval);
+    dprintf(fd, " * timer whenElapsed   = %" PRId64 "\n", timer.whenElapsed);
+    dprintf(fd, " * timer uid           = %d\n\n", timer.uid);
+}
+
+// the entries never change once created, holding them keeps them valid after the lock is released
+std::vector<std::shared_ptr<TimerEntry>> TimerManager::GetEntrySnapshot()
+{
+    std::vector<std::shared_ptr<TimerEntry>> entries;
+    TimerLockGuard lock(entryMapMutex_);
+    entries.reserve(timerEntryMap_.size());
+    for (const auto &entry : timerEntryMap_) {
+        entries.push_back(entry.second);
+    }
+    return entries;
 }
 
-#ifdef HIDUMPER_ENABLE
 bool TimerManager::ShowTimerEntryMap(int fd)
 {
     TIME_HILOGD(TIME_MODULE_SERVICE, "start");
-    std::lock_guard<std::mutex> lock(entryMapMutex_);
-    auto iter = timerEntryMap_.begin();
-    for (; iter != timerEntryMap_.end(); iter++) {
-        dprintf(fd, " - dump timer number   = %lu\n", iter->first);
-        dprintf(fd, " * timer name          = %s\n", iter->second->name.c_str());
-        dprintf(fd, " * timer id            = %lu\n", iter->second->id);
-        dprintf(fd, " * timer type          = %d\n", iter->second->type);
-        dprintf(fd, " * timer flag          = %u\n", iter->second->flag);
-        dprintf(fd, " * timer window Length = %lld\n", iter->second->windowLength);
-        dprintf(fd, " * timer interval      = %lu\n", iter->second->interval);
-        dprintf(fd, " * timer uid           = %d\n\n", iter->second->uid);
+    for (const auto &entry : GetEntrySnapshot()) {
+        dprintf(fd, " - dump timer number   = %" PRIu64 "\n", entry->id);
+        dprintf(fd, " * timer name          = %s\n", entry->name.c_str());
+        dprintf(fd, " * timer id            = %" PRIu64 "\n", entry->id);
+        dprintf(fd, " * timer type          = %d\n", entry->type);
+        dprintf(fd, " * timer flag          = %u\n", entry->flag);
+        dprintf(fd, " * timer window Length = %" PRId64 "\n", entry->windowLength);
+        dprintf(fd, " * timer interval      = %" PRIu64 "\n", entry->interval);
+        dprintf(fd, " * timer uid           = %d\n\n", entry->uid);
     }
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
     return true;
@@ -1403,19 +1672,22 @@ bool TimerManager::ShowTimerEntryMap(int fd)
 bool TimerManager::ShowTimerEntryById(int fd, uint64_t timerId)
 {
     TIME_HILOGD(TIME_MODULE_SERVICE, "start");
-    std::lock_guard<std::mutex> lock(entryMapMutex_);
-    auto iter = timerEntryMap_.find(timerId);
-    if (iter == timerEntryMap_.end()) {
-        TIME_HILOGD(TIME_MODULE_SERVICE, "end");
-        return false;
-    } else {
-        dprintf(fd, " - dump timer number   = %lu\n", iter->first);
-        dprintf(fd, " * timer id            = %lu\n", iter->second->id);
-        dprintf(fd, " * timer type          = %d\n", iter->second->type);
-        dprintf(fd, " * timer window Length = %lld\n", iter->second->windowLength);
-        dprintf(fd, " * timer interval      = %lu\n", iter->second->interval);
-        dprintf(fd, " * timer uid           = %d\n\n", iter->second->uid);
-    }
+    std::shared_ptr<TimerEntry> entry;
+    {
+        TimerLockGuard lock(entryMapMutex_);
+        auto iter = timerEntryMap_.find(timerId);
+        if (iter == timerEntryMap_.end()) {
+            TIME_HILOGD(TIME_MODULE_SERVICE, "end");
+            return false;
+        }
+        entry = iter->second;
+    }
+    dprintf(fd, " - dump timer number   = %" PRIu64 "\n", entry->id);
+    dprintf(fd, " * timer id            = %" PRIu64 "\n", entry->id);
+    dprintf(fd, " * timer type          = %d\n", entry->type);
+    dprintf(fd, " * timer window Length = %" PRId64 "\n", entry->windowLength);
+    dprintf(fd, " * timer interval      = %" PRIu64 "\n", entry->interval);
+    dprintf(fd, " * timer uid           = %d\n\n", entry->uid);
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
     return true;
 }
@@ -1423,15 +1695,22 @@ bool TimerManager::ShowTimerEntryById(int fd, uint64_t timerId)
 bool TimerManager::ShowTimerTriggerById(int fd, uint64_t timerId)
 {
     TIME_HILOGD(TIME_MODULE_SERVICE, "start");
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (size_t i = 0; i < alarmBatches_.size(); i++) {
-        for (size_t j = 0; j < alarmBatches_[i]->Size(); j++) {
-            if (alarmBatches_[i]->Get(j)->id == timerId) {
-                dprintf(fd, " - dump timer id   = %lu\n", alarmBatches_[i]->Get(j)->id);
-                dprintf(fd, " * timer trigger   = %lld\n", alarmBatches_[i]->Get(j)->origWhen);
+    std::vector<int64_t> triggers;
+    {
+        TimerLockGuard lock(mutex_);
+        for (const auto &batch : alarmBatches_) {
+            for (size_t i = 0; i < batch->Size(); i++) {
+                auto timer = batch->Get(i);
+                if (timer->id == timerId) {
+                    triggers.push_back(timer->origWhen.count());
+                }
             }
         }
     }
+    for (auto trigger : triggers) {
+        dprintf(fd, " - dump timer id   = %" PRIu64 "\n", timerId);
+        dprintf(fd, " * timer trigger   = %" PRId64 "\n", trigger);
+    }
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
     return true;
 }
@@ -1439,33 +1718,223 @@ bool TimerManager::ShowTimerTriggerById(int fd, uint64_t timerId)
 bool TimerManager::ShowIdleTimerInfo(int fd)
 {
     TIME_HILOGD(TIME_MODULE_SERVICE, "start");
-    std::lock_guard<std::mutex> lock(mutex_);
-    dprintf(fd, " - dump idle state         = %d\n", (mPendingIdleUntil_ != nullptr));
-    if (mPendingIdleUntil_ != nullptr) {
-        dprintf(fd, " - dump idle timer id  = %lu\n", mPendingIdleUntil_->id);
-        dprintf(fd, " * timer type          = %d\n", mPendingIdleUntil_->type);
-        dprintf(fd, " * timer flag          = %u\n", mPendingIdleUntil_->flags);
-        dprintf(fd, " * timer window Length = %lu\n", mPendingIdleUntil_->windowLength);
-        dprintf(fd, " * timer interval      = %lu\n", mPendingIdleUntil_->repeatInterval);
-        dprintf(fd, " * timer whenElapsed   = %lu\n", mPendingIdleUntil_->whenElapsed);
-        dprintf(fd, " * timer uid           = %d\n\n", mPendingIdleUntil_->uid);
+    bool idle = false;
+    TimerSnapshot idleTimer;
+    std::vector<TimerSnapshot> pendingTimers;
+    std::vector<std::pair<uint64_t, int64_t>> delayedTimers;
+    {
+        TimerLockGuard lock(mutex_);
+        idle = mPendingIdleUntil_ != nullptr;
+        if (idle) {
+            idleTimer = TakeSnapshot(*mPendingIdleUntil_);
+        }
+        pendingTimers.reserve(pendingDelayTimers_.size());
+        for (const auto &pendingTimer : pendingDelayTimers_) {
+            pendingTimers.push_back(TakeSnapshot(*pendingTimer));
+        }
+        for (const auto &delayedTimer : delayedTimers_) {
+            delayedTimers.emplace_back(delayedTimer.first, delayedTimer.second.time_since_epoch().count());
+        }
     }
-    for (const auto &pendingTimer : pendingDelayTimers_) {
-        dprintf(fd, " - dump pending delay timer id  = %lu\n", pendingTimer->id);
-        dprintf(fd, " * timer type          = %d\n", pendingTimer->type);
-        dprintf(fd, " * timer flag          = %u\n", pendingTimer->flags);
-        dprintf(fd, " * timer window Length = %lu\n", pendingTimer->windowLength);
-        dprintf(fd, " * timer interval      = %lu\n", pendingTimer->repeatInterval);
-        dprintf(fd, " * timer whenElapsed   = %lu\n", pendingTimer->whenElapsed);
-        dprintf(fd, " * timer uid           = %d\n\n", pendingTimer->uid);
-    }
-    for (const auto &delayedTimer : delayedTimers_) {
-        dprintf(fd, " - dump delayed timer id = %lu\n", delayedTimer.first);
-        dprintf(fd, " * timer whenElapsed     = %lu\n", delayedTimer.second);
+    dprintf(fd, " - dump idle state         = %d\n", idle);
+    if (idle) {
+        dprintf(fd, " - dump idle timer id  = %" PRIu64 "\n", idleTimer.id);
+        ShowTimerSnapshot(fd, idleTimer);
+    }
+    for (const auto &pendingTimer : pendingTimers) {
+        dprintf(fd, " - dump pending delay timer id  = %" PRIu64 "\n", pendingTimer.id);
+        ShowTimerSnapshot(fd, pendingTimer);
+    }
+    for (const auto &delayedTimer : delayedTimers) {
+        dprintf(fd, " - dump delayed timer id = %" PRIu64 "\n", delayedTimer.first);
+        dprintf(fd, " * timer whenElapsed     = %" PRId64 "\n", delayedTimer.second);
     }
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
     return true;
 }
+
+void TimerManager::ShowCoalesceInfo(int fd)
+{
+    CoalescePolicy policy;
+    size_t batches = 0;
+    size_t wakeupBatches = 0;
+    uint64_t runs = 0;
+    uint64_t savedBatches = 0;
+    decltype(coalesceStats_) coalesceStats;
+    // the regroup is a best fit pass over every timer, it runs on copies once the lock is released
+    BatchList copies;
+    {
+        TimerLockGuard lock(mutex_);
+        auto now = GetBootTime();
+        policy = coalescePolicy_;
+        batches = alarmBatches_.size();
+        wakeupBatches = TimerScheduler::CountWakeupBatches(alarmBatches_);
+        copies.reserve(alarmBatches_.size());
+        for (const auto &batch : alarmBatches_) {
+            auto copy = std::make_shared<Batch>();
+            // in order already, each copy is appended
+            for (size_t i = 0; i < batch->Size(); i++) {
+                copy->Add(std::make_shared<TimerInfo>(*batch->Get(i)));
+            }
+            copies.push_back(copy);
+        }
+        runs = coalesceRuns_;
+        savedBatches = coalesceSavedBatches_;
+        coalesceStats = coalesceStats_;
+        coalesceStats[static_cast<size_t>(policy)].activeTime += now - coalescePolicySince_;
+    }
+    auto fewestWakeupBatches = TimerScheduler::CountWakeupBatches(TimerScheduler::Coalesce(copies));
+    dprintf(fd, " * coalesce policy         = %s\n", TimerScheduler::GetPolicyName(policy));
+    dprintf(fd, " * pending batches         = %zu\n", batches);
+    dprintf(fd, " * pending wakeup batches  = %zu\n", wakeupBatches);
+    dprintf(fd, " * fewest wakeup batches   = %zu\n", fewestWakeupBatches);
+    dprintf(fd, " * regroups                = %" PRIu64 "\n", runs);
+    dprintf(fd, " * regrouped wakeups saved = %" PRIu64 "\n", savedBatches);
+    for (size_t i = 0; i < coalesceStats.size(); i++) {
+        const auto &stats = coalesceStats[i];
+        auto activeSeconds = duration_cast<seconds>(stats.activeTime).count();
+        if (activeSeconds == 0) {
+            continue;
+        }
+        dprintf(fd, " * policy                  = %s\n",
+            TimerScheduler::GetPolicyName(static_cast<CoalescePolicy>(i)));
+        dprintf(fd, "   * active time           = %" PRId64 "s\n", static_cast<int64_t>(activeSeconds));
+        dprintf(fd, "   * wakeups               = %" PRIu64 "\n", stats.wakeups);
+        dprintf(fd, "   * wakeups per hour      = %.1f\n",
+            static_cast<double>(stats.wakeups) * SECONDS_PER_HOUR / static_cast<double>(activeSeconds));
+        dprintf(fd, "   * batches fired         = %" PRIu64 "\n", stats.batches);
+        dprintf(fd, "   * wakeup batches fired  = %" PRIu64 "\n", stats.wakeupBatches);
+    }
+}
+
+void TimerManager::WriteTimerSnapshot(JsonLinesWriter &writer, const char *kind, const TimerSnapshot &timer)
+{
+    writer.Begin(kind)
+        .AddUint("id", timer.id)
+        .AddInt("uid", timer.uid)
+        .AddInt("type", timer.type)
+        .AddUint("flags", timer.flags)
+        .AddBool("wakeup", timer.wakeup)
+        .AddInt("state", timer.state)
+        .AddInt("orig_when", timer.origWhen)
+        .AddInt("when", timer.whenElapsed)
+        .AddInt("max_when", timer.maxWhenElapsed)
+        .AddInt("window", timer.windowLength)
+        .AddInt("interval", timer.repeatInterval);
+}
+
+void TimerManager::ShowJsonLines(int fd)
+{
+    struct BatchSnapshot {
+        int64_t start;
+        int64_t end;
+        uint32_t flags;
+        size_t size;
+        bool wakeup;
+    };
+    auto entries = GetEntrySnapshot();
+    std::vector<BatchSnapshot> batches;
+    // <batch index, timer>
+    std::vector<std::pair<size_t, TimerSnapshot>> timers;
+    bool idle = false;
+    TimerSnapshot idleTimer;
+    std::vector<TimerSnapshot> pendingTimers;
+    std::vector<std::pair<uint64_t, int64_t>> delayedTimers;
+    bool adjustPolicy = false;
+    uint32_t adjustInterval = 0;
+    uint32_t adjustDelta = 0;
+    size_t adjustableTimers = 0;
+    CoalescePolicy policy;
+    uint64_t runs = 0;
+    uint64_t savedBatches = 0;
+    int64_t outOfRangeTimes = 0;
+    {
+        TimerLockGuard lock(mutex_);
+        batches.reserve(alarmBatches_.size());
+        for (size_t i = 0; i < alarmBatches_.size(); i++) {
+            const auto &batch = alarmBatches_[i];
+            batches.push_back({ batch->GetStart().time_since_epoch().count(),
+                batch->GetEnd().time_since_epoch().count(), batch->GetFlags(), batch->Size(), batch->HasWakeups() });
+            for (size_t j = 0; j < batch->Size(); j++) {
+                timers.emplace_back(i, TakeSnapshot(*batch->Get(j)));
+            }
+        }
+        idle = mPendingIdleUntil_ != nullptr;
+        if (idle) {
+            idleTimer = TakeSnapshot(*mPendingIdleUntil_);
+        }
+        for (const auto &pendingTimer : pendingDelayTimers_) {
+            pendingTimers.push_back(TakeSnapshot(*pendingTimer));
+        }
+        for (const auto &delayedTimer : delayedTimers_) {
+            delayedTimers.emplace_back(delayedTimer.first, delayedTimer.second.time_since_epoch().count());
+        }
+        adjustPolicy = adjustPolicy_;
+        adjustInterval = adjustInterval_;
+        adjustDelta = adjustDelta_;
+        adjustableTimers = adjustableTimers_.size();
+        policy = coalescePolicy_;
+        runs = coalesceRuns_;
+        savedBatches = coalesceSavedBatches_;
+        outOfRangeTimes = timerOutOfRangeTimes_;
+    }
+    JsonLinesWriter writer(fd);
+    for (const auto &entry : entries) {
+        writer.Begin("entry")
+            .AddUint("id", entry->id)
+            .AddString("name", entry->name)
+            .AddInt("type", entry->type)
+            .AddUint("flag", entry->flag)
+            .AddInt("window", entry->windowLength)
+            .AddUint("interval", entry->interval)
+            .AddInt("uid", entry->uid)
+            .AddInt("pid", entry->pid)
+            .AddString("bundle", entry->bundleName)
+            .AddBool("auto_restore", entry->autoRestore)
+            .AddBool("want_agent", entry->wantAgent != nullptr)
+            .End();
+    }
+    for (size_t i = 0; i < batches.size(); i++) {
+        writer.Begin("batch")
+            .AddUint("index", i)
+            .AddInt("start", batches[i].start)
+            .AddInt("end", batches[i].end)
+            .AddUint("flags", batches[i].flags)
+            .AddUint("size", batches[i].size)
+            .AddBool("wakeup", batches[i].wakeup)
+            .End();
+    }
+    for (const auto &timer : timers) {
+        WriteTimerSnapshot(writer, "timer", timer.second);
+        writer.AddUint("batch", timer.first).End();
+    }
+    if (idle) {
+        WriteTimerSnapshot(writer, "idle_until", idleTimer);
+        writer.End();
+    }
+    for (const auto &pendingTimer : pendingTimers) {
+        WriteTimerSnapshot(writer, "pending_delay", pendingTimer);
+        writer.End();
+    }
+    for (const auto &delayedTimer : delayedTimers) {
+        writer.Begin("delayed").AddUint("id", delayedTimer.first).AddInt("orig_when", delayedTimer.second).End();
+    }
+    writer.Begin("adjust")
+        .AddBool("enabled", adjustPolicy)
+        .AddUint("interval", adjustInterval)
+        .AddUint("delta", adjustDelta)
+        .AddUint("adjustable_timers", adjustableTimers)
+        .End();
+    writer.Begin("timer_counters")
+        .AddUint("entries", entries.size())
+        .AddUint("batches", batches.size())
+        .AddUint("timers", timers.size())
+        .AddString("coalesce_policy", TimerScheduler::GetPolicyName(policy))
+        .AddUint("regroups", runs)
+        .AddUint("regrouped_wakeups_saved", savedBatches)
+        .AddInt("out_of_range", outOfRangeTimes)
+        .End();
+}
 #endif
 
 #ifdef MULTI_ACCOUNT_ENABLE
@@ -1474,7 +1943,7 @@ void TimerManager::OnUserRemoved(int userId)
     TIME_HILOGI(TIME_MODULE_SERVICE, "Removed userId: %{public}d", userId);
     std::vector<std::shared_ptr<TimerEntry>> removeList;
     {
-        std::lock_guard<std::mutex> lock(entryMapMutex_);
+        TimerLockGuard lock(entryMapMutex_);
         for (auto it = timerEntryMap_.begin(); it != timerEntryMap_.end(); ++it) {
             int userIdOfTimer = -1;
             AccountSA::OsAccountManager::GetOsAccountLocalIdFromUid(it->second->uid, userIdOfTimer);
@@ -1494,7 +1963,7 @@ void TimerManager::OnPackageRemoved(int uid)
     TIME_HILOGI(TIME_MODULE_SERVICE, "Removed uid: %{public}d", uid);
     std::vector<std::shared_ptr<TimerEntry>> removeList;
     {
-        std::lock_guard<std::mutex> lock(entryMapMutex_);
+        TimerLockGuard lock(entryMapMutex_);
         for (auto it = timerEntryMap_.begin(); it != timerEntryMap_.end(); ++it) {
             if (it->second->uid == uid) {
                 removeList.push_back(it->second);
@@ -1511,7 +1980,7 @@ void TimerManager::HandleRSSDeath()
     TIME_HILOGI(TIME_MODULE_CLIENT, "RSSSaDeathRecipient died");
     uint64_t id = 0;
     {
-        std::lock_guard <std::mutex> lock(mutex_);
+        TimerLockGuard lock(mutex_);
         if (mPendingIdleUntil_ != nullptr) {
             id = mPendingIdleUntil_->id;
         } else {
@@ -1524,18 +1993,8 @@ void TimerManager::HandleRSSDeath()
 void TimerManager::HandleRepeatTimer(
     const std::shared_ptr<TimerInfo> &timer, std::chrono::steady_clock::time_point nowElapsed)
 {
-    if (timer->repeatInterval > milliseconds::zero()) {
-        uint64_t count = 1 + static_cast<uint64_t>(
-            duration_cast<milliseconds>(nowElapsed - timer->whenElapsed) / timer->repeatInterval);
-        auto delta = count * timer->repeatInterval;
-        steady_clock::time_point nextElapsed = timer->whenElapsed + delta;
-        steady_clock::time_point nextMaxElapsed = (timer->windowLength == milliseconds::zero()) ?
-                                                  nextElapsed :
-                                                  TimerInfo::MaxTriggerTime(nowElapsed, nextElapsed,
-                                                                            timer->repeatInterval);
-        auto alarm = std::make_shared<TimerInfo>(timer->name, timer->id, timer->type, timer->when + delta,
-            timer->whenElapsed + delta, timer->windowLength, nextMaxElapsed, timer->repeatInterval, timer->callback,
-            timer->wantAgent, timer->flags, timer->autoRestore, timer->uid, timer->pid, timer->bundleName);
+    auto alarm = TimerScheduler::NextRepeat(*timer, nowElapsed);
+    if (alarm != nullptr) {
         SetHandlerLocked(alarm);
     } else {
         TimerProxy::GetInstance().RemoveUidTimerMap(timer);
@@ -1556,52 +2015,18 @@ void TimerManager::HandleRunningLock(const std::shared_ptr<Batch> &firstWakeup)
     TimeUtils::GetBootTimeNs(currentTime);
     auto nextTimerOffset =
         duration_cast<nanoseconds>(firstWakeup->GetStart().time_since_epoch()).count() - currentTime;
-    auto lockOffset = currentTime - lockExpiredTime_;
-    if (nextTimerOffset > 0 && nextTimerOffset <= USE_LOCK_TIME_IN_NANO &&
-        ((lockOffset < 0 && std::abs(lockOffset) <= nextTimerOffset) || lockOffset >= 0)) {
-        auto firstAlarm = firstWakeup->Get(0);
-        if (firstAlarm == nullptr) {
-            TIME_HILOGI(TIME_MODULE_SERVICE, "first alarm is null");
-            return;
-        }
-        auto holdLockTime = nextTimerOffset + ONE_HUNDRED_MILLI;
-        TIME_HILOGI(TIME_MODULE_SERVICE, "time:%{public}" PRIu64 ", timerId:%{public}" PRIu64"",
-            static_cast<uint64_t>(holdLockTime), firstAlarm->id);
-        lockExpiredTime_ = currentTime + holdLockTime;
-        AddRunningLock(holdLockTime);
+    if (nextTimerOffset <= 0 || nextTimerOffset > USE_LOCK_TIME_IN_NANO) {
+        return;
     }
-}
-
-void TimerManager::AddRunningLockRetry(long long holdLockTime)
-{
-    auto retryRegister = [this, holdLockTime]() {
-        for (int i = 0; i < POWER_RETRY_TIMES; i++) {
-            usleep(POWER_RETRY_INTERVAL);
-            runningLock_->Lock(static_cast<int32_t>(holdLockTime / NANO_TO_MILLI));
-            if (runningLock_->IsUsed()) {
-                return;
-            }
-        }
-    };
-    std::thread thread(retryRegister);
-    thread.detach();
-}
-
-void TimerManager::AddRunningLock(long long holdLockTime)
-{
-    if (runningLock_ == nullptr) {
-        std::lock_guard<std::mutex> lock(runningLockMutex_);
-        if (runningLock_ == nullptr) {
-            TIME_HILOGI(TIME_MODULE_SERVICE, "runningLock is nullptr, create runningLock");
-            runningLock_ = PowerMgr::PowerMgrClient::GetInstance().CreateRunningLock("timeServiceRunningLock",
-                PowerMgr::RunningLockType::RUNNINGLOCK_BACKGROUND_NOTIFICATION);
-        }
+    auto firstAlarm = firstWakeup->Get(0);
+    if (firstAlarm == nullptr) {
+        TIME_HILOGI(TIME_MODULE_SERVICE, "first alarm is null");
+        return;
     }
-    if (runningLock_ != nullptr) {
-        runningLock_->Lock(static_cast<int32_t>(holdLockTime / NANO_TO_MILLI));
-        if (!runningLock_->IsUsed()) {
-            AddRunningLockRetry(holdLockTime);
-        }
+    auto holdLockTime = nextTimerOffset + ONE_HUNDRED_MILLI;
+    if (RunningLockCoordinator::GetInstance().HoldUntil(currentTime + holdLockTime)) {
+        TIME_HILOGI(TIME_MODULE_SERVICE, "time:%{public}" PRIu64 ", timerId:%{public}" PRIu64"",
+            static_cast<uint64_t>(holdLockTime), firstAlarm->id);
     }
 }
 #endif
@@ -13,9 +13,11 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cinttypes>
 
 #include "timer_proxy.h"
+#include "json_lines_writer.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -55,31 +57,33 @@ int32_t TimerProxy::CallbackAlarmIfNeed(const std::shared_ptr<TimerInfo> &alarm)
     return ret;
 }
 
-bool TimerProxy::ProxyTimer(int32_t uid, int pid, bool isProxy, bool needRetrigger,
+bool TimerProxy::ProxyTimer(int32_t uid, const std::set<int> &pidList, bool isProxy, bool needRetrigger,
     const std::chrono::steady_clock::time_point &now,
     std::function<void(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger)> insertAlarmCallback)
 {
-    TIME_HILOGD(TIME_MODULE_SERVICE, "start. pid=%{public}d, isProxy=%{public}u, needRetrigger=%{public}u",
-        pid, isProxy, needRetrigger);
-
-    std::lock_guard<std::mutex> lockProxy(proxyMutex_);
-    if (isProxy) {
-        UpdateProxyWhenElapsedForProxyTimers(uid, pid, now, insertAlarmCallback, needRetrigger);
-        return true;
-    }
-
-    if (!RestoreProxyWhenElapsedForProxyTimers(uid, pid, now, insertAlarmCallback, needRetrigger)) {
-        TIME_HILOGE(TIME_MODULE_SERVICE, "Pid%{public}d doesn't exist in the proxy list" PRId64 "", pid);
-        return false;
+    TIME_HILOGD(TIME_MODULE_SERVICE, "start. uid=%{public}d, pids=%{public}zu, isProxy=%{public}u, "
+        "needRetrigger=%{public}u", uid, pidList.size(), isProxy, needRetrigger);
+
+    TimerLockGuard lockProxy(proxyMutex_);
+    bool ret = true;
+    for (auto pid : pidList) {
+        if (isProxy) {
+            UpdateProxyWhenElapsedForProxyTimers(uid, pid, now, insertAlarmCallback, needRetrigger);
+            continue;
+        }
+        if (!RestoreProxyWhenElapsedForProxyTimers(uid, pid, now, insertAlarmCallback, needRetrigger)) {
+            TIME_HILOGE(TIME_MODULE_SERVICE, "Pid%{public}d doesn't exist in the proxy list", pid);
+            ret = false;
+        }
     }
-    return true;
+    return ret;
 }
 
 bool TimerProxy::AdjustTimer(bool isAdjust, uint32_t interval,
     const std::chrono::steady_clock::time_point &now, uint32_t delta,
     std::function<void(AdjustTimerCallback adjustTimer)> updateTimerDeliveries)
 {
-    std::lock_guard<std::mutex> lockProxy(adjustMutex_);
+    TimerLockGuard lockProxy(adjustMutex_);
     TIME_HILOGD(TIME_MODULE_SERVICE, "adjust timer state:%{public}d, interval:%{public}d, delta:%{public}d",
         isAdjust, interval, delta);
     auto callback = [=] (std::shared_ptr<TimerInfo> timer) {
@@ -93,17 +97,16 @@ bool TimerProxy::AdjustTimer(bool isAdjust, uint32_t interval,
         }
         return RestoreAdjustWhenElapsed(timer);
     };
+    // restored timers leave adjustTimers_ one by one, so proxied ones skipped here stay tracked
+    // until AdjustSingleTimer restores them once their proxy is lifted
     updateTimerDeliveries(callback);
-    if (!isAdjust) {
-        adjustTimers_.clear();
-    }
     return true;
 }
 
 bool TimerProxy::UpdateAdjustWhenElapsed(const std::chrono::steady_clock::time_point &now,
     uint32_t interval, uint32_t delta, std::shared_ptr<TimerInfo> &timer)
 {
-    if (IsTimerExemption(timer)) {
+    if (IsTimerExemptionLocked(timer)) {
         TIME_HILOGD(TIME_MODULE_SERVICE, "adjust exemption timer bundleName:%{public}s",
             timer->bundleName.c_str());
         return false;
@@ -111,12 +114,7 @@ bool TimerProxy::UpdateAdjustWhenElapsed(const std::chrono::steady_clock::time_p
     TIME_HILOGD(TIME_MODULE_SERVICE, "adjust single time id:%{public}" PRId64 ", "
         "uid:%{public}d, bundleName:%{public}s",
         timer->id, timer->uid, timer->bundleName.c_str());
-    uint32_t policy = 0;
-    auto it = adjustPolicyList_.find(timer->bundleName);
-    if (it != adjustPolicyList_.end()) {
-        policy = it->second;
-    }
-    auto ret = timer->AdjustTimer(now, interval, delta, policy);
+    auto ret = timer->AdjustTimer(now, interval, delta, timer->adjustPolicy);
     if (ret) {
         adjustTimers_.insert(timer->id);
     }
@@ -125,15 +123,22 @@ bool TimerProxy::UpdateAdjustWhenElapsed(const std::chrono::steady_clock::time_p
 
 bool TimerProxy::RestoreAdjustWhenElapsed(std::shared_ptr<TimerInfo> &timer)
 {
-    if (adjustTimers_.find(timer->id) == adjustTimers_.end()) {
+    if (adjustTimers_.erase(timer->id) == 0 || timer->state != TimerInfo::TimerState::ADJUST) {
         return false;
     }
     return timer->RestoreAdjustTimer();
 }
 
+void TimerProxy::EraseAdjustTimer(uint64_t id)
+{
+    TimerLockGuard lockProxy(adjustMutex_);
+    adjustTimers_.erase(id);
+}
+
 bool TimerProxy::SetTimerExemption(const std::unordered_set<std::string> &nameArr, bool isExemption)
 {
-    std::lock_guard<std::mutex> lockProxy(adjustMutex_);
+    TimerLockGuard lockProxy(adjustMutex_);
+    adjustVersion_++;
     bool isChanged = false;
     if (!isExemption) {
         for (const auto &name : nameArr) {
@@ -145,21 +150,35 @@ bool TimerProxy::SetTimerExemption(const std::unordered_set<std::string> &nameAr
     return isChanged;
 }
 
-bool TimerProxy::IsTimerExemption(std::shared_ptr<TimerInfo> timer)
+bool TimerProxy::IsTimerExemption(const std::shared_ptr<TimerInfo> &timer)
+{
+    TimerLockGuard lockProxy(adjustMutex_);
+    return IsTimerExemptionLocked(timer);
+}
+
+// needs to acquire the lock `adjustMutex_` before calling this method
+// The verdict is computed once per timer and policy version instead of on every adjust pass.
+bool TimerProxy::IsTimerExemptionLocked(const std::shared_ptr<TimerInfo> &timer)
 {
+    auto version = adjustVersion_;
+    if (timer->adjustVersion == version) {
+        return timer->isAdjustExempt;
+    }
     auto key = timer->bundleName + "|" + timer->name;
     TIME_HILOGD(TIME_MODULE_SERVICE, "key is:%{public}s", key.c_str());
-    if ((adjustExemptionList_.find(timer->bundleName) != adjustExemptionList_.end()
+    timer->isAdjustExempt = (adjustExemptionList_.find(timer->bundleName) != adjustExemptionList_.end()
         || adjustExemptionList_.find(key) != adjustExemptionList_.end())
-        && timer->windowLength == milliseconds::zero()) {
-        return true;
-    }
-    return false;
+        && timer->windowLength == milliseconds::zero();
+    auto it = adjustPolicyList_.find(timer->bundleName);
+    timer->adjustPolicy = (it != adjustPolicyList_.end()) ? it->second : 0;
+    timer->adjustVersion = version;
+    return timer->isAdjustExempt;
 }
 
 void TimerProxy::SetAdjustPolicy(const std::unordered_map<std::string, uint32_t> &policyMap)
 {
-    std::lock_guard<std::mutex> lockProxy(adjustMutex_);
+    TimerLockGuard lockProxy(adjustMutex_);
+    adjustVersion_++;
     for (const auto& policy : policyMap) {
         adjustPolicyList_[policy.first] = policy.second;
     }
@@ -173,17 +192,70 @@ bool TimerProxy::ResetAllProxy(const std::chrono::steady_clock::time_point &now,
     return true;
 }
 
-void TimerProxy::EraseTimerFromProxyTimerMap(const uint64_t id, const int uid, const int pid)
+void TimerProxy::EraseTimerFromProxyTimerMap(const uint64_t id)
+{
+    TIME_HILOGD(TIME_MODULE_SERVICE, "erase timer from proxy timer map, id=%{public}" PRId64 "", id);
+    TimerLockGuard lock(proxyMutex_);
+    auto itIndex = timerProxyKeyIndex_.find(id);
+    if (itIndex == timerProxyKeyIndex_.end()) {
+        return;
+    }
+    for (auto key : itIndex->second) {
+        auto it = proxyTimers_.find(key);
+        if (it != proxyTimers_.end()) {
+            it->second.erase(id);
+        }
+    }
+    timerProxyKeyIndex_.erase(itIndex);
+}
+
+// needs to acquire the lock `proxyMutex_` before calling this method
+void TimerProxy::IndexProxyTimerLocked(const uint64_t id, const uint64_t key)
+{
+    auto &keys = timerProxyKeyIndex_[id];
+    if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+        keys.push_back(key);
+    }
+}
+
+// needs to acquire the lock `proxyMutex_` before calling this method
+void TimerProxy::EraseProxyKeyLocked(const uint64_t key)
 {
-    TIME_HILOGD(TIME_MODULE_SERVICE, "erase timer from proxy timer map, id=%{public}" PRId64 ", pid=%{public}u",
-        id, pid);
-    std::lock_guard<std::mutex> lock(proxyMutex_);
-    uint64_t key = GetProxyKey(uid, pid);
     auto it = proxyTimers_.find(key);
-    if (it != proxyTimers_.end()) {
-        it->second.erase(std::remove_if(it->second.begin(), it->second.end(),
-            [id](uint64_t timerId) { return timerId == id; }), it->second.end());
+    if (it == proxyTimers_.end()) {
+        return;
+    }
+    for (auto id : it->second) {
+        auto itIndex = timerProxyKeyIndex_.find(id);
+        if (itIndex == timerProxyKeyIndex_.end()) {
+            continue;
+        }
+        auto &keys = itIndex->second;
+        keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+        if (keys.empty()) {
+            timerProxyKeyIndex_.erase(itIndex);
+        }
     }
+    proxyTimers_.erase(it);
+}
+
+// needs to acquire the lock `proxyMutex_` before calling this method
+void TimerProxy::PublishProxyKeysLocked()
+{
+    auto keys = std::make_shared<ProxyKeySet>();
+    keys->reserve(proxyTimers_.size());
+    for (const auto &item : proxyTimers_) {
+        keys->insert(item.first);
+    }
+    bool hasKeys = !keys->empty();
+    std::atomic_store_explicit(&proxyKeys_, std::shared_ptr<const ProxyKeySet>(std::move(keys)),
+        std::memory_order_release);
+    hasProxyKeys_.store(hasKeys, std::memory_order_release);
+}
+
+std::shared_ptr<const TimerProxy::ProxyKeySet> TimerProxy::LoadProxyKeys()
+{
+    return std::atomic_load_explicit(&proxyKeys_, std::memory_order_acquire);
 }
 
 void TimerProxy::EraseAlarmItem(
@@ -198,7 +270,7 @@ void TimerProxy::EraseAlarmItem(
 
 int32_t TimerProxy::CountUidTimerMapByUid(int32_t uid)
 {
-    std::lock_guard<std::mutex> lock(uidTimersMutex_);
+    TimerLockGuard lock(uidTimersMutex_);
     auto it = uidTimersMap_.find(uid);
     if (it == uidTimersMap_.end()) {
         return 0;
@@ -217,7 +289,8 @@ void TimerProxy::RecordUidTimerMap(const std::shared_ptr<TimerInfo> &alarm, cons
         return;
     }
 
-    std::lock_guard<std::mutex> lock(uidTimersMutex_);
+    TimerLockGuard lock(uidTimersMutex_);
+    timerUidIndex_[alarm->id] = alarm->uid;
     auto it = uidTimersMap_.find(alarm->uid);
     if (it == uidTimersMap_.end()) {
         std::unordered_map<uint64_t, std::shared_ptr<TimerInfo>> idAlarmsMap;
@@ -237,16 +310,8 @@ void TimerProxy::RemoveUidTimerMap(const std::shared_ptr<TimerInfo> &alarm)
         return;
     }
 
-    std::lock_guard<std::mutex> lock(uidTimersMutex_);
-    auto it = uidTimersMap_.find(alarm->uid);
-    if (it == uidTimersMap_.end()) {
-        return;
-    }
-
-    EraseAlarmItem(alarm->id, it->second);
-    if (it->second.empty()) {
-        uidTimersMap_.erase(it);
-    }
+    TimerLockGuard lock(uidTimersMutex_);
+    RemoveUidTimerMapLocked(alarm);
 }
 
 void TimerProxy::RemoveUidTimerMapLocked(const std::shared_ptr<TimerInfo> &alarm)
@@ -255,6 +320,7 @@ void TimerProxy::RemoveUidTimerMapLocked(const std::shared_ptr<TimerInfo> &alarm
         TIME_HILOGE(TIME_MODULE_SERVICE, "remove uid timer map alarm is nullptr!");
         return;
     }
+    timerUidIndex_.erase(alarm->id);
     auto it = uidTimersMap_.find(alarm->uid);
     if (it == uidTimersMap_.end()) {
         return;
@@ -267,7 +333,7 @@ void TimerProxy::RemoveUidTimerMapLocked(const std::shared_ptr<TimerInfo> &alarm
 
 void TimerProxy::RecordProxyTimerMap(const std::shared_ptr<TimerInfo> &alarm, bool isPid)
 {
-    std::lock_guard<std::mutex> lock(proxyMutex_);
+    TimerLockGuard lock(proxyMutex_);
     auto uid = alarm->uid;
     auto pid = alarm->pid;
     uint64_t key;
@@ -278,50 +344,49 @@ void TimerProxy::RecordProxyTimerMap(const std::shared_ptr<TimerInfo> &alarm, bo
     }
     auto it = proxyTimers_.find(key);
     if (it != proxyTimers_.end()) {
-        proxyTimers_[key].push_back(alarm->id);
-    } else {
-        proxyTimers_.insert(std::make_pair(key, std::vector<uint64_t>{alarm->id}));
+        it->second.insert(alarm->id);
+        IndexProxyTimerLocked(alarm->id, key);
+        return;
     }
+    proxyTimers_.emplace(key, std::unordered_set<uint64_t>{alarm->id});
+    IndexProxyTimerLocked(alarm->id, key);
+    PublishProxyKeysLocked();
 }
 
 void TimerProxy::RemoveUidTimerMap(const uint64_t id)
 {
-    std::lock_guard<std::mutex> lock(uidTimersMutex_);
-    for (auto itUidsTimer = uidTimersMap_.begin(); itUidsTimer!= uidTimersMap_.end(); ++itUidsTimer) {
-        for (auto itTimerId = itUidsTimer->second.begin(); itTimerId!= itUidsTimer->second.end(); ++itTimerId) {
-            if (itTimerId->first != id) {
-                continue;
-            }
-
-            itUidsTimer->second.erase(itTimerId);
-            if (itUidsTimer->second.empty()) {
-                uidTimersMap_.erase(itUidsTimer);
-            }
-            return;
-        }
+    TimerLockGuard lock(uidTimersMutex_);
+    auto itIndex = timerUidIndex_.find(id);
+    if (itIndex == timerUidIndex_.end()) {
+        return;
+    }
+    auto itUidsTimer = uidTimersMap_.find(itIndex->second);
+    timerUidIndex_.erase(itIndex);
+    if (itUidsTimer == uidTimersMap_.end()) {
+        return;
+    }
+    itUidsTimer->second.erase(id);
+    if (itUidsTimer->second.empty()) {
+        uidTimersMap_.erase(itUidsTimer);
     }
 }
 
 bool TimerProxy::IsProxy(const int32_t uid, const int32_t pid)
 {
-    std::lock_guard<std::mutex> lock(proxyMutex_);
-    uint64_t key = GetProxyKey(uid, pid);
-    auto it = proxyTimers_.find(key);
-    if (it == proxyTimers_.end()) {
+    if (!hasProxyKeys_.load(std::memory_order_acquire)) {
         return false;
     }
-    return true;
+    auto keys = LoadProxyKeys();
+    return keys->find(GetProxyKey(uid, pid)) != keys->end();
 }
 
-// needs to acquire the lock `proxyMutex_` before calling this method
-bool TimerProxy::IsProxyLocked(const int32_t uid, const int32_t pid)
+bool TimerProxy::IsUidOrPidProxy(const int32_t uid, const int32_t pid)
 {
-    uint64_t key = GetProxyKey(uid, pid);
-    auto it = proxyTimers_.find(key);
-    if (it == proxyTimers_.end()) {
+    if (!hasProxyKeys_.load(std::memory_order_acquire)) {
         return false;
     }
-    return true;
+    auto keys = LoadProxyKeys();
+    return keys->find(GetProxyKey(uid, 0)) != keys->end() || keys->find(GetProxyKey(uid, pid)) != keys->end();
 }
 
 void TimerProxy::UpdateProxyWhenElapsedForProxyTimers(int32_t uid, int pid,
@@ -335,12 +400,13 @@ void TimerProxy::UpdateProxyWhenElapsedForProxyTimers(int32_t uid, int pid,
         TIME_HILOGD(TIME_MODULE_SERVICE, "uid:%{public}d pid:%{public}d is already proxy", uid, pid);
         return;
     }
-    std::lock_guard<std::mutex> lockUidTimers(uidTimersMutex_);
-    std::vector<uint64_t> timerList;
+    TimerLockGuard lockUidTimers(uidTimersMutex_);
+    std::unordered_set<uint64_t> timerList;
     auto itUidTimersMap = uidTimersMap_.find(uid);
     if (itUidTimersMap == uidTimersMap_.end()) {
         TIME_HILOGD(TIME_MODULE_SERVICE, "uid:%{public}d in map not found", uid);
         proxyTimers_[key] = timerList;
+        PublishProxyKeysLocked();
         return;
     }
 
@@ -349,7 +415,7 @@ void TimerProxy::UpdateProxyWhenElapsedForProxyTimers(int32_t uid, int pid,
         if (pid == 0 || pid == itTimerInfo->second->pid) {
             if (!needRetrigger) {
                 insertAlarmCallback(itTimerInfo->second, false);
-                break;
+                continue;
             }
             itTimerInfo->second->ProxyTimer(now, milliseconds(proxyDelayTime_));
             TIME_HILOGD(TIME_MODULE_SERVICE, "Update proxy WhenElapsed for proxy pid map. "
@@ -358,10 +424,12 @@ void TimerProxy::UpdateProxyWhenElapsedForProxyTimers(int32_t uid, int pid,
                 itTimerInfo->second->whenElapsed.time_since_epoch().count(),
                 now.time_since_epoch().count());
             insertAlarmCallback(itTimerInfo->second, true);
-            timerList.push_back(itTimerInfo->first);
+            timerList.insert(itTimerInfo->first);
+            IndexProxyTimerLocked(itTimerInfo->first, key);
         }
     }
-    proxyTimers_[key] = timerList;
+    proxyTimers_[key] = std::move(timerList);
+    PublishProxyKeysLocked();
 }
 
 bool TimerProxy::RestoreProxyWhenElapsed(const int uid, const int pid,
@@ -375,7 +443,7 @@ bool TimerProxy::RestoreProxyWhenElapsed(const int uid, const int pid,
         TIME_HILOGD(TIME_MODULE_SERVICE, "uid:%{public}d pid:%{public}d not in proxy", uid, pid);
         return false;
     }
-    std::lock_guard<std::mutex> lockPidTimers(uidTimersMutex_);
+    TimerLockGuard lockPidTimers(uidTimersMutex_);
     auto itTimer = uidTimersMap_.find(uid);
     if (uidTimersMap_.find(uid) == uidTimersMap_.end()) {
         TIME_HILOGD(TIME_MODULE_SERVICE, "uid:%{public}d timer info not found, erase proxy map", uid);
@@ -406,7 +474,8 @@ bool TimerProxy::RestoreProxyWhenElapsedForProxyTimers(const int uid, const int
     uint64_t key = GetProxyKey(uid, pid);
     bool ret = RestoreProxyWhenElapsed(uid, pid, now, insertAlarmCallback, needRetrigger);
     if (ret) {
-        proxyTimers_.erase(key);
+        EraseProxyKeyLocked(key);
+        PublishProxyKeysLocked();
     }
     return ret;
 }
@@ -414,25 +483,61 @@ bool TimerProxy::RestoreProxyWhenElapsedForProxyTimers(const int uid, const int
 void TimerProxy::ResetAllProxyWhenElapsed(const std::chrono::steady_clock::time_point &now,
     std::function<void(std::shared_ptr<TimerInfo> &alarm, bool needRetrigger)> insertAlarmCallback)
 {
-    std::lock_guard<std::mutex> lockProxy(proxyMutex_);
+    TimerLockGuard lockProxy(proxyMutex_);
     for (auto it = proxyTimers_.begin(); it != proxyTimers_.end(); ++it) {
         auto resPair = ParseProxyKey(it->first);
         RestoreProxyWhenElapsed(resPair.first, resPair.second, now, insertAlarmCallback, true);
     }
     proxyTimers_.clear();
+    timerProxyKeyIndex_.clear();
+    PublishProxyKeysLocked();
 }
 
 #ifdef HIDUMPER_ENABLE
+// <(uid << 32) | pid, [timerid]>
+std::vector<std::pair<uint64_t, std::vector<uint64_t>>> TimerProxy::GetProxyTimerSnapshot()
+{
+    std::vector<std::pair<uint64_t, std::vector<uint64_t>>> proxyTimers;
+    TimerLockGuard lockPidProxy(proxyMutex_);
+    proxyTimers.reserve(proxyTimers_.size());
+    for (const auto &proxyTimer : proxyTimers_) {
+        proxyTimers.emplace_back(proxyTimer.first,
+            std::vector<uint64_t>(proxyTimer.second.begin(), proxyTimer.second.end()));
+    }
+    return proxyTimers;
+}
+
+// <uid, timer id, whenElapsed in ns>
+std::vector<std::tuple<int32_t, uint64_t, int64_t>> TimerProxy::GetUidTimerSnapshot()
+{
+    std::vector<std::tuple<int32_t, uint64_t, int64_t>> uidTimers;
+    TimerLockGuard lockProxy(uidTimersMutex_);
+    uidTimers.reserve(timerUidIndex_.size());
+    for (const auto &uidTimer : uidTimersMap_) {
+        for (const auto &timer : uidTimer.second) {
+            uidTimers.emplace_back(uidTimer.first, timer.second->id,
+                timer.second->whenElapsed.time_since_epoch().count());
+        }
+    }
+    return uidTimers;
+}
+
+std::vector<uint64_t> TimerProxy::GetAdjustTimerSnapshot()
+{
+    TimerLockGuard lockProxy(adjustMutex_);
+    return std::vector<uint64_t>(adjustTimers_.begin(), adjustTimers_.end());
+}
+
 bool TimerProxy::ShowProxyTimerInfo(int fd, const int64_t now)
 {
     TIME_HILOGD(TIME_MODULE_SERVICE, "start");
-    std::lock_guard<std::mutex> lockPidProxy(proxyMutex_);
-    dprintf(fd, "current time %lld\n", now);
-    for (auto itProxyPids = proxyTimers_.begin(); itProxyPids != proxyTimers_.end(); ++itProxyPids) {
-        auto resPair = ParseProxyKey(itProxyPids->first);
-        dprintf(fd, " - proxy uid = %lu pid = %lu\n", resPair.first, resPair.second);
-        for (auto elem : itProxyPids->second) {
-            dprintf(fd, "   * save timer id          = %llu\n", elem);
+    auto proxyTimers = GetProxyTimerSnapshot();
+    dprintf(fd, "current time %" PRId64 "\n", now);
+    for (const auto &proxyTimer : proxyTimers) {
+        auto resPair = ParseProxyKey(proxyTimer.first);
+        dprintf(fd, " - proxy uid = %d pid = %d\n", resPair.first, resPair.second);
+        for (auto elem : proxyTimer.second) {
+            dprintf(fd, "   * save timer id          = %" PRIu64 "\n", elem);
         }
     }
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
@@ -442,15 +547,15 @@ bool TimerProxy::ShowProxyTimerInfo(int fd, const int64_t now)
 bool TimerProxy::ShowUidTimerMapInfo(int fd, const int64_t now)
 {
     TIME_HILOGD(TIME_MODULE_SERVICE, "start");
-    std::lock_guard<std::mutex> lockProxy(uidTimersMutex_);
-    dprintf(fd, "current time %lld\n", now);
-    for (auto itTimerInfoMap = uidTimersMap_.begin(); itTimerInfoMap != uidTimersMap_.end(); ++itTimerInfoMap) {
-            dprintf(fd, " - uid = %lu\n", itTimerInfoMap->first);
-        for (auto itTimerInfo = itTimerInfoMap->second.begin(); itTimerInfo != itTimerInfoMap->second.end();
-            ++itTimerInfo) {
-            dprintf(fd, "   * timer id          = %llu\n", itTimerInfo->second->id);
-            dprintf(fd, "   * timer whenElapsed = %lld\n", itTimerInfo->second->whenElapsed.time_since_epoch().count());
+    auto uidTimers = GetUidTimerSnapshot();
+    std::sort(uidTimers.begin(), uidTimers.end());
+    dprintf(fd, "current time %" PRId64 "\n", now);
+    for (size_t i = 0; i < uidTimers.size(); i++) {
+        if (i == 0 || std::get<0>(uidTimers[i]) != std::get<0>(uidTimers[i - 1])) {
+            dprintf(fd, " - uid = %d\n", std::get<0>(uidTimers[i]));
         }
+        dprintf(fd, "   * timer id          = %" PRIu64 "\n", std::get<1>(uidTimers[i]));
+        dprintf(fd, "   * timer whenElapsed = %" PRId64 "\n", std::get<2>(uidTimers[i]));
     }
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
     return true;
@@ -458,20 +563,50 @@ bool TimerProxy::ShowUidTimerMapInfo(int fd, const int64_t now)
 
 void TimerProxy::ShowAdjustTimerInfo(int fd)
 {
-    std::lock_guard<std::mutex> lockProxy(adjustMutex_);
+    auto adjustTimers = GetAdjustTimerSnapshot();
     dprintf(fd, "show adjust timer");
-    for (auto timerId : adjustTimers_) {
-        dprintf(fd, " * timer id            = %lu\n", timerId);
+    for (auto timerId : adjustTimers) {
+        dprintf(fd, " * timer id            = %" PRIu64 "\n", timerId);
     }
 }
 
 bool TimerProxy::ShowProxyDelayTime(int fd)
 {
     TIME_HILOGD(TIME_MODULE_SERVICE, "start");
-    dprintf(fd, "proxy delay time:%lld ms\n", proxyDelayTime_);
+    dprintf(fd, "proxy delay time:%" PRId64 " ms\n", proxyDelayTime_);
     TIME_HILOGD(TIME_MODULE_SERVICE, "end");
     return true;
 }
+
+void TimerProxy::ShowJsonLines(int fd)
+{
+    auto proxyTimers = GetProxyTimerSnapshot();
+    auto uidTimers = GetUidTimerSnapshot();
+    auto adjustTimers = GetAdjustTimerSnapshot();
+    JsonLinesWriter writer(fd);
+    for (const auto &proxyTimer : proxyTimers) {
+        auto resPair = ParseProxyKey(proxyTimer.first);
+        writer.Begin("proxy")
+            .AddInt("uid", resPair.first)
+            .AddInt("pid", resPair.second)
+            .AddUintArray("ids", proxyTimer.second)
+            .End();
+    }
+    for (const auto &uidTimer : uidTimers) {
+        writer.Begin("uid_timer")
+            .AddInt("uid", std::get<0>(uidTimer))
+            .AddUint("id", std::get<1>(uidTimer))
+            .AddInt("when", std::get<2>(uidTimer))
+            .End();
+    }
+    writer.Begin("adjust_timers").AddUintArray("ids", adjustTimers).End();
+    writer.Begin("proxy_counters")
+        .AddUint("proxy_keys", proxyTimers.size())
+        .AddUint("uid_timers", uidTimers.size())
+        .AddUint("adjust_timers", adjustTimers.size())
+        .AddInt("proxy_delay", proxyDelayTime_)
+        .End();
+}
 #endif
 
 int64_t TimerProxy::GetProxyDelayTime() const
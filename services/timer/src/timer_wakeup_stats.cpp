@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "timer_wakeup_stats.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "time_sysevent.h"
+#include "time_task_executor.h"
+#include "timer_platform.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+// executor key and length of a window
+constexpr const char* WINDOW_TASK = "timer_wakeup_window";
+constexpr int64_t WINDOW_LENGTH = 60 * 60 * 1000;
+constexpr int64_t SECOND_TO_MILLI = 1000;
+constexpr uint32_t RTC_WAKEUP_MASK = 1 << TimerTypes::RTC_WAKEUP;
+constexpr uint32_t ELAPSED_WAKEUP_MASK = 1 << TimerTypes::ELAPSED_REALTIME_WAKEUP;
+// the uid of a wakeup at which no wakeup timer was due
+constexpr int32_t UNATTRIBUTED_UID = -1;
+// rows of the statistic event
+constexpr size_t MAX_REPORT_UIDS = 20;
+constexpr size_t SHOW_UIDS = 10;
+constexpr const char* BATCH_SIZE_NAMES[] = { "1", "2", "3-4", "5-8", "9+" };
+
+size_t GetBatchSizeBucket(size_t size)
+{
+    constexpr size_t bounds[] = { 1, 2, 4, 8 };
+    size_t bucket = 0;
+    while (bucket < sizeof(bounds) / sizeof(bounds[0]) && size > bounds[bucket]) {
+        bucket++;
+    }
+    return bucket;
+}
+}
+
+TimerWakeupStats &TimerWakeupStats::GetInstance()
+{
+    static TimerWakeupStats instance;
+    return instance;
+}
+
+int64_t TimerWakeupStats::GetBootTimeMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        TimerPlatform::GetInstance().GetBootTime().time_since_epoch()).count();
+}
+
+void TimerWakeupStats::RecordWakeup(uint32_t fired, const std::vector<std::shared_ptr<TimerInfo>> &timers)
+{
+    if ((fired & (RTC_WAKEUP_MASK | ELAPSED_WAKEUP_MASK)) == 0) {
+        return;
+    }
+    std::shared_ptr<TimerInfo> charged;
+    for (const auto &timer : timers) {
+        if (timer->wakeup && (charged == nullptr || timer->whenElapsed < charged->whenElapsed)) {
+            charged = timer;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &window = current_;
+    window.wakeups++;
+    window.rtcWakeups += ((fired & RTC_WAKEUP_MASK) != 0) ? 1 : 0;
+    window.elapsedWakeups += ((fired & ELAPSED_WAKEUP_MASK) != 0) ? 1 : 0;
+    window.timers += timers.size();
+    window.batchSizes[GetBatchSizeBucket(timers.size())]++;
+    auto &chargedStats = window.uids[(charged != nullptr) ? charged->uid : UNATTRIBUTED_UID];
+    chargedStats.wakeups++;
+    if (charged != nullptr) {
+        auto end = chargedStats.timers.begin() + chargedStats.timerCount;
+        auto it = std::find_if(chargedStats.timers.begin(), end,
+            [&charged](const TimerCount &count) { return count.id == charged->id; });
+        if (it != end) {
+            it->wakeups++;
+        } else if (chargedStats.timerCount < MAX_TIMER_NAMES) {
+            chargedStats.timers[chargedStats.timerCount++] = { charged->id, charged, 1 };
+        } else {
+            chargedStats.otherWakeups++;
+        }
+    }
+    for (const auto &timer : timers) {
+        if (timer == charged) {
+            continue;
+        }
+        // a timer of the charged uid is not a free rider, its uid woke the device anyway
+        if (charged != nullptr && timer->uid == charged->uid) {
+            continue;
+        }
+        chargedStats.riders++;
+        window.uids[timer->uid].rides++;
+    }
+}
+
+void TimerWakeupStats::StartReport()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (current_.start == 0) {
+            current_.start = GetBootTimeMs();
+        }
+    }
+    auto close = [this]() {
+        CloseWindow();
+        StartReport();
+    };
+    // periodic, so a full executor queue can not end the chain; a coalesced post leaves the pending task running it
+    TimeTaskExecutor::GetInstance().PostPeriodic(WINDOW_TASK, close, WINDOW_LENGTH);
+}
+
+std::string TimerWakeupStats::GetTimerName(const TimerCount &count)
+{
+    auto timer = count.timer.lock();
+    return (timer != nullptr) ? timer->name : "id " + std::to_string(count.id);
+}
+
+void TimerWakeupStats::CloseWindow()
+{
+    Window window;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t now = GetBootTimeMs();
+        current_.end = now;
+        window = current_;
+        closed_.push_back(std::move(current_));
+        if (closed_.size() > WINDOW_COUNT) {
+            closed_.pop_front();
+        }
+        current_ = Window();
+        current_.start = now;
+        if (window.wakeups > 0) {
+            reports_++;
+        }
+    }
+    // the names are looked up and the event is written after releasing the lock
+    if (window.wakeups > 0) {
+        std::vector<std::pair<int32_t, const UidStats *>> rows;
+        for (const auto &uid : window.uids) {
+            rows.emplace_back(uid.first, &uid.second);
+        }
+        std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+            return (a.second->wakeups != b.second->wakeups) ? a.second->wakeups > b.second->wakeups :
+                a.second->rides > b.second->rides;
+        });
+        rows.resize(std::min(rows.size(), MAX_REPORT_UIDS));
+        TimerWakeupStatistic statistic;
+        statistic.window = (window.end - window.start) / SECOND_TO_MILLI;
+        statistic.wakeups = static_cast<int64_t>(window.wakeups);
+        statistic.timers = static_cast<int64_t>(window.timers);
+        for (const auto &row : rows) {
+            statistic.uids.push_back(row.first);
+            statistic.chargedWakeups.push_back(static_cast<int64_t>(row.second->wakeups));
+            statistic.riders.push_back(static_cast<int64_t>(row.second->riders));
+            statistic.rides.push_back(static_cast<int64_t>(row.second->rides));
+            auto end = row.second->timers.begin() + row.second->timerCount;
+            auto top = std::max_element(row.second->timers.begin(), end,
+                [](const TimerCount &a, const TimerCount &b) { return a.wakeups < b.wakeups; });
+            statistic.topTimers.push_back((top != end) ? GetTimerName(*top) : "");
+        }
+        TimerWakeupReporter(statistic);
+    }
+}
+
+void TimerWakeupStats::ShowWindow(int fd, const Window &window)
+{
+    dprintf(fd, "   * wakeups               = %" PRIu64 " (rtc %" PRIu64 ", elapsed %" PRIu64 ")\n", window.wakeups,
+        window.rtcWakeups, window.elapsedWakeups);
+    dprintf(fd, "   * timers due            = %" PRIu64 "\n", window.timers);
+    for (size_t i = 0; i < BATCH_SIZE_BUCKETS; i++) {
+        if (window.batchSizes[i] > 0) {
+            dprintf(fd, "   * batch size %-11s= %" PRIu64 "\n", BATCH_SIZE_NAMES[i], window.batchSizes[i]);
+        }
+    }
+    std::vector<std::pair<int32_t, const UidStats *>> rows;
+    for (const auto &uid : window.uids) {
+        rows.emplace_back(uid.first, &uid.second);
+    }
+    std::sort(rows.begin(), rows.end(),
+        [](const auto &a, const auto &b) { return a.second->wakeups > b.second->wakeups; });
+    rows.resize(std::min(rows.size(), SHOW_UIDS));
+    for (const auto &row : rows) {
+        dprintf(fd, "   * uid                   = %d\n", row.first);
+        dprintf(fd, "     * wakeups             = %" PRIu64 "\n", row.second->wakeups);
+        dprintf(fd, "     * riders              = %" PRIu64 "\n", row.second->riders);
+        dprintf(fd, "     * rides               = %" PRIu64 "\n", row.second->rides);
+        for (size_t i = 0; i < row.second->timerCount; i++) {
+            const auto &count = row.second->timers[i];
+            dprintf(fd, "     * timer               = %s: %" PRIu64 "\n", GetTimerName(count).c_str(),
+                count.wakeups);
+        }
+        if (row.second->otherWakeups > 0) {
+            dprintf(fd, "     * timer               = (others): %" PRIu64 "\n", row.second->otherWakeups);
+        }
+    }
+}
+
+void TimerWakeupStats::ShowWakeupInfo(int fd)
+{
+    int64_t now = GetBootTimeMs();
+    Window current;
+    std::deque<Window> closed;
+    uint64_t reports = 0;
+    {
+        // copied under the lock, the looper is not held up while the dump is written
+        std::lock_guard<std::mutex> lock(mutex_);
+        current = current_;
+        closed = closed_;
+        reports = reports_;
+    }
+    dprintf(fd, " * window                  = open, %" PRId64 "s\n", (now - current.start) / SECOND_TO_MILLI);
+    ShowWindow(fd, current);
+    for (auto it = closed.rbegin(); it != closed.rend(); ++it) {
+        dprintf(fd, " * window                  = %" PRId64 "s to %" PRId64 "s ago\n",
+            (now - it->start) / SECOND_TO_MILLI, (now - it->end) / SECOND_TO_MILLI);
+        ShowWindow(fd, *it);
+    }
+    dprintf(fd, " * statistic events        = %" PRIu64 "\n", reports);
+}
+} // namespace MiscServices
+} // namespace OHOS
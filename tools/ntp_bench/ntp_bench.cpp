@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "ntp_responder.h"
+#include "parameters.h"
+
+#define private public
+#include "ntp_resolver.h"
+#include "ntp_sync_history.h"
+#include "ntp_trusted_time.h"
+#include "ntp_update_time.h"
+#include "sntp_query_engine.h"
+#undef private
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr const char* LOOPBACK = "127.0.0.1";
+constexpr const char* NTP_TIME_RESULT_SYSTEM_PARAMETER = "persist.time.ntp_time_result";
+// the local clock is off by this much, every honest responder agrees on it
+constexpr int64_t TRUE_OFFSET = 1500;
+constexpr int64_t WRONG_TIME_ERROR = 60000;
+constexpr int DEFAULT_ITERATIONS = 10;
+constexpr double P50 = 0.5;
+constexpr double P90 = 0.9;
+constexpr int64_t NANO_TO_MILLI = 1000000;
+constexpr int64_t MILLI_TO_SECOND = 1000;
+
+struct Scenario {
+    const char *name;
+    std::vector<NtpResponderConfig> servers;
+    bool expectSync;
+    // time-to-sync above this at the 90th percentile is a regression
+    int64_t budget;
+};
+
+struct RunResult {
+    bool synced = false;
+    int64_t syncTime = 0;
+    uint64_t requests = 0;
+    uint64_t replies = 0;
+    int64_t error = 0;
+};
+
+NtpResponderConfig Honest(int64_t delayMs, int64_t jitterMs = 0)
+{
+    NtpResponderConfig config;
+    config.offsetMs = TRUE_OFFSET;
+    config.delayMs = delayMs;
+    config.jitterMs = jitterMs;
+    return config;
+}
+
+NtpResponderConfig Lossy(int64_t delayMs, double lossRate)
+{
+    NtpResponderConfig config = Honest(delayMs);
+    config.lossRate = lossRate;
+    return config;
+}
+
+NtpResponderConfig WrongTime(int64_t delayMs)
+{
+    NtpResponderConfig config = Honest(delayMs);
+    config.offsetMs += WRONG_TIME_ERROR;
+    return config;
+}
+
+NtpResponderConfig KissOfDeath(int64_t delayMs)
+{
+    NtpResponderConfig config = Honest(delayMs);
+    config.kissOfDeath = true;
+    return config;
+}
+
+std::vector<Scenario> GetScenarios()
+{
+    return {
+        { "ideal", { Honest(10), Honest(10), Honest(10), Honest(10) }, true, 500 },
+        { "jitter", { Honest(40, 30), Honest(40, 30), Honest(40, 30), Honest(40, 30) }, true, 1000 },
+        { "loss", { Lossy(10, 0.3), Lossy(10, 0.3), Lossy(10, 0.3), Lossy(10, 0.3) }, true, 2500 },
+        { "kiss_of_death", { KissOfDeath(10), KissOfDeath(10), Honest(10), Honest(10), Honest(10) }, true, 1000 },
+        { "wrong_time", { WrongTime(10), WrongTime(10), Honest(10), Honest(10), Honest(10) }, true, 1000 },
+        { "slow_server", { Honest(10), Honest(10), Honest(10), Honest(800) }, true, 1000 },
+        // every round runs into the query deadline
+        { "unreachable", { Lossy(10, 1), Lossy(10, 1), Lossy(10, 1) }, false, 11000 },
+    };
+}
+
+int64_t GetClockMs(clockid_t clock)
+{
+    struct timespec tv {};
+    clock_gettime(clock, &tv);
+    return static_cast<int64_t>(tv.tv_sec) * MILLI_TO_SECOND + tv.tv_nsec / NANO_TO_MILLI;
+}
+
+int64_t Percentile(std::vector<int64_t> values, double percentile)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>((values.size() - 1) * percentile)];
+}
+
+// Forgets everything learned from the previous run, so each run is a sync from scratch.
+void ResetSyncState()
+{
+    auto &trustedTime = NtpTrustedTime::GetInstance();
+    {
+        std::lock_guard<std::mutex> lock(NtpTrustedTime::mTimeResultMutex_);
+        trustedTime.mTimeResult = nullptr;
+    }
+    trustedTime.ClearTimeResultCandidates();
+    NtpResolver::GetInstance().ClearCache();
+}
+
+RunResult RunOnce(const std::vector<std::unique_ptr<NtpResponder>> &responders, const std::string &servers)
+{
+    ResetSyncState();
+    for (auto &responder : responders) {
+        responder->ResetCounters();
+    }
+    RunResult result;
+    {
+        std::lock_guard<std::mutex> lock(NtpUpdateTime::requestMutex_);
+        NtpUpdateTime::autoTimeInfo_.ntpServer = servers;
+        NtpUpdateTime::autoTimeInfo_.ntpServerSpec = "";
+        int64_t start = GetClockMs(CLOCK_MONOTONIC);
+        result.synced = NtpUpdateTime::GetNtpTimeInner(RETRY_BY_TIMER) == REFRESH_SUCCESS;
+        result.syncTime = GetClockMs(CLOCK_MONOTONIC) - start;
+    }
+    for (auto &responder : responders) {
+        result.requests += responder->GetRequestCount();
+        result.replies += responder->GetReplyCount();
+    }
+    if (result.synced) {
+        int64_t trustedTime = NtpTrustedTime::GetInstance().CurrentTimeMillis();
+        result.error = trustedTime - (GetClockMs(CLOCK_REALTIME) + TRUE_OFFSET);
+    }
+    return result;
+}
+
+bool RunScenario(const Scenario &scenario, int iterations)
+{
+    std::vector<std::unique_ptr<NtpResponder>> responders;
+    std::string servers;
+    for (size_t i = 0; i < scenario.servers.size(); i++) {
+        auto responder = std::make_unique<NtpResponder>(scenario.servers[i], static_cast<uint32_t>(i));
+        if (!responder->Start(LOOPBACK)) {
+            printf("%-14s failed to start responder\n", scenario.name);
+            return false;
+        }
+        servers += (servers.empty() ? "" : ",") + responder->GetAddress();
+        responders.push_back(std::move(responder));
+    }
+    std::vector<int64_t> syncTimes;
+    std::vector<int64_t> errors;
+    uint64_t requests = 0;
+    uint64_t replies = 0;
+    int synced = 0;
+    for (int i = 0; i < iterations; i++) {
+        RunResult result = RunOnce(responders, servers);
+        syncTimes.push_back(result.syncTime);
+        requests += result.requests;
+        replies += result.replies;
+        if (result.synced) {
+            synced++;
+            errors.push_back(std::abs(result.error));
+        }
+    }
+    int64_t errorSum = 0;
+    for (auto error : errors) {
+        errorSum += error;
+    }
+    int64_t p90 = Percentile(syncTimes, P90);
+    bool passed = (scenario.expectSync ? synced == iterations : synced == 0) && p90 <= scenario.budget;
+    printf("%-14s %5d %6d %8" PRId64 " %8" PRId64 " %8" PRId64 " %7.1f %7.1f %8" PRId64 " %8" PRId64 " %s\n",
+        scenario.name, iterations, synced, Percentile(syncTimes, P50), p90, Percentile(syncTimes, 1),
+        static_cast<double>(requests) / iterations, static_cast<double>(replies) / iterations,
+        errors.empty() ? 0 : errorSum / static_cast<int64_t>(errors.size()), Percentile(errors, 1),
+        passed ? "ok" : "REGRESSION");
+    return passed;
+}
+
+void Usage(const char *name)
+{
+    printf("usage: %s [-n iterations] [-s scenario] [-l]\n", name);
+    printf("  -l  dump the sync history of every attempt\n");
+    printf("scenarios:");
+    for (const auto &scenario : GetScenarios()) {
+        printf(" %s", scenario.name);
+    }
+    printf("\n");
+}
+} // namespace
+} // namespace MiscServices
+} // namespace OHOS
+
+using namespace OHOS::MiscServices;
+
+int main(int argc, char *argv[])
+{
+    int iterations = DEFAULT_ITERATIONS;
+    std::string filter;
+    bool showHistory = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:lh")) != -1) {
+        if (opt == 'n') {
+            iterations = std::max(1, atoi(optarg));
+        } else if (opt == 's') {
+            filter = optarg;
+        } else if (opt == 'l') {
+            showHistory = true;
+        } else {
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    // every accepted result is persisted, the device keeps its own one
+    std::string savedTimeResult = OHOS::system::GetParameter(NTP_TIME_RESULT_SYSTEM_PARAMETER, "");
+    printf("%-14s %5s %6s %8s %8s %8s %7s %7s %8s %8s\n", "scenario", "runs", "synced", "p50(ms)", "p90(ms)",
+        "max(ms)", "req", "rsp", "err(ms)", "max_err");
+    bool passed = true;
+    for (const auto &scenario : GetScenarios()) {
+        if (filter.empty() || filter == scenario.name) {
+            passed = RunScenario(scenario, iterations) && passed;
+        }
+    }
+    printf("\nper server:\n");
+    fflush(stdout);
+    SntpQueryEngine::GetInstance().ShowServerStats(STDOUT_FILENO);
+    if (showHistory) {
+        printf("\nsync history:\n");
+        fflush(stdout);
+        NtpSyncHistory::GetInstance().ShowSyncHistory(STDOUT_FILENO);
+    }
+    ResetSyncState();
+    OHOS::system::SetParameter(NTP_TIME_RESULT_SYSTEM_PARAMETER, savedTimeResult);
+    return passed ? 0 : 1;
+}
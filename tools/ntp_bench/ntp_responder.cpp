@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ntp_responder.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr uint64_t SECONDS_SINCE_FIRST_EPOCH = 2208988800;
+constexpr uint64_t FRACTION_TO_SECOND = 0x100000000;
+constexpr int64_t NANO_TO_SECOND = 1000000000;
+constexpr int64_t NANO_TO_MILLI = 1000000;
+constexpr int64_t HALF = 2;
+// idle poll timeout, bounds how long Stop waits for the thread
+constexpr int IDLE_TIMEOUT = 10;
+constexpr size_t MODE_INDEX = 0;
+constexpr size_t STRATUM_INDEX = 1;
+constexpr size_t POLL_INDEX = 2;
+constexpr size_t PRECISION_INDEX = 3;
+constexpr size_t REFERENCE_ID_INDEX = 12;
+constexpr size_t REFERENCE_TIME_INDEX = 16;
+constexpr size_t ORIGINATE_TIME_INDEX = 24;
+constexpr size_t RECEIVE_TIME_INDEX = 32;
+constexpr size_t TRANSMIT_TIME_INDEX = 40;
+constexpr size_t TIMESTAMP_SIZE = 8;
+constexpr size_t REFERENCE_ID_SIZE = 4;
+constexpr uint8_t MODE_MASK = 0x07;
+constexpr uint8_t MODE_CLIENT = 3;
+constexpr uint8_t MODE_SERVER = 4;
+constexpr uint8_t VERSION_MASK = 0x38;
+constexpr uint8_t LEAP_UNSYNCHRONIZED = 0xC0;
+constexpr uint8_t SERVER_STRATUM = 2;
+constexpr uint8_t KISS_OF_DEATH_STRATUM = 0;
+// about one microsecond
+constexpr int8_t SERVER_PRECISION = -20;
+constexpr int BYTE_BITS = 8;
+constexpr int64_t REFERENCE_AGE = NANO_TO_SECOND;
+
+int64_t GetClockNs(clockid_t clock)
+{
+    struct timespec tv {};
+    clock_gettime(clock, &tv);
+    return static_cast<int64_t>(tv.tv_sec) * NANO_TO_SECOND + tv.tv_nsec;
+}
+
+void WriteTimestamp(uint8_t *buffer, int64_t unixNs)
+{
+    uint64_t second = static_cast<uint64_t>(unixNs / NANO_TO_SECOND) + SECONDS_SINCE_FIRST_EPOCH;
+    uint64_t fraction = static_cast<uint64_t>(unixNs % NANO_TO_SECOND) * FRACTION_TO_SECOND / NANO_TO_SECOND;
+    uint64_t value = (second << (TIMESTAMP_SIZE / HALF * BYTE_BITS)) | fraction;
+    for (size_t i = 0; i < TIMESTAMP_SIZE; i++) {
+        buffer[i] = static_cast<uint8_t>(value >> ((TIMESTAMP_SIZE - 1 - i) * BYTE_BITS));
+    }
+}
+}
+
+NtpResponder::NtpResponder(const NtpResponderConfig &config, uint32_t seed) : config_(config), random_(seed)
+{
+}
+
+NtpResponder::~NtpResponder()
+{
+    Stop();
+}
+
+bool NtpResponder::Start(const std::string &ip)
+{
+    struct sockaddr_storage addr {};
+    socklen_t addrLen = 0;
+    auto *addr4 = reinterpret_cast<struct sockaddr_in *>(&addr);
+    auto *addr6 = reinterpret_cast<struct sockaddr_in6 *>(&addr);
+    if (inet_pton(AF_INET, ip.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addrLen = sizeof(struct sockaddr_in);
+    } else if (inet_pton(AF_INET6, ip.c_str(), &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addrLen = sizeof(struct sockaddr_in6);
+    } else {
+        return false;
+    }
+    fd_ = socket(addr.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (fd_ < 0) {
+        return false;
+    }
+    if (bind(fd_, reinterpret_cast<struct sockaddr *>(&addr), addrLen) < 0 ||
+        getsockname(fd_, reinterpret_cast<struct sockaddr *>(&addr), &addrLen) < 0) {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    if (addr.ss_family == AF_INET) {
+        address_ = ip + ":" + std::to_string(ntohs(addr4->sin_port));
+    } else {
+        address_ = "[" + ip + "]:" + std::to_string(ntohs(addr6->sin6_port));
+    }
+    running_ = true;
+    thread_ = std::thread([this]() { Run(); });
+    return true;
+}
+
+void NtpResponder::Stop()
+{
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    pending_.clear();
+}
+
+std::string NtpResponder::GetAddress() const
+{
+    return address_;
+}
+
+uint64_t NtpResponder::GetRequestCount() const
+{
+    return requests_;
+}
+
+uint64_t NtpResponder::GetReplyCount() const
+{
+    return replies_;
+}
+
+void NtpResponder::ResetCounters()
+{
+    requests_ = 0;
+    replies_ = 0;
+}
+
+void NtpResponder::Run()
+{
+    while (running_) {
+        struct pollfd pfd {};
+        pfd.fd = fd_;
+        pfd.events = POLLIN;
+        int timeout = std::min(SendDueReplies(), IDLE_TIMEOUT);
+        if (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN) != 0) {
+            HandleRequest();
+        }
+    }
+}
+
+int64_t NtpResponder::RandomPathDelay()
+{
+    int64_t delay = config_.delayMs * NANO_TO_MILLI / HALF;
+    if (config_.jitterMs > 0) {
+        std::uniform_int_distribution<int64_t> jitter(0, config_.jitterMs * NANO_TO_MILLI);
+        delay += jitter(random_);
+    }
+    return delay;
+}
+
+void NtpResponder::HandleRequest()
+{
+    PendingReply reply;
+    uint8_t request[NTP_PACKET_SIZE] = { 0 };
+    reply.peerLen = sizeof(reply.peer);
+    ssize_t size = recvfrom(fd_, request, sizeof(request), 0, reinterpret_cast<struct sockaddr *>(&reply.peer),
+        &reply.peerLen);
+    int64_t receiveTime = GetClockNs(CLOCK_MONOTONIC);
+    int64_t receiveWallTime = GetClockNs(CLOCK_REALTIME);
+    if (size != static_cast<ssize_t>(NTP_PACKET_SIZE) || (request[MODE_INDEX] & MODE_MASK) != MODE_CLIENT) {
+        return;
+    }
+    requests_++;
+    std::uniform_real_distribution<double> loss(0, 1);
+    if (loss(random_) < config_.lossRate) {
+        return;
+    }
+    int64_t outbound = RandomPathDelay();
+    int64_t inbound = RandomPathDelay();
+    uint8_t *packet = reply.packet;
+    packet[MODE_INDEX] = static_cast<uint8_t>((request[MODE_INDEX] & VERSION_MASK) | MODE_SERVER);
+    packet[POLL_INDEX] = request[POLL_INDEX];
+    packet[PRECISION_INDEX] = static_cast<uint8_t>(SERVER_PRECISION);
+    if (config_.kissOfDeath) {
+        packet[MODE_INDEX] |= LEAP_UNSYNCHRONIZED;
+        packet[STRATUM_INDEX] = KISS_OF_DEATH_STRATUM;
+        memcpy(packet + REFERENCE_ID_INDEX, "RATE", REFERENCE_ID_SIZE);
+    } else {
+        packet[STRATUM_INDEX] = SERVER_STRATUM;
+        memcpy(packet + REFERENCE_ID_INDEX, "BNCH", REFERENCE_ID_SIZE);
+    }
+    // the server answers instantly, at the moment the request would have arrived
+    int64_t serverTime = receiveWallTime + outbound + config_.offsetMs * NANO_TO_MILLI;
+    WriteTimestamp(packet + REFERENCE_TIME_INDEX, serverTime - REFERENCE_AGE);
+    memcpy(packet + ORIGINATE_TIME_INDEX, request + TRANSMIT_TIME_INDEX, TIMESTAMP_SIZE);
+    WriteTimestamp(packet + RECEIVE_TIME_INDEX, serverTime);
+    WriteTimestamp(packet + TRANSMIT_TIME_INDEX, serverTime);
+    reply.sendTime = receiveTime + outbound + inbound;
+    pending_.push_back(reply);
+}
+
+int NtpResponder::SendDueReplies()
+{
+    int64_t now = GetClockNs(CLOCK_MONOTONIC);
+    int64_t next = INT64_MAX;
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (it->sendTime > now) {
+            next = std::min(next, it->sendTime);
+            ++it;
+            continue;
+        }
+        if (sendto(fd_, it->packet, NTP_PACKET_SIZE, 0, reinterpret_cast<struct sockaddr *>(&it->peer),
+            it->peerLen) == static_cast<ssize_t>(NTP_PACKET_SIZE)) {
+            replies_++;
+        }
+        it = pending_.erase(it);
+    }
+    if (next == INT64_MAX) {
+        return IDLE_TIMEOUT;
+    }
+    // rounded up, a reply is never sent early
+    return static_cast<int>((next - now + NANO_TO_MILLI - 1) / NANO_TO_MILLI);
+}
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_TOOLS_NTP_RESPONDER_H
+#define TIME_TOOLS_NTP_RESPONDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+struct NtpResponderConfig {
+    // added to the local wall clock, a wrong-time server gets a different offset than the others
+    int64_t offsetMs = 0;
+    // round trip time added on top of loopback, split evenly between both paths
+    int64_t delayMs = 0;
+    // each path is delayed by up to this much more, at random
+    int64_t jitterMs = 0;
+    // share of requests that get no answer, from 0 to 1
+    double lossRate = 0;
+    // answers with a kiss-of-death packet instead of the time
+    bool kissOfDeath = false;
+};
+
+/**
+ * Local SNTP server for benchmarks.
+ *
+ * Answers on an ephemeral UDP port with the local wall clock shifted by the configured offset. The network
+ * is emulated by stamping the request as received after the outbound delay and sending the answer after the
+ * inbound delay, so jitter shows up as path asymmetry just as it does on a real network.
+ */
+class NtpResponder {
+public:
+    explicit NtpResponder(const NtpResponderConfig &config, uint32_t seed = 0);
+    ~NtpResponder();
+    // Binds to `ip` on an ephemeral port and starts answering, returns false on failure.
+    bool Start(const std::string &ip);
+    void Stop();
+    // Returns "ip:port" or "[ip]:port" as NtpResolver accepts it.
+    std::string GetAddress() const;
+    uint64_t GetRequestCount() const;
+    uint64_t GetReplyCount() const;
+    void ResetCounters();
+
+private:
+    static constexpr size_t NTP_PACKET_SIZE = 48;
+
+    struct PendingReply {
+        // monotonic time in ns at which the reply leaves
+        int64_t sendTime = 0;
+        struct sockaddr_storage peer {};
+        socklen_t peerLen = 0;
+        uint8_t packet[NTP_PACKET_SIZE] = { 0 };
+    };
+
+    void Run();
+    void HandleRequest();
+    // Sends the replies that are due and returns the time in ms until the next one.
+    int SendDueReplies();
+    int64_t RandomPathDelay();
+
+    NtpResponderConfig config_;
+    std::mt19937 random_;
+    std::string address_;
+    int fd_ = -1;
+    std::atomic<bool> running_ { false };
+    std::atomic<uint64_t> requests_ { 0 };
+    std::atomic<uint64_t> replies_ { 0 };
+    std::vector<PendingReply> pending_;
+    std::thread thread_;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // TIME_TOOLS_NTP_RESPONDER_H
@@ -0,0 +1,476 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "time_common.h"
+#include "timer_manager.h"
+#include "virtual_timer_clock.h"
+
+namespace {
+// every allocation of the process is counted, the looper only runs while a benchmark fires timers
+std::atomic<uint64_t> g_allocations {0};
+}
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+using namespace std::chrono;
+constexpr uint64_t DEFAULT_SEED = 20240101;
+constexpr const char* DEFAULT_SIZES = "1000,10000";
+// per operation benchmarks run this many operations at most
+constexpr size_t MAX_OPS = 1000;
+// whole population benchmarks touch about this many timers in total
+constexpr size_t POPULATION_BUDGET = 20000;
+constexpr int UID_COUNT = 200;
+constexpr int FIRST_UID = 10000;
+constexpr uint32_t ADJUST_INTERVAL = 300;
+constexpr auto IDLE_UNTIL_DELAY = hours(1);
+constexpr auto MIN_DELAY = seconds(1);
+constexpr auto MAX_DELAY = hours(24);
+// far enough from the last time change for the looper to rebatch
+constexpr auto WALL_STEP = minutes(1);
+constexpr auto TRIGGER_STEP = minutes(1);
+constexpr auto BOOT_BASE = hours(1);
+constexpr auto WALL_BASE = hours(24 * 365 * 54);
+const milliseconds REPEAT_INTERVALS[] = { minutes(1), minutes(5), minutes(15), hours(1) };
+
+struct BenchTimer {
+    TimerPara paras {};
+    uint64_t triggerTime = 0;
+    int uid = 0;
+};
+
+// The TimerManager of the service, created with CreateSimulated. The virtual clocks only move when a benchmark
+// fires timers, so the looper stays idle while the others measure the calls.
+struct Engine {
+    std::shared_ptr<VirtualTimerClock> clock;
+    std::unique_ptr<TimerManager> manager;
+    // the started timers
+    std::vector<uint64_t> timers;
+    std::vector<uint64_t> created;
+    std::mt19937_64 random;
+    uint64_t nextId = 1;
+    std::atomic<uint64_t> delivered {0};
+
+    explicit Engine(uint64_t seed)
+        : clock(std::make_shared<VirtualTimerClock>(steady_clock::time_point(BOOT_BASE), WALL_BASE)),
+          manager(TimerManager::CreateSimulated(clock)),
+          random(seed)
+    {
+    }
+
+    ~Engine()
+    {
+        if (manager == nullptr) {
+            return;
+        }
+        // the proxy state is global, it must not keep timers of this manager for the next one
+        for (auto id : created) {
+            manager->DestroyTimer(id);
+        }
+        manager->ResetAllProxy();
+    }
+
+    // A timer as apps set them: mostly inexact, a third repeating, a few standalone, uids skewed to a few apps.
+    BenchTimer NewTimer()
+    {
+        std::uniform_real_distribution<double> unit(0, 1);
+        BenchTimer timer;
+        timer.paras.timerType = TimerTypes::ELAPSED_REALTIME_WAKEUP;
+        double typeDraw = unit(random);
+        if (typeDraw < 0.3) {
+            timer.paras.timerType = TimerTypes::ELAPSED_REALTIME;
+        } else if (typeDraw < 0.5) {
+            timer.paras.timerType = TimerTypes::RTC_WAKEUP;
+        }
+        // log-uniform between MIN_DELAY and MAX_DELAY
+        double delay = static_cast<double>(duration_cast<milliseconds>(MIN_DELAY).count()) *
+            std::pow(static_cast<double>(MAX_DELAY / MIN_DELAY), unit(random));
+        double windowDraw = unit(random);
+        if (windowDraw < 0.4) {
+            timer.paras.windowLength = -1;
+        } else if (windowDraw < 0.6) {
+            timer.paras.windowLength = std::uniform_int_distribution<int64_t>(1000, 60000)(random);
+        }
+        if (unit(random) < 0.3) {
+            timer.paras.interval =
+                static_cast<uint64_t>(REPEAT_INTERVALS[random() % std::size(REPEAT_INTERVALS)].count());
+        }
+        timer.paras.flag = (unit(random) < 0.05) ? TimerTypes::STANDALONE : 0;
+        timer.uid = FIRST_UID + static_cast<int>(UID_COUNT * std::pow(unit(random), 3));
+        timer.triggerTime = NewTriggerTime(timer.paras.timerType, static_cast<int64_t>(delay));
+        return timer;
+    }
+
+    uint64_t NewTriggerTime(int type, int64_t delayMs)
+    {
+        auto base = (type == TimerTypes::RTC_WAKEUP || type == TimerTypes::RTC) ? clock->GetWallTime() :
+            clock->GetBootTime().time_since_epoch();
+        return static_cast<uint64_t>(duration_cast<milliseconds>(base).count() + delayMs);
+    }
+
+    uint64_t Create(BenchTimer &timer)
+    {
+        uint64_t timerId = nextId++;
+        auto callback = [this](const uint64_t) {
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            return E_TIME_OK;
+        };
+        manager->CreateTimer(timer.paras, callback, nullptr, timer.uid, timer.uid, timerId, NOT_STORE);
+        created.push_back(timerId);
+        return timerId;
+    }
+
+    // Lets the looper finish what the last call left it, as a time change.
+    void Settle()
+    {
+        clock->RunUntil(clock->GetBootTime());
+    }
+};
+
+struct BenchResult {
+    std::string name;
+    size_t timers = 0;
+    uint64_t ops = 0;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    uint64_t delivered = 0;
+    uint64_t programs = 0;
+};
+
+class Measure {
+public:
+    Measure(const char *name, size_t timers, Engine &engine) : engine_(engine)
+    {
+        result_.name = name;
+        result_.timers = timers;
+        programs_ = engine.clock->GetSetCount();
+        delivered_ = engine.delivered.load();
+        allocations_ = g_allocations.load();
+        start_ = steady_clock::now();
+    }
+
+    BenchResult Stop(uint64_t ops)
+    {
+        auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start_).count();
+        result_.ops = ops;
+        result_.nsPerOp = static_cast<double>(elapsed) / std::max<uint64_t>(ops, 1);
+        result_.allocsPerOp = static_cast<double>(g_allocations.load() - allocations_) / std::max<uint64_t>(ops, 1);
+        result_.delivered = engine_.delivered.load() - delivered_;
+        result_.programs = engine_.clock->GetSetCount() - programs_;
+        return result_;
+    }
+
+private:
+    Engine &engine_;
+    BenchResult result_;
+    steady_clock::time_point start_;
+    uint64_t allocations_ = 0;
+    uint64_t delivered_ = 0;
+    uint64_t programs_ = 0;
+};
+
+void Populate(Engine &engine, size_t count, std::vector<BenchResult> &results)
+{
+    std::vector<BenchTimer> timers;
+    timers.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        timers.push_back(engine.NewTimer());
+    }
+    engine.timers.reserve(count);
+    engine.created.reserve(count + 1);
+    Measure measure("create_and_start", count, engine);
+    for (auto &timer : timers) {
+        auto id = engine.Create(timer);
+        engine.manager->StartTimer(id, timer.triggerTime);
+        engine.timers.push_back(id);
+    }
+    results.push_back(measure.Stop(count));
+}
+
+// Starts running timers again at a new time, the manager takes them out of their batches first.
+void BenchRestart(Engine &engine, std::vector<BenchResult> &results)
+{
+    size_t ops = std::min(engine.timers.size(), MAX_OPS);
+    std::vector<std::pair<uint64_t, uint64_t>> restarts;
+    for (size_t i = 0; i < ops; i++) {
+        auto timer = engine.NewTimer();
+        restarts.emplace_back(engine.timers[engine.random() % engine.timers.size()], timer.triggerTime);
+    }
+    Measure measure("restart", engine.timers.size(), engine);
+    for (const auto &restart : restarts) {
+        engine.manager->StartTimer(restart.first, restart.second);
+    }
+    results.push_back(measure.Stop(ops));
+}
+
+void BenchStartStop(Engine &engine, std::vector<BenchResult> &results)
+{
+    size_t ops = std::min(engine.timers.size(), MAX_OPS);
+    auto spare = engine.NewTimer();
+    auto id = engine.Create(spare);
+    Measure measure("start_stop", engine.timers.size(), engine);
+    for (size_t i = 0; i < ops; i++) {
+        engine.manager->StartTimer(id, spare.triggerTime);
+        engine.manager->StopTimer(id);
+    }
+    results.push_back(measure.Stop(ops));
+}
+
+// Lets the virtual time run until the looper woke up for MAX_OPS rounds, repeating timers come back as they do
+// on the device.
+void BenchTrigger(Engine &engine, std::vector<BenchResult> &results)
+{
+    size_t ops = std::min(engine.timers.size(), MAX_OPS);
+    auto alarms = engine.clock->GetAlarmCount();
+    auto limit = engine.clock->GetBootTime() + MAX_DELAY + TRIGGER_STEP;
+    Measure measure("trigger_and_repeat", engine.timers.size(), engine);
+    auto now = engine.clock->GetBootTime();
+    while (engine.clock->GetAlarmCount() - alarms < ops && now < limit) {
+        now += TRIGGER_STEP;
+        engine.clock->RunUntil(now);
+    }
+    results.push_back(measure.Stop(engine.clock->GetAlarmCount() - alarms));
+}
+
+size_t PopulationReps(const Engine &engine)
+{
+    return std::max<size_t>(1, POPULATION_BUDGET / std::max<size_t>(engine.timers.size(), 1));
+}
+
+// Steps the wall time back and forth, the looper rebatches every timer after each step.
+void BenchRebatch(Engine &engine, std::vector<BenchResult> &results)
+{
+    size_t reps = PopulationReps(engine);
+    Measure measure("rebatch_all", engine.timers.size(), engine);
+    for (size_t i = 0; i < reps; i++) {
+        engine.clock->StepWallTime((i % 2 == 0) ? nanoseconds(WALL_STEP) : -nanoseconds(WALL_STEP));
+        engine.Settle();
+    }
+    results.push_back(measure.Stop(reps));
+}
+
+// Regroups every batch for the fewest wakeups, as the MIN_WAKEUP policy does periodically.
+void BenchCoalesce(Engine &engine, std::vector<BenchResult> &results)
+{
+    size_t reps = PopulationReps(engine);
+    engine.manager->SetCoalescePolicy(CoalescePolicy::MIN_WAKEUP);
+    Measure measure("coalesce", engine.timers.size(), engine);
+    for (size_t i = 0; i < reps; i++) {
+        engine.manager->Coalesce();
+    }
+    results.push_back(measure.Stop(reps));
+    // the later benchmarks start from the default batching
+    engine.manager->SetCoalescePolicy(CoalescePolicy::FIRST_FIT);
+    engine.clock->StepWallTime(nanoseconds(WALL_STEP));
+    engine.Settle();
+}
+
+// Starts and stops an IDLE_UNTIL timer an hour from now. A simulation has no standby restrict lists, so no timer
+// is deferred, the benchmark measures the scans of entering and leaving idle.
+void BenchIdle(Engine &engine, std::vector<BenchResult> &results)
+{
+    size_t reps = PopulationReps(engine);
+    BenchTimer idle;
+    idle.paras.timerType = TimerTypes::ELAPSED_REALTIME_WAKEUP;
+    idle.paras.flag = TimerTypes::IDLE_UNTIL;
+    idle.triggerTime =
+        engine.NewTriggerTime(idle.paras.timerType, duration_cast<milliseconds>(IDLE_UNTIL_DELAY).count());
+    auto id = engine.Create(idle);
+    Measure measure("idle_enter_exit", engine.timers.size(), engine);
+    for (size_t i = 0; i < reps; i++) {
+        engine.manager->StartTimer(id, idle.triggerTime);
+        engine.manager->StopTimer(id);
+    }
+    results.push_back(measure.Stop(reps));
+}
+
+// Proxies the busiest uid and restores it, as for a frozen app.
+void BenchProxy(Engine &engine, std::vector<BenchResult> &results)
+{
+    size_t reps = std::min(MAX_OPS, PopulationReps(engine));
+    Measure measure("proxy_restore", engine.timers.size(), engine);
+    for (size_t i = 0; i < reps; i++) {
+        engine.manager->ProxyTimer(FIRST_UID, std::set<int> {}, true, true);
+        engine.manager->ProxyTimer(FIRST_UID, std::set<int> {}, false, true);
+    }
+    results.push_back(measure.Stop(reps));
+}
+
+// Aligns every timer to the adjust interval and restores them.
+void BenchAdjust(Engine &engine, std::vector<BenchResult> &results)
+{
+    size_t reps = PopulationReps(engine);
+    Measure measure("adjust_restore", engine.timers.size(), engine);
+    for (size_t i = 0; i < reps; i++) {
+        engine.manager->AdjustTimer(true, ADJUST_INTERVAL, 0);
+        engine.manager->AdjustTimer(false, ADJUST_INTERVAL, 0);
+    }
+    results.push_back(measure.Stop(reps));
+}
+
+void RunSize(size_t count, uint64_t seed, const std::string &filter, std::vector<BenchResult> &results)
+{
+    Engine engine(seed);
+    if (engine.manager == nullptr) {
+        printf("failed to create the simulated timer manager\n");
+        return;
+    }
+    std::vector<BenchResult> sizeResults;
+    Populate(engine, count, sizeResults);
+    const std::vector<std::pair<const char *, void (*)(Engine &, std::vector<BenchResult> &)>> benches = {
+        { "restart", BenchRestart },
+        { "start_stop", BenchStartStop },
+        { "rebatch_all", BenchRebatch },
+        { "coalesce", BenchCoalesce },
+        { "idle_enter_exit", BenchIdle },
+        { "proxy_restore", BenchProxy },
+        { "adjust_restore", BenchAdjust },
+        // last, it moves the virtual time
+        { "trigger_and_repeat", BenchTrigger },
+    };
+    for (const auto &bench : benches) {
+        if (filter.empty() || filter == bench.first) {
+            bench.second(engine, sizeResults);
+        }
+    }
+    for (const auto &result : sizeResults) {
+        if (filter.empty() || filter == result.name) {
+            printf("%-20s %8zu %8" PRIu64 " %12.1f %10.2f %9" PRIu64 " %8" PRIu64 "\n", result.name.c_str(),
+                result.timers, result.ops, result.nsPerOp, result.allocsPerOp, result.delivered, result.programs);
+            results.push_back(result);
+        }
+    }
+}
+
+bool WriteJson(const std::string &path, const std::vector<BenchResult> &results)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        printf("failed to open %s\n", path.c_str());
+        return false;
+    }
+    fprintf(file, "{\"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &result = results[i];
+        fprintf(file, "  {\"name\": \"%s\", \"timers\": %zu, \"ops\": %" PRIu64 ", \"ns_per_op\": %.1f, "
+            "\"allocs_per_op\": %.2f, \"delivered\": %" PRIu64 ", \"kernel_programs\": %" PRIu64 "}%s\n",
+            result.name.c_str(), result.timers, result.ops, result.nsPerOp, result.allocsPerOp, result.delivered,
+            result.programs, (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+    return true;
+}
+
+std::vector<size_t> ParseSizes(const std::string &text)
+{
+    std::vector<size_t> sizes;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        long long size = atoll(text.substr(pos, end - pos).c_str());
+        if (size > 0) {
+            sizes.push_back(static_cast<size_t>(size));
+        }
+        pos = end + 1;
+    }
+    return sizes;
+}
+
+void Usage(const char *name)
+{
+    printf("usage: %s [-n sizes] [-b benchmark] [-s seed] [-j file]\n", name);
+    printf("  -n  comma separated timer population sizes, default %s\n", DEFAULT_SIZES);
+    printf("  -j  also write the results as JSON to file\n");
+    printf("benchmarks: create_and_start restart start_stop rebatch_all coalesce idle_enter_exit proxy_restore "
+        "adjust_restore trigger_and_repeat\n");
+}
+} // namespace
+} // namespace MiscServices
+} // namespace OHOS
+
+using namespace OHOS::MiscServices;
+
+int main(int argc, char *argv[])
+{
+    std::string sizes = DEFAULT_SIZES;
+    std::string filter;
+    std::string jsonPath;
+    uint64_t seed = DEFAULT_SEED;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:s:j:h")) != -1) {
+        if (opt == 'n') {
+            sizes = optarg;
+        } else if (opt == 'b') {
+            filter = optarg;
+        } else if (opt == 's') {
+            seed = strtoull(optarg, nullptr, 0);
+        } else if (opt == 'j') {
+            jsonPath = optarg;
+        } else {
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    printf("%-20s %8s %8s %12s %10s %9s %8s\n", "benchmark", "timers", "ops", "ns/op", "allocs/op", "delivered",
+        "programs");
+    std::vector<BenchResult> results;
+    for (auto size : ParseSizes(sizes)) {
+        RunSize(size, seed, filter, results);
+    }
+    if (!jsonPath.empty() && !WriteJson(jsonPath, results)) {
+        return 1;
+    }
+    return 0;
+}
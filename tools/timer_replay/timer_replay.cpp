@@ -0,0 +1,462 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "time_common.h"
+#include "timer_manager.h"
+#include "timer_scheduler.h"
+#include "timer_trace.h"
+#include "virtual_timer_clock.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+using namespace std::chrono;
+constexpr milliseconds COALESCE_INTERVAL = milliseconds(TimerManager::COALESCE_INTERVAL);
+constexpr size_t EVENT_COUNT = static_cast<size_t>(TimerTraceEvent::TIME_CHANGE) + 1;
+constexpr const char* EVENT_NAMES[] = {
+    "create", "start", "stop", "destroy", "proxy", "adjust", "idle", "time_change"
+};
+constexpr double P50 = 0.5;
+constexpr double P90 = 0.9;
+constexpr double P99 = 0.99;
+constexpr double NANO_TO_MILLI = 1e6;
+constexpr double NANO_TO_SECOND = 1e9;
+
+int64_t GetCpuTime(clockid_t clock)
+{
+    struct timespec ts {};
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * static_cast<int64_t>(NANO_TO_SECOND) + ts.tv_nsec;
+}
+
+template<typename T>
+T Percentile(std::vector<T> &values, double p)
+{
+    if (values.empty()) {
+        return T {};
+    }
+    auto pos = values.begin() + static_cast<int64_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), pos, values.end());
+    return *pos;
+}
+
+struct TimerSpec {
+    int type = 0;
+    uint64_t interval = 0;
+};
+
+// the next delivery a started timer is due for, as the app asked for it
+struct PendingDelivery {
+    // in the time base of `type`, ms
+    milliseconds when {0};
+    int type = 0;
+    milliseconds interval {0};
+    bool wakeup = false;
+};
+
+struct ReplayStats {
+    std::array<uint64_t, EVENT_COUNT> events {};
+    uint64_t unknownTimers = 0;
+    // looper rounds which delivered a wakeup timer, and those which delivered only non-wakeup timers
+    uint64_t wakeups = 0;
+    uint64_t nonWakeupAlarms = 0;
+    uint64_t kernelSets = 0;
+    uint64_t fired = 0;
+    uint64_t coalesceRuns = 0;
+    // timers delivered per looper round
+    std::vector<uint32_t> deliverySizes;
+    // delivery time minus the time the app asked for, in ns
+    std::vector<int64_t> lateness;
+    // spent in the TimerManager calls of the replay thread
+    int64_t apiCpuTime = 0;
+};
+
+/**
+ * Replays a trace against the real TimerManager, created with CreateSimulated on the virtual clock of the trace.
+ * The results come from the timer callbacks: the deliveries at one virtual time make one looper round. Only the
+ * trace is replayed, so the standby restrict lists and the adjust exemptions of the device are empty.
+ */
+class Replayer {
+public:
+    Replayer(std::shared_ptr<VirtualTimerClock> clock, CoalescePolicy policy)
+        : clock_(std::move(clock)), policy_(policy), nextCoalesce_(clock_->GetBootTime() + COALESCE_INTERVAL) {}
+
+    bool Start()
+    {
+        manager_ = TimerManager::CreateSimulated(clock_);
+        if (manager_ == nullptr) {
+            return false;
+        }
+        manager_->SetCoalescePolicy(policy_);
+        return true;
+    }
+
+    // Stops the looper, the stats are complete afterwards.
+    void Stop()
+    {
+        manager_.reset();
+        std::lock_guard<std::mutex> lock(mutex_);
+        CloseRoundLocked();
+        stats_.kernelSets = clock_->GetSetCount();
+    }
+
+    // Lets the looper take everything due until `until`, regrouping on virtual time as the service does.
+    void RunUntil(steady_clock::time_point until)
+    {
+        while (policy_ == CoalescePolicy::MIN_WAKEUP && nextCoalesce_ <= until) {
+            clock_->RunUntil(nextCoalesce_);
+            manager_->Coalesce();
+            stats_.coalesceRuns++;
+            nextCoalesce_ += COALESCE_INTERVAL;
+        }
+        clock_->RunUntil(until);
+    }
+
+    void Apply(const TimerTraceRecord &record)
+    {
+        auto event = static_cast<size_t>(record.event);
+        if (event >= EVENT_COUNT) {
+            return;
+        }
+        stats_.events[event]++;
+        if (record.event == TimerTraceEvent::TIME_CHANGE) {
+            // the looper sees the step like the kernel reports it and rebatches
+            clock_->StepWallTime(nanoseconds(record.when) - clock_->GetWallTime());
+            return;
+        }
+        auto cpuStart = GetCpuTime(CLOCK_THREAD_CPUTIME_ID);
+        ApplyToManager(record);
+        stats_.apiCpuTime += GetCpuTime(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+    }
+
+    ReplayStats &GetStats()
+    {
+        return stats_;
+    }
+
+private:
+    void ApplyToManager(const TimerTraceRecord &record)
+    {
+        switch (record.event) {
+            case TimerTraceEvent::CREATE:
+                Create(record);
+                break;
+            case TimerTraceEvent::START:
+                StartTimer(record);
+                break;
+            case TimerTraceEvent::STOP:
+                ForgetDelivery(record.id);
+                manager_->StopTimer(record.id);
+                break;
+            case TimerTraceEvent::DESTROY:
+                ForgetDelivery(record.id);
+                manager_->DestroyTimer(record.id);
+                specs_.erase(record.id);
+                break;
+            case TimerTraceEvent::PROXY:
+                // pid 0 stands for the whole uid, as in the trace
+                manager_->ProxyTimer(record.uid, std::set<int> {record.pid}, record.flags != 0, true);
+                break;
+            case TimerTraceEvent::ADJUST:
+                manager_->AdjustTimer(record.flags != 0, static_cast<uint32_t>(record.when),
+                    static_cast<uint32_t>(record.interval));
+                break;
+            default:
+                // idle follows from the IDLE_UNTIL timers, the records only tell when it happened
+                break;
+        }
+    }
+
+    void Create(const TimerTraceRecord &record)
+    {
+        TimerPara paras {};
+        paras.timerType = record.type;
+        paras.windowLength = record.window;
+        paras.interval = record.interval;
+        paras.flag = record.flags;
+        uint64_t timerId = record.id;
+        auto callback = [this](const uint64_t id) { return OnDelivery(id); };
+        if (manager_->CreateTimer(paras, callback, nullptr, record.uid, record.pid, timerId, NOT_STORE) == E_TIME_OK) {
+            specs_[record.id] = TimerSpec { record.type, record.interval };
+        }
+    }
+
+    void StartTimer(const TimerTraceRecord &record)
+    {
+        auto it = specs_.find(record.id);
+        if (it == specs_.end()) {
+            stats_.unknownTimers++;
+            return;
+        }
+        {
+            // before the start, the looper may deliver the timer at once
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto &pending = pending_[record.id];
+            pending.when = milliseconds(record.when);
+            pending.type = it->second.type;
+            pending.interval = milliseconds(it->second.interval);
+            pending.wakeup = it->second.type == TimerTypes::RTC_WAKEUP ||
+                it->second.type == TimerTypes::ELAPSED_REALTIME_WAKEUP;
+        }
+        if (manager_->StartTimer(record.id, static_cast<uint64_t>(record.when)) != E_TIME_OK) {
+            stats_.unknownTimers++;
+            ForgetDelivery(record.id);
+        }
+    }
+
+    void ForgetDelivery(uint64_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.erase(id);
+    }
+
+    // called by the looper of the manager
+    int32_t OnDelivery(uint64_t id)
+    {
+        auto now = clock_->GetBootTime();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (roundSize_ > 0 && now != roundTime_) {
+            CloseRoundLocked();
+        }
+        roundTime_ = now;
+        roundSize_++;
+        stats_.fired++;
+        auto it = pending_.find(id);
+        if (it == pending_.end()) {
+            return E_TIME_OK;
+        }
+        auto &pending = it->second;
+        roundWakeup_ = roundWakeup_ || pending.wakeup;
+        auto asked = TimerInfo::ConvertToElapsed(pending.when, pending.type);
+        stats_.lateness.push_back(std::max<int64_t>(duration_cast<nanoseconds>(now - asked).count(), 0));
+        if (pending.interval <= milliseconds::zero()) {
+            pending_.erase(it);
+            return E_TIME_OK;
+        }
+        // a repeating timer skips the periods it missed
+        auto missed = (now > asked) ? duration_cast<milliseconds>(now - asked) / pending.interval : 0;
+        pending.when += pending.interval * (missed + 1);
+        return E_TIME_OK;
+    }
+
+    // needs to acquire the lock `mutex_` before calling this method
+    void CloseRoundLocked()
+    {
+        if (roundSize_ == 0) {
+            return;
+        }
+        stats_.deliverySizes.push_back(roundSize_);
+        if (roundWakeup_) {
+            stats_.wakeups++;
+        } else {
+            stats_.nonWakeupAlarms++;
+        }
+        roundSize_ = 0;
+        roundWakeup_ = false;
+    }
+
+    std::shared_ptr<VirtualTimerClock> clock_;
+    CoalescePolicy policy_;
+    steady_clock::time_point nextCoalesce_;
+    std::unique_ptr<TimerManager> manager_;
+    std::unordered_map<uint64_t, TimerSpec> specs_;
+    // guards `pending_`, the round and the delivery stats, which the looper updates
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, PendingDelivery> pending_;
+    steady_clock::time_point roundTime_;
+    uint32_t roundSize_ = 0;
+    bool roundWakeup_ = false;
+    ReplayStats stats_;
+};
+
+struct Summary {
+    uint64_t records = 0;
+    double simulatedSeconds = 0;
+    double processCpuMs = 0;
+    double apiCpuMs = 0;
+    double deliveryMean = 0;
+    uint32_t deliveryP50 = 0;
+    uint32_t deliveryP90 = 0;
+    uint32_t deliveryMax = 0;
+    double latenessP50 = 0;
+    double latenessP90 = 0;
+    double latenessP99 = 0;
+    double latenessMax = 0;
+};
+
+Summary Summarize(ReplayStats &stats, uint64_t records, int64_t simulated, int64_t processCpu)
+{
+    Summary summary;
+    summary.records = records;
+    summary.simulatedSeconds = static_cast<double>(simulated) / NANO_TO_SECOND;
+    summary.processCpuMs = static_cast<double>(processCpu) / NANO_TO_MILLI;
+    summary.apiCpuMs = static_cast<double>(stats.apiCpuTime) / NANO_TO_MILLI;
+    uint64_t delivered = 0;
+    for (auto size : stats.deliverySizes) {
+        delivered += size;
+        summary.deliveryMax = std::max(summary.deliveryMax, size);
+    }
+    summary.deliveryMean = stats.deliverySizes.empty() ? 0 :
+        static_cast<double>(delivered) / static_cast<double>(stats.deliverySizes.size());
+    summary.deliveryP50 = Percentile(stats.deliverySizes, P50);
+    summary.deliveryP90 = Percentile(stats.deliverySizes, P90);
+    summary.latenessP50 = static_cast<double>(Percentile(stats.lateness, P50)) / NANO_TO_MILLI;
+    summary.latenessP90 = static_cast<double>(Percentile(stats.lateness, P90)) / NANO_TO_MILLI;
+    summary.latenessP99 = static_cast<double>(Percentile(stats.lateness, P99)) / NANO_TO_MILLI;
+    if (!stats.lateness.empty()) {
+        summary.latenessMax =
+            static_cast<double>(*std::max_element(stats.lateness.begin(), stats.lateness.end())) / NANO_TO_MILLI;
+    }
+    return summary;
+}
+
+void PrintReport(const ReplayStats &stats, const Summary &summary, CoalescePolicy policy)
+{
+    printf("coalesce policy          %s\n", TimerScheduler::GetPolicyName(policy));
+    printf("records                  %" PRIu64 "\n", summary.records);
+    for (size_t i = 0; i < EVENT_COUNT; i++) {
+        printf("  %-22s %" PRIu64 "\n", EVENT_NAMES[i], stats.events[i]);
+    }
+    printf("unknown timers           %" PRIu64 "\n", stats.unknownTimers);
+    printf("simulated time           %.1fs\n", summary.simulatedSeconds);
+    printf("kernel wakeups           %" PRIu64 "\n", stats.wakeups);
+    printf("non-wakeup alarms        %" PRIu64 "\n", stats.nonWakeupAlarms);
+    printf("kernel timer sets        %" PRIu64 "\n", stats.kernelSets);
+    printf("timers fired             %" PRIu64 "\n", stats.fired);
+    printf("delivery rounds          %zu\n", stats.deliverySizes.size());
+    printf("coalesce regroups        %" PRIu64 "\n", stats.coalesceRuns);
+    printf("timers per round         mean %.2f p50 %u p90 %u max %u\n", summary.deliveryMean,
+        summary.deliveryP50, summary.deliveryP90, summary.deliveryMax);
+    printf("lateness(ms)             p50 %.1f p90 %.1f p99 %.1f max %.1f\n", summary.latenessP50,
+        summary.latenessP90, summary.latenessP99, summary.latenessMax);
+    printf("api cpu time             %.1fms\n", summary.apiCpuMs);
+    printf("process cpu time         %.1fms\n", summary.processCpuMs);
+}
+
+bool WriteJson(const std::string &path, const ReplayStats &stats, const Summary &summary, CoalescePolicy policy)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        printf("failed to open %s\n", path.c_str());
+        return false;
+    }
+    fprintf(file, "{\"policy\": \"%s\", \"records\": %" PRIu64 ", \"unknown_timers\": %" PRIu64 ", "
+        "\"simulated_s\": %.1f, \"kernel_wakeups\": %" PRIu64 ", \"non_wakeup_alarms\": %" PRIu64 ", "
+        "\"kernel_sets\": %" PRIu64 ", \"time_changes\": %" PRIu64 ", \"fired\": %" PRIu64 ", "
+        "\"delivery_rounds\": %zu, \"coalesce_regroups\": %" PRIu64 ", "
+        "\"delivery_mean\": %.2f, \"delivery_p50\": %u, \"delivery_p90\": %u, \"delivery_max\": %u, "
+        "\"lateness_p50_ms\": %.1f, \"lateness_p90_ms\": %.1f, \"lateness_p99_ms\": %.1f, "
+        "\"lateness_max_ms\": %.1f, \"api_cpu_ms\": %.1f, \"process_cpu_ms\": %.1f}\n",
+        TimerScheduler::GetPolicyName(policy), summary.records, stats.unknownTimers, summary.simulatedSeconds,
+        stats.wakeups, stats.nonWakeupAlarms, stats.kernelSets,
+        stats.events[static_cast<size_t>(TimerTraceEvent::TIME_CHANGE)], stats.fired, stats.deliverySizes.size(),
+        stats.coalesceRuns, summary.deliveryMean, summary.deliveryP50, summary.deliveryP90, summary.deliveryMax,
+        summary.latenessP50, summary.latenessP90, summary.latenessP99, summary.latenessMax, summary.apiCpuMs,
+        summary.processCpuMs);
+    fclose(file);
+    return true;
+}
+
+void Usage(const char *name)
+{
+    printf("usage: %s [-e seconds] [-j file] [-p policy] trace\n", name);
+    printf("  -e  keep the clocks running for this long after the last record, default 0\n");
+    printf("  -p  coalesce policy, first_fit, best_fit or min_wakeup, default first_fit\n");
+    printf("  -j  also write the results as JSON to file\n");
+    printf("a trace is recorded on the device with: hidumper -s 3702 -a \"-timer -trace on\" and \"off\"\n");
+}
+} // namespace
+} // namespace MiscServices
+} // namespace OHOS
+
+using namespace OHOS::MiscServices;
+
+int main(int argc, char *argv[])
+{
+    int64_t extraSeconds = 0;
+    std::string jsonPath;
+    CoalescePolicy policy = CoalescePolicy::FIRST_FIT;
+    int opt;
+    while ((opt = getopt(argc, argv, "e:j:p:h")) != -1) {
+        if (opt == 'e') {
+            extraSeconds = std::max<int64_t>(atoll(optarg), 0);
+        } else if (opt == 'j') {
+            jsonPath = optarg;
+        } else if (opt == 'p' && TimerScheduler::ParsePolicy(optarg, policy)) {
+            continue;
+        } else {
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc) {
+        Usage(argv[0]);
+        return 1;
+    }
+    TimerTraceReader reader;
+    if (!reader.Open(argv[optind])) {
+        printf("failed to read trace %s\n", argv[optind]);
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(reader.GetStartBootTime()));
+    auto clock = std::make_shared<VirtualTimerClock>(start, std::chrono::nanoseconds(reader.GetStartWallTime()));
+    Replayer replayer(clock, policy);
+    auto cpuStart = GetCpuTime(CLOCK_PROCESS_CPUTIME_ID);
+    if (!replayer.Start()) {
+        printf("failed to create the simulated timer manager\n");
+        return 1;
+    }
+    uint64_t records = 0;
+    auto last = start;
+    TimerTraceRecord record;
+    while (reader.Read(record)) {
+        // the records are in boot time order, everything due before one is taken before it applies
+        last = std::max(last, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(record.bootTime)));
+        replayer.RunUntil(last);
+        replayer.Apply(record);
+        replayer.RunUntil(last);
+        records++;
+    }
+    if (extraSeconds > 0) {
+        last += std::chrono::seconds(extraSeconds);
+        replayer.RunUntil(last);
+    }
+    replayer.Stop();
+    auto processCpu = GetCpuTime(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    auto &stats = replayer.GetStats();
+    auto simulated = std::chrono::duration_cast<std::chrono::nanoseconds>(last - start).count();
+    auto summary = Summarize(stats, records, simulated, processCpu);
+    PrintReport(stats, summary, policy);
+    if (!jsonPath.empty() && !WriteJson(jsonPath, stats, summary, policy)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_TASK_EXECUTOR_H
+#define TIME_TASK_EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace OHOS {
+namespace MiscServices {
+/**
+ * Bounded executor for the background work of the service.
+ *
+ * Tasks run on at most EXECUTOR_MAX_THREADS workers, which are started on demand and leave after staying
+ * idle for a while. A task may be delayed, and a task posted with a key is dropped while another task with
+ * the same key is still queued, so a burst of events leaves at most one pending task behind.
+ * Every task counts against the queue limit except those posted with PostPeriodic, whose fixed keys bound them,
+ * so periodic tasks and retries which post themselves again are never rejected.
+ */
+class TimeTaskExecutor {
+public:
+    using Task = std::function<void()>;
+    enum class PostResult {
+        POSTED,
+        // a task with the same key is still queued and stands in for this one
+        COALESCED,
+        // the queue is full, the task is dropped
+        REJECTED,
+    };
+
+    static TimeTaskExecutor &GetInstance();
+    // Runs `task` after `delayMs`.
+    PostResult Post(const std::string &key, Task task, int64_t delayMs = 0);
+    PostResult Post(Task task, int64_t delayMs = 0);
+    // For tasks which post themselves again under one fixed key until done, never rejected.
+    PostResult PostPeriodic(const std::string &key, Task task, int64_t delayMs = 0);
+    void ShowExecutorInfo(int fd);
+
+private:
+    struct Entry {
+        std::string key;
+        Task task;
+        bool periodic = false;
+    };
+
+    TimeTaskExecutor() = default;
+    ~TimeTaskExecutor() = default;
+    PostResult PostEntry(Entry entry, int64_t delayMs);
+    void WorkerLoop();
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    // ordered by due time, tasks due at the same time keep their posting order
+    std::multimap<std::chrono::steady_clock::time_point, Entry> queue_;
+    std::set<std::string> pendingKeys_;
+    uint32_t threads_ = 0;
+    uint32_t idleThreads_ = 0;
+    // queued tasks not posted with PostPeriodic, the ones limited by EXECUTOR_MAX_QUEUE
+    size_t limitedQueued_ = 0;
+    size_t maxQueued_ = 0;
+    uint64_t posted_ = 0;
+    uint64_t coalesced_ = 0;
+    uint64_t rejected_ = 0;
+    uint64_t executed_ = 0;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // TIME_TASK_EXECUTOR_H
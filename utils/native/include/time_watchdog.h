@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_WATCHDOG_H
+#define TIME_WATCHDOG_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace OHOS {
+namespace MiscServices {
+constexpr int32_t WATCHDOG_MAX_SLOTS = 64;
+constexpr int32_t WATCHDOG_INVALID_SLOT = -1;
+
+/**
+ * In-process watchdog for binder entry points.
+ *
+ * Every thread owns one deadline slot. Arming and disarming a slot are plain relaxed stores done by the
+ * owning thread only, a single monitor thread scans all slots and escalates to HiCollie when a deadline
+ * has been missed.
+ */
+class TimeWatchdog {
+public:
+    struct Frame {
+        const char *name = nullptr;
+        int64_t deadline = 0;
+        uint32_t flag = 0;
+        // set by Arm, a restored frame keeps it so that a stall already reported is not reported again
+        uint64_t seq = 0;
+    };
+
+    static TimeWatchdog &GetInstance();
+    static int64_t GetMonotonicMs();
+
+    // Returns the slot of the calling thread, or WATCHDOG_INVALID_SLOT when all slots are taken.
+    int32_t GetThreadSlot();
+    // Arms `slot` with `frame` and returns the frame it replaced, only the owner thread may call this.
+    Frame Arm(int32_t slot, const Frame &frame);
+    // Puts back the frame returned by Arm, a default frame disarms the slot.
+    void Restore(int32_t slot, const Frame &prev);
+    void ReleaseSlot(int32_t slot);
+
+private:
+    TimeWatchdog() = default;
+    ~TimeWatchdog() = default;
+
+    struct Slot {
+        std::atomic<bool> inUse {false};
+        std::atomic<int32_t> tid {0};
+        std::atomic<const char *> name {nullptr};
+        std::atomic<uint32_t> flag {0};
+        std::atomic<int64_t> deadline {0};
+        std::atomic<uint64_t> armSeq {0};
+        // only accessed by the owner thread
+        uint64_t nextSeq = 0;
+        // only accessed by the monitor thread
+        uint64_t reportedSeq = 0;
+    };
+
+    void Publish(Slot &slot, const Frame &frame);
+    void StartMonitor();
+    void MonitorLoop();
+    void Report(Slot &slot, const char *name, uint32_t flag, int64_t overdue);
+
+    std::array<Slot, WATCHDOG_MAX_SLOTS> slots_;
+    std::once_flag monitorOnce_;
+};
+} // namespace MiscServices
+} // namespace OHOS
+#endif // TIME_WATCHDOG_H
@@ -16,17 +16,24 @@
 #ifndef TIME_XCOLLIE_H
 #define TIME_XCOLLIE_H
 
+#include <functional>
 #include <string>
 
+#include "time_watchdog.h"
+
 namespace OHOS {
 namespace MiscServices {
 
 constexpr int TIME_OUT_SECONDS = 5;
 constexpr int XCOLLIE_FLAG_LOG = 1;
 
+/**
+ * Scoped deadline for a binder entry point. Without a callback the deadline is tracked by TimeWatchdog, so
+ * `name` must outlive the object, string literals are expected here.
+ */
 class TimeXCollie {
 public:
-    TimeXCollie(const std::string &name, uint32_t timeoutSeconds = TIME_OUT_SECONDS,
+    TimeXCollie(const char *name, uint32_t timeoutSeconds = TIME_OUT_SECONDS,
         std::function<void(void *)> func = nullptr, void *arg = nullptr, uint32_t flag = XCOLLIE_FLAG_LOG);
 
     ~TimeXCollie();
@@ -35,7 +42,9 @@ public:
 
 private:
     int32_t id_;
-    std::string name_;
+    int32_t slot_;
+    const char *name_;
+    TimeWatchdog::Frame prev_;
     bool isCanceled_;
 };
 }
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "time_task_executor.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <pthread.h>
+#include <thread>
+
+#include "time_hilog.h"
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr uint32_t EXECUTOR_MAX_THREADS = 4;
+constexpr size_t EXECUTOR_MAX_QUEUE = 64;
+// a worker without work for this long leaves, the next post starts a new one
+constexpr std::chrono::seconds EXECUTOR_IDLE_TIMEOUT(30);
+}
+
+TimeTaskExecutor &TimeTaskExecutor::GetInstance()
+{
+    static TimeTaskExecutor instance;
+    return instance;
+}
+
+TimeTaskExecutor::PostResult TimeTaskExecutor::Post(Task task, int64_t delayMs)
+{
+    return Post("", std::move(task), delayMs);
+}
+
+TimeTaskExecutor::PostResult TimeTaskExecutor::Post(const std::string &key, Task task, int64_t delayMs)
+{
+    return PostEntry(Entry { key, std::move(task), false }, delayMs);
+}
+
+TimeTaskExecutor::PostResult TimeTaskExecutor::PostPeriodic(const std::string &key, Task task, int64_t delayMs)
+{
+    return PostEntry(Entry { key, std::move(task), true }, delayMs);
+}
+
+TimeTaskExecutor::PostResult TimeTaskExecutor::PostEntry(Entry entry, int64_t delayMs)
+{
+    auto dueTime = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max<int64_t>(delayMs, 0));
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!entry.key.empty() && pendingKeys_.count(entry.key) > 0) {
+        coalesced_++;
+        return PostResult::COALESCED;
+    }
+    if (!entry.periodic && limitedQueued_ >= EXECUTOR_MAX_QUEUE) {
+        rejected_++;
+        TIME_HILOGE(TIME_MODULE_SERVICE, "executor queue full, drop task:%{public}s", entry.key.c_str());
+        return PostResult::REJECTED;
+    }
+    if (!entry.key.empty()) {
+        pendingKeys_.insert(entry.key);
+    }
+    if (!entry.periodic) {
+        limitedQueued_++;
+    }
+    queue_.emplace(dueTime, std::move(entry));
+    posted_++;
+    maxQueued_ = std::max(maxQueued_, queue_.size());
+    if (idleThreads_ < queue_.size() && threads_ < EXECUTOR_MAX_THREADS) {
+        threads_++;
+        std::thread thread([this] { WorkerLoop(); });
+        thread.detach();
+    } else {
+        cond_.notify_one();
+    }
+    return PostResult::POSTED;
+}
+
+void TimeTaskExecutor::WorkerLoop()
+{
+    pthread_setname_np(pthread_self(), "time_executor");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        if (queue_.empty()) {
+            idleThreads_++;
+            bool hasTask = cond_.wait_for(lock, EXECUTOR_IDLE_TIMEOUT, [this] { return !queue_.empty(); });
+            idleThreads_--;
+            if (!hasTask) {
+                threads_--;
+                return;
+            }
+            continue;
+        }
+        auto it = queue_.begin();
+        if (it->first > std::chrono::steady_clock::now()) {
+            // the entry may be taken by another worker while this one waits, so its due time is copied
+            auto dueTime = it->first;
+            idleThreads_++;
+            cond_.wait_until(lock, dueTime);
+            idleThreads_--;
+            continue;
+        }
+        Entry entry = std::move(it->second);
+        queue_.erase(it);
+        if (!entry.key.empty()) {
+            pendingKeys_.erase(entry.key);
+        }
+        if (!entry.periodic) {
+            limitedQueued_--;
+        }
+        executed_++;
+        lock.unlock();
+        entry.task();
+        lock.lock();
+    }
+}
+
+void TimeTaskExecutor::ShowExecutorInfo(int fd)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    dprintf(fd, " * threads                 = %u/%u\n", threads_, EXECUTOR_MAX_THREADS);
+    dprintf(fd, " * idle threads            = %u\n", idleThreads_);
+    dprintf(fd, " * queued tasks            = %zu\n", queue_.size());
+    dprintf(fd, " * queued limited tasks    = %zu/%zu\n", limitedQueued_, EXECUTOR_MAX_QUEUE);
+    dprintf(fd, " * max queued tasks        = %zu\n", maxQueued_);
+    dprintf(fd, " * posted tasks            = %" PRIu64 "\n", posted_);
+    dprintf(fd, " * executed tasks          = %" PRIu64 "\n", executed_);
+    dprintf(fd, " * coalesced posts         = %" PRIu64 "\n", coalesced_);
+    dprintf(fd, " * rejected posts          = %" PRIu64 "\n", rejected_);
+    for (const auto &key : pendingKeys_) {
+        dprintf(fd, " * pending key             = %s\n", key.c_str());
+    }
+}
+} // namespace MiscServices
+} // namespace OHOS
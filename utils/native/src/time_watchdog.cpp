@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "time_watchdog.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <ctime>
+#include <pthread.h>
+#include <thread>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "time_hilog.h"
+
+#ifdef HICOLLIE_ENABLE
+#include "xcollie/xcollie.h"
+#endif
+
+namespace OHOS {
+namespace MiscServices {
+namespace {
+constexpr int64_t MILLI_TO_SEC = 1000;
+constexpr int64_t NANO_TO_MILLI = 1000000;
+constexpr int64_t CHECK_INTERVAL_MS = 1000;
+// the deadline is already missed when escalating, HiCollie only has to wait for its own timer tick
+constexpr uint32_t ESCALATE_TIMEOUT_SECONDS = 1;
+
+struct ThreadSlotHolder {
+    int32_t index = WATCHDOG_INVALID_SLOT;
+    bool claimed = false;
+    ~ThreadSlotHolder()
+    {
+        if (index != WATCHDOG_INVALID_SLOT) {
+            TimeWatchdog::GetInstance().ReleaseSlot(index);
+        }
+    }
+};
+thread_local ThreadSlotHolder g_threadSlot;
+}
+
+TimeWatchdog &TimeWatchdog::GetInstance()
+{
+    static TimeWatchdog instance;
+    return instance;
+}
+
+int64_t TimeWatchdog::GetMonotonicMs()
+{
+    // suspend time must not count against a binder call, so boot time is not used here
+    struct timespec tv {};
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &tv);
+    return tv.tv_sec * MILLI_TO_SEC + tv.tv_nsec / NANO_TO_MILLI;
+}
+
+int32_t TimeWatchdog::GetThreadSlot()
+{
+    if (g_threadSlot.claimed) {
+        return g_threadSlot.index;
+    }
+    g_threadSlot.claimed = true;
+    for (int32_t i = 0; i < WATCHDOG_MAX_SLOTS; ++i) {
+        bool expected = false;
+        if (slots_[i].inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            slots_[i].tid.store(static_cast<int32_t>(syscall(SYS_gettid)), std::memory_order_relaxed);
+            g_threadSlot.index = i;
+            StartMonitor();
+            return i;
+        }
+    }
+    TIME_HILOGW(TIME_MODULE_SERVICE, "watchdog slots exhausted");
+    return WATCHDOG_INVALID_SLOT;
+}
+
+TimeWatchdog::Frame TimeWatchdog::Arm(int32_t slot, const Frame &frame)
+{
+    Slot &s = slots_[slot];
+    Frame prev;
+    prev.name = s.name.load(std::memory_order_relaxed);
+    prev.deadline = s.deadline.load(std::memory_order_relaxed);
+    prev.flag = s.flag.load(std::memory_order_relaxed);
+    prev.seq = s.armSeq.load(std::memory_order_relaxed);
+    Frame armed = frame;
+    armed.seq = ++s.nextSeq;
+    Publish(s, armed);
+    return prev;
+}
+
+void TimeWatchdog::Restore(int32_t slot, const Frame &prev)
+{
+    // an outer frame which expired while it was replaced comes back with its own sequence, the monitor reports
+    // it once, or not at all if it already did
+    Publish(slots_[slot], prev);
+}
+
+void TimeWatchdog::Publish(Slot &slot, const Frame &frame)
+{
+    // only the owner thread writes the slot, a stale name seen by the monitor is harmless
+    slot.name.store(frame.name, std::memory_order_relaxed);
+    slot.flag.store(frame.flag, std::memory_order_relaxed);
+    slot.armSeq.store(frame.seq, std::memory_order_relaxed);
+    slot.deadline.store(frame.deadline, std::memory_order_relaxed);
+}
+
+void TimeWatchdog::ReleaseSlot(int32_t slot)
+{
+    Slot &s = slots_[slot];
+    s.deadline.store(0, std::memory_order_relaxed);
+    s.name.store(nullptr, std::memory_order_relaxed);
+    s.inUse.store(false, std::memory_order_release);
+}
+
+void TimeWatchdog::StartMonitor()
+{
+    std::call_once(monitorOnce_, [this] {
+        std::thread thread([this] { MonitorLoop(); });
+        thread.detach();
+    });
+}
+
+void TimeWatchdog::MonitorLoop()
+{
+    pthread_setname_np(pthread_self(), "time_watchdog");
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(CHECK_INTERVAL_MS));
+        int64_t now = GetMonotonicMs();
+        for (auto &slot : slots_) {
+            if (!slot.inUse.load(std::memory_order_acquire)) {
+                continue;
+            }
+            int64_t deadline = slot.deadline.load(std::memory_order_relaxed);
+            if (deadline == 0 || now <= deadline) {
+                continue;
+            }
+            uint64_t seq = slot.armSeq.load(std::memory_order_relaxed);
+            if (seq == slot.reportedSeq) {
+                continue;
+            }
+            slot.reportedSeq = seq;
+            Report(slot, slot.name.load(std::memory_order_relaxed), slot.flag.load(std::memory_order_relaxed),
+                now - deadline);
+        }
+    }
+}
+
+void TimeWatchdog::Report(Slot &slot, const char *name, uint32_t flag, int64_t overdue)
+{
+    const char *tag = (name == nullptr) ? "unknown" : name;
+    TIME_HILOGE(TIME_MODULE_SERVICE, "watchdog timeout, name:%{public}s, tid:%{public}d, overdue:%{public}" PRId64
+        "ms", tag, slot.tid.load(std::memory_order_relaxed), overdue);
+    #ifdef HICOLLIE_ENABLE
+    HiviewDFX::XCollie::GetInstance().SetTimer(tag, ESCALATE_TIMEOUT_SECONDS, nullptr, nullptr, flag);
+    #endif
+}
+} // namespace MiscServices
+} // namespace OHOS
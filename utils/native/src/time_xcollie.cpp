@@ -23,18 +23,31 @@
 
 namespace OHOS {
 namespace MiscServices {
-TimeXCollie::TimeXCollie(const std::string &name, uint32_t timeoutSeconds,
+namespace {
+constexpr int64_t MILLI_TO_SEC = 1000;
+}
+
+TimeXCollie::TimeXCollie(const char *name, uint32_t timeoutSeconds,
     std::function<void(void *)> func, void *arg, uint32_t flag)
+    : id_(-1), slot_(WATCHDOG_INVALID_SLOT), name_(name), isCanceled_(false)
 {
-    name_ = name;
+    // a custom callback can only be honored by a dedicated HiCollie timer
+    if (func == nullptr) {
+        slot_ = TimeWatchdog::GetInstance().GetThreadSlot();
+    }
+    if (slot_ != WATCHDOG_INVALID_SLOT) {
+        TimeWatchdog::Frame frame;
+        frame.name = name_;
+        frame.deadline = TimeWatchdog::GetMonotonicMs() + static_cast<int64_t>(timeoutSeconds) * MILLI_TO_SEC;
+        frame.flag = flag;
+        prev_ = TimeWatchdog::GetInstance().Arm(slot_, frame);
+        return;
+    }
     #ifdef HICOLLIE_ENABLE
     id_ = HiviewDFX::XCollie::GetInstance().SetTimer(name_, timeoutSeconds, func, arg, flag);
-    #else
-    id_ = -1;
     #endif
-    isCanceled_ = false;
     TIME_HILOGD(TIME_MODULE_SERVICE, "start TimeXCollie, name:%{public}s,timeout:%{public}u,flag:%{public}u,"
-        "id:%{public}d", name_.c_str(), timeoutSeconds, flag, id_);
+        "id:%{public}d", name_, timeoutSeconds, flag, id_);
 }
 
 TimeXCollie::~TimeXCollie()
@@ -44,13 +57,18 @@ TimeXCollie::~TimeXCollie()
 
 void TimeXCollie::CancelTimeXCollie()
 {
-    if (!isCanceled_) {
-        #ifdef HICOLLIE_ENABLE
-        HiviewDFX::XCollie::GetInstance().CancelTimer(id_);
-        #endif
-        isCanceled_ = true;
-        TIME_HILOGD(TIME_MODULE_SERVICE, "cancel TimeXCollie, tag:%{public}s,id:%{public}d", name_.c_str(), id_);
+    if (isCanceled_) {
+        return;
     }
+    isCanceled_ = true;
+    if (slot_ != WATCHDOG_INVALID_SLOT) {
+        TimeWatchdog::GetInstance().Restore(slot_, prev_);
+        return;
+    }
+    #ifdef HICOLLIE_ENABLE
+    HiviewDFX::XCollie::GetInstance().CancelTimer(id_);
+    #endif
+    TIME_HILOGD(TIME_MODULE_SERVICE, "cancel TimeXCollie, tag:%{public}s,id:%{public}d", name_, id_);
 }
 }
 }
\ No newline at end of file